@@ -1,11 +1,13 @@
-import React, { useState, useEffect } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import axios from 'axios';
-import { Chart as ChartJS, CategoryScale, LinearScale, PointElement, LineElement, Title, Tooltip, Legend } from 'chart.js';
-import { Line } from 'react-chartjs-2';
+import { Chart as ChartJS, CategoryScale, LinearScale, PointElement, LineElement, BarElement, Title, Tooltip, Legend } from 'chart.js';
+import { Line, Bar } from 'react-chartjs-2';
 // const API_BASE_URL ='http://localhost:5001';
 const API_BASE_URL = process.env.REACT_APP_API_URL;
+// Paths drawn in the sample paths chart (the server's default steps and points apply)
+const SAMPLE_PATH_COUNT = 50;
 // Register ChartJS components
-ChartJS.register(CategoryScale, LinearScale, PointElement, LineElement, Title, Tooltip, Legend);
+ChartJS.register(CategoryScale, LinearScale, PointElement, LineElement, BarElement, Title, Tooltip, Legend);
 
 const BlackScholes = () => {
   // State for form inputs
@@ -24,6 +26,17 @@ const BlackScholes = () => {
   const [result, setResult] = useState(null);
   const [loading, setLoading] = useState(false);
   const [error, setError] = useState(null);
+
+  // Running estimates streamed while a simulation runs (for the convergence chart)
+  const [progress, setProgress] = useState([]);
+  const [stopped, setStopped] = useState(false);
+  const streamRef = useRef(null);
+
+  // A few simulated price paths of the last run, downsampled by the server (for the paths chart)
+  const [samplePaths, setSamplePaths] = useState(null);
+
+  // Terminal-price distribution is opt-in: it runs the slower split kernel in double precision
+  const [showDistribution, setShowDistribution] = useState(false);
   
   // State for validation errors
   const [validationErrors, setValidationErrors] = useState({});
@@ -67,6 +80,15 @@ const BlackScholes = () => {
     checkImplementation();
   }, []);
 
+  // Close a running simulation stream when the component unmounts
+  useEffect(() => {
+    return () => {
+      if (streamRef.current) {
+        streamRef.current.close();
+      }
+    };
+  }, []);
+
   // Fetch history when history tab is active
   useEffect(() => {
     if (activeTab === 'history') {
@@ -171,41 +193,128 @@ const BlackScholes = () => {
     
     setLoading(true);
     setError(null);
+    setResult(null);
+    setSamplePaths(null);
+    setProgress([]);
+    setStopped(false);
+
+    // Stream the run: progress events draw the convergence chart, then one result event
+    const query = new URLSearchParams({
+      S0: formData.S0,
+      K: formData.K,
+      r: formData.r,
+      sigma: formData.sigma,
+      T: formData.T,
+      isCall: formData.isCall,
+      numTrials: formData.numTrials,
+      validateWithAnalytical: formData.validateWithAnalytical,
+      convergence: true,
+      distribution: showDistribution
+    });
+    const stream = new EventSource(`${API_BASE_URL}/api/black-scholes/stream?${query}`);
+    streamRef.current = stream;
+    const finish = () => {
+      stream.close();
+      streamRef.current = null;
+      setLoading(false);
+    };
+
+    stream.addEventListener('progress', (event) => {
+      const point = JSON.parse(event.data);
+      setProgress((points) => [...points, point]);
+    });
+
+    stream.addEventListener('result', async (event) => {
+      finish();
+      const data = JSON.parse(event.data);
+      setResult(data);
+      fetchSamplePaths();
+
+      try {
+        // Prepare tags as an array
+        const tagsArray = simulationMeta.tags
+          ? simulationMeta.tags.split(',').map(tag => tag.trim())
+          : [];
+
+        // Save to history
+        await axios.post(`${API_BASE_URL}/api/history`, {
+          simulationType: 'black-scholes',
+          parameters: formData,
+          result: data,
+          name: simulationMeta.name || 'Black-Scholes Simulation',
+          description: simulationMeta.description || '',
+          tags: tagsArray
+        });
+      } catch (err) {
+        console.error('Error saving simulation:', err);
+      }
+    });
 
+    stream.addEventListener('failure', (event) => {
+      finish();
+      setError(`Error: ${JSON.parse(event.data).error}`);
+    });
+
+    // Connection errors (including validation failures, which are not event streams)
+    stream.onerror = (err) => {
+      if (streamRef.current !== stream) {
+        return;
+      }
+      finish();
+      setError('Error calculating option price. Please check your inputs and try again.');
+      console.error('Error:', err);
+    };
+  };
+
+  // Fetch sample paths for the current parameters. The response is binary: a header of two
+  // uint32 (path count, points per path) followed by float32 times and prices, path after path.
+  const fetchSamplePaths = async () => {
     try {
-      const response = await axios.post(`${API_BASE_URL}/api/black-scholes`, formData);
-      setResult(response.data);
-      
-      // Prepare tags as an array
-      const tagsArray = simulationMeta.tags
-        ? simulationMeta.tags.split(',').map(tag => tag.trim())
-        : [];
-      
-      // Save to history
-      await axios.post(`${API_BASE_URL}/api/history`, {
-        simulationType: 'black-scholes',
-        parameters: formData,
-        result: response.data,
-        name: simulationMeta.name || 'Black-Scholes Simulation',
-        description: simulationMeta.description || '',
-        tags: tagsArray
+      const response = await axios.get(`${API_BASE_URL}/api/black-scholes/paths`, {
+        params: {
+          S0: formData.S0,
+          r: formData.r,
+          sigma: formData.sigma,
+          T: formData.T,
+          count: SAMPLE_PATH_COUNT
+        },
+        responseType: 'arraybuffer'
       });
-    } catch (err) {
-      if (err.response && err.response.data && err.response.data.error) {
-        setError(`Error: ${err.response.data.error}`);
-      } else {
-        setError('Error calculating option price. Please check your inputs and try again.');
+      const header = new DataView(response.data, 0, 8);
+      const count = header.getUint32(0, true);
+      const points = header.getUint32(4, true);
+      const times = new Float32Array(response.data, 8, count * points);
+      const prices = new Float32Array(response.data, 8 + count * points * 4, count * points);
+      const paths = [];
+      for (let p = 0; p < count; p++) {
+        const path = [];
+        for (let i = p * points; i < (p + 1) * points; i++) {
+          path.push({ x: times[i], y: prices[i] });
+        }
+        paths.push(path);
       }
-      console.error('Error:', err);
-    } finally {
-      setLoading(false);
+      setSamplePaths(paths);
+    } catch (err) {
+      console.error('Error fetching sample paths:', err);
+    }
+  };
+
+  // Stop a running simulation; closing the stream stops the engine on the server
+  const stopSimulation = () => {
+    if (streamRef.current) {
+      streamRef.current.close();
+      streamRef.current = null;
     }
+    setLoading(false);
+    setStopped(true);
   };
 
   // Load a simulation from history
   const loadSimulation = (simulation) => {
     setFormData(simulation.parameters);
     setResult(simulation.result);
+    setSamplePaths(null);
+    setProgress([]);
     setSimulationMeta({
       name: simulation.name || '',
       description: simulation.description || '',
@@ -290,6 +399,67 @@ const BlackScholes = () => {
     }]
   } : { labels: [], datasets: [] };
 
+  // Convergence of the estimate: the run's checkpoints (1k, 2k, 4k, ... paths) once it has
+  // finished, the streamed running estimates until then
+  const convergencePoints = result && result.convergence ? result.convergence : progress;
+  const convergenceData = {
+    labels: convergencePoints.map((point) => point.paths.toLocaleString()),
+    datasets: [
+      {
+        label: 'Estimate',
+        data: convergencePoints.map((point) => point.optionPrice),
+        borderColor: 'rgba(75, 192, 192, 1)',
+        backgroundColor: 'rgba(75, 192, 192, 0.2)',
+        borderWidth: 2
+      },
+      {
+        label: '95% CI lower',
+        data: convergencePoints.map((point) => point.confidence.lower),
+        borderColor: 'rgba(153, 102, 255, 0.6)',
+        borderDash: [4, 4],
+        borderWidth: 1,
+        pointRadius: 0
+      },
+      {
+        label: '95% CI upper',
+        data: convergencePoints.map((point) => point.confidence.upper),
+        borderColor: 'rgba(153, 102, 255, 0.6)',
+        borderDash: [4, 4],
+        borderWidth: 1,
+        pointRadius: 0
+      }
+    ]
+  };
+  const latestEstimate = progress.length > 0 ? progress[progress.length - 1] : null;
+
+  // Terminal price histogram of the finished run, one bar per bin (labelled by its midpoint)
+  const distribution = result && result.distribution;
+  const histogram = distribution ? distribution.terminalPrice.histogram : null;
+  const distributionData = histogram ? {
+    labels: histogram.counts.map((count, i) => {
+      const width = (histogram.upper - histogram.lower) / histogram.counts.length;
+      return (histogram.lower + (i + 0.5) * width).toFixed(2);
+    }),
+    datasets: [{
+      label: 'Paths',
+      data: histogram.counts,
+      backgroundColor: 'rgba(75, 192, 192, 0.4)',
+      borderColor: 'rgba(75, 192, 192, 1)',
+      borderWidth: 1
+    }]
+  } : { labels: [], datasets: [] };
+
+  // One line per sample path, against time in years (each path has its own downsampled times)
+  const samplePathsData = {
+    datasets: (samplePaths || []).map((path, i) => ({
+      label: `Path ${i + 1}`,
+      data: path,
+      borderColor: `hsla(${(i * 137) % 360}, 60%, 50%, 0.5)`,
+      borderWidth: 1,
+      pointRadius: 0
+    }))
+  };
+
   // Format date for display
   const formatDate = (dateString) => {
     const date = new Date(dateString);
@@ -429,6 +599,18 @@ const BlackScholes = () => {
                   Validate with Analytical Solution
                 </label>
               </div>
+
+              <div className="form-group checkbox">
+                <label>
+                  <input
+                    type="checkbox"
+                    name="showDistribution"
+                    checked={showDistribution}
+                    onChange={(e) => setShowDistribution(e.target.checked)}
+                  />
+                  Show Terminal Price Distribution (slower)
+                </label>
+              </div>
               
               <div className="form-group">
                 <label>Simulation Name:</label>
@@ -465,11 +647,54 @@ const BlackScholes = () => {
               <button type="submit" className="run-button" disabled={loading}>
                 {loading ? 'Running Simulation...' : 'Run Simulation'}
               </button>
+              {loading && (
+                <button type="button" className="stop-button" onClick={stopSimulation}>
+                  Stop
+                </button>
+              )}
             </form>
           </div>
           
           <div className="results-column">
             {error && <div className="error-message">{error}</div>}
+            {!result && latestEstimate && (
+              <div className="results">
+                <h3>{stopped ? 'Simulation Stopped' : 'Simulation Running'}</h3>
+                <div className="result-summary">
+                  <p>
+                    <strong>Paths:</strong> {latestEstimate.paths.toLocaleString()} of {latestEstimate.totalPaths.toLocaleString()}
+                  </p>
+                  <p>
+                    <strong>Current Estimate:</strong> ${latestEstimate.optionPrice.toFixed(4)}
+                  </p>
+                  <p>
+                    <strong>95% Confidence Interval:</strong>{' '}
+                    ${latestEstimate.confidence.lower.toFixed(4)} to ${latestEstimate.confidence.upper.toFixed(4)}
+                  </p>
+                </div>
+              </div>
+            )}
+            {convergencePoints.length > 0 && (
+              <div className="chart-container">
+                <h4>Convergence</h4>
+                <Line
+                  data={convergenceData}
+                  options={{
+                    responsive: true,
+                    animation: false,
+                    plugins: {
+                      legend: {
+                        position: 'top',
+                      },
+                      title: {
+                        display: true,
+                        text: 'Running Estimate by Paths Simulated',
+                      },
+                    },
+                  }}
+                />
+              </div>
+            )}
             {result ? (
               <div className="results">
                 <h3>Simulation Results</h3>
@@ -525,8 +750,82 @@ const BlackScholes = () => {
                     }}
                   />
                 </div>
+
+                {samplePaths && (
+                  <div className="chart-container">
+                    <h4>Sample Paths</h4>
+                    <Line
+                      data={samplePathsData}
+                      options={{
+                        responsive: true,
+                        animation: false,
+                        scales: {
+                          x: {
+                            type: 'linear',
+                            title: {
+                              display: true,
+                              text: 'Years',
+                            },
+                          },
+                        },
+                        plugins: {
+                          legend: {
+                            display: false,
+                          },
+                          tooltip: {
+                            enabled: false,
+                          },
+                          title: {
+                            display: true,
+                            text: `${samplePaths.length} Simulated Stock Price Paths`,
+                          },
+                        },
+                      }}
+                    />
+                  </div>
+                )}
+
+                {distribution && (
+                  <div className="chart-container detailed-results">
+                    <h4>Distribution ({distribution.count.toLocaleString()} paths)</h4>
+                    <Bar
+                      data={distributionData}
+                      options={{
+                        responsive: true,
+                        animation: false,
+                        plugins: {
+                          legend: {
+                            display: false,
+                          },
+                          title: {
+                            display: true,
+                            text: 'Terminal Stock Price at Maturity',
+                          },
+                        },
+                      }}
+                    />
+                    <table>
+                      <thead>
+                        <tr>
+                          <th>Quantile</th>
+                          <th>Terminal Price</th>
+                          <th>Payoff (undiscounted)</th>
+                        </tr>
+                      </thead>
+                      <tbody>
+                        {distribution.terminalPrice.quantiles.map((point, i) => (
+                          <tr key={point.q}>
+                            <td>{(point.q * 100).toFixed(0)}%</td>
+                            <td>${point.value.toFixed(2)}</td>
+                            <td>${distribution.payoff.quantiles[i].value.toFixed(2)}</td>
+                          </tr>
+                        ))}
+                      </tbody>
+                    </table>
+                  </div>
+                )}
               </div>
-            ) : (
+            ) : !latestEstimate && (
               <div className="no-results">
                 <h3>Simulation Results</h3>
                 <p>Enter parameters on the left and click "Run Simulation" to see results here.</p>
@@ -1,4 +1,10 @@
 const SimulationHistory = require('../models/SimulationHistory');
+const { withSpan } = require('../utils/tracing');
+
+// Trace a MongoDB write on the history collection
+const tracedWrite = (operation, fn) => withSpan(`mongodb.${operation} simulationhistories`, {
+  attributes: { 'db.system': 'mongodb', 'db.collection.name': 'simulationhistories', 'db.operation.name': operation }
+}, fn);
 
 // Get all simulation history
 exports.getHistory = async (req, res) => {
@@ -25,7 +31,7 @@ exports.saveSimulation = async (req, res) => {
       tags: tags || []
     });
     
-    const savedSimulation = await newSimulation.save();
+    const savedSimulation = await tracedWrite('insert', () => newSimulation.save());
     res.status(201).json(savedSimulation);
   } catch (error) {
     console.error('Error saving simulation:', error);
@@ -64,7 +70,7 @@ exports.updateSimulation = async (req, res) => {
     if (description !== undefined) simulation.description = description;
     if (tags !== undefined) simulation.tags = tags;
     
-    const updatedSimulation = await simulation.save();
+    const updatedSimulation = await tracedWrite('update', () => simulation.save());
     res.json(updatedSimulation);
   } catch (error) {
     console.error('Error updating simulation:', error);
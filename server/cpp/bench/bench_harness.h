@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal in-tree microbenchmark harness. Each benchmark is a body that runs a given number of
+// iterations; the harness calibrates the iteration count to a minimum wall time and then
+// repeats the timed run to get a sample of ns-per-item figures.
+
+// Keep a value (and everything it depends on) from being optimized away
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T *sink;
+    sink = &value;
+#endif
+}
+
+// Force pending stores to memory to be treated as observable
+inline void clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+struct Benchmark
+{
+    std::string name;
+    long items_per_iteration;                 // Paths/values processed by one iteration
+    std::function<void(long iterations)> body;
+};
+
+struct BenchmarkSample
+{
+    std::string name;
+    long items_per_iteration;
+    long iterations;                  // Iterations per repetition after calibration
+    std::vector<double> ns_per_item;  // One entry per repetition
+    double median_ns_per_item;
+    double min_ns_per_item;
+    double max_ns_per_item;
+    double stddev_ns_per_item;
+};
+
+inline double time_iterations(const Benchmark &benchmark, long iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    benchmark.body(iterations);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Calibrate, then time `repetitions` runs of at least min_time_ns each
+inline BenchmarkSample run_benchmark_case(const Benchmark &benchmark, double min_time_ns, int repetitions)
+{
+    // Warm-up doubles the iteration count until one run takes a tenth of the target,
+    // then scales the count to the target
+    long iterations = 1;
+    double elapsed = time_iterations(benchmark, iterations);
+    while (elapsed < 0.1 * min_time_ns && iterations < (1L << 40))
+    {
+        iterations *= 2;
+        elapsed = time_iterations(benchmark, iterations);
+    }
+    if (elapsed < min_time_ns)
+    {
+        iterations = static_cast<long>(std::ceil(iterations * min_time_ns / std::max(elapsed, 1.0)));
+    }
+
+    BenchmarkSample sample{benchmark.name, benchmark.items_per_iteration, iterations, {}, 0.0, 0.0, 0.0, 0.0};
+    const double items = static_cast<double>(iterations) * benchmark.items_per_iteration;
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        sample.ns_per_item.push_back(time_iterations(benchmark, iterations) / items);
+    }
+
+    std::vector<double> sorted = sample.ns_per_item;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    sample.median_ns_per_item = n % 2 == 0 ? (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0 : sorted[n / 2];
+    sample.min_ns_per_item = sorted.front();
+    sample.max_ns_per_item = sorted.back();
+
+    double mean = 0.0;
+    for (double v : sorted)
+        mean += v;
+    mean /= n;
+    double variance = 0.0;
+    for (double v : sorted)
+        variance += (v - mean) * (v - mean);
+    sample.stddev_ns_per_item = n > 1 ? std::sqrt(variance / (n - 1)) : 0.0;
+    return sample;
+}
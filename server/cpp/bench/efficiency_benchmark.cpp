@@ -0,0 +1,241 @@
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "analytical.h"
+#include "estimators.h"
+#include "json_writer.h"
+
+// Accuracy-vs-time comparison of the variance-reduction estimators. Every estimator prices each
+// contract `runs` times with independent seeds; the spread of those estimates around the
+// analytical price gives bias, RMSE and CI coverage, and the thread CPU time per run turns
+// RMSE into a work-normalized efficiency 1 / (MSE * CPU seconds).
+
+struct EfficiencyConfig
+{
+    int trials = 100000;
+    int runs = 100;
+    uint64_t seed = 20240601;
+    std::vector<Estimator> estimators;
+    std::vector<BatchContract> contracts;
+    std::string output; // empty = stdout
+};
+
+// Parse "S0,K,r,sigma,T,isCall"
+static BatchContract parse_contract(const std::string &text)
+{
+    std::istringstream in(text);
+    std::string field;
+    double values[6];
+    int count = 0;
+    while (std::getline(in, field, ',') && count < 6)
+    {
+        values[count++] = std::stod(field);
+    }
+    if (count != 6)
+        throw std::invalid_argument("--contract expects S0,K,r,sigma,T,isCall");
+    if (values[0] <= 0.0 || values[1] <= 0.0 || values[3] <= 0.0 || values[4] <= 0.0)
+        throw std::invalid_argument("--contract needs positive S0, K, sigma and T");
+    return {values[0], values[1], values[2], values[3], values[4], values[5] != 0.0};
+}
+
+static EfficiencyConfig parse_efficiency_args(int argc, char *argv[])
+{
+    EfficiencyConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--trials")
+            config.trials = std::stoi(value);
+        else if (key == "--runs")
+            config.runs = std::stoi(value);
+        else if (key == "--seed")
+            config.seed = std::stoull(value);
+        else if (key == "--methods")
+        {
+            std::istringstream in(value);
+            std::string name;
+            while (std::getline(in, name, ','))
+                config.estimators.push_back(parse_estimator(name));
+        }
+        else if (key == "--contract")
+            config.contracts.push_back(parse_contract(value));
+        else if (key == "--out")
+            config.output = value;
+        else
+            throw std::invalid_argument("Unknown option: " + key);
+    }
+    if (config.trials < 1000)
+        throw std::invalid_argument("--trials must be at least 1000");
+    if (config.runs < 2)
+        throw std::invalid_argument("--runs must be at least 2");
+
+    if (config.estimators.empty())
+    {
+        for (int i = 0; i < ESTIMATOR_COUNT; ++i)
+            config.estimators.push_back(static_cast<Estimator>(i));
+    }
+    if (config.contracts.empty())
+    {
+        // At the money, out-of-the-money call (rare payoff) and out-of-the-money put
+        config.contracts = {{100.0, 100.0, 0.05, 0.2, 1.0, true},
+                            {100.0, 140.0, 0.05, 0.2, 1.0, true},
+                            {100.0, 80.0, 0.05, 0.2, 1.0, false}};
+    }
+    return config;
+}
+
+static double thread_cpu_seconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct EfficiencyResult
+{
+    Estimator estimator;
+    double mean_estimate;
+    double bias;
+    double bias_standard_error;
+    double rmse;
+    double mean_standard_error;
+    double coverage;       // Fraction of runs whose 95% CI contains the analytical price
+    double cpu_seconds;    // Per run
+    double efficiency;     // 1 / (MSE * CPU seconds)
+};
+
+static EfficiencyResult measure(Estimator estimator, const BatchContract &contract, double reference,
+                                const EfficiencyConfig &config)
+{
+    double sum = 0.0, sum_squared_error = 0.0, sum_standard_error = 0.0, cpu = 0.0;
+    std::vector<double> estimates;
+    int covered = 0;
+
+    for (int run = 0; run < config.runs; ++run)
+    {
+        const double start = thread_cpu_seconds();
+        const Estimate estimate = estimate_price(estimator, contract, config.trials, config.seed + run);
+        cpu += thread_cpu_seconds() - start;
+
+        const double error = estimate.price - reference;
+        sum += estimate.price;
+        sum_squared_error += error * error;
+        sum_standard_error += estimate.standardError;
+        covered += std::fabs(error) <= estimate.criticalValue * estimate.standardError;
+        estimates.push_back(estimate.price);
+    }
+
+    const double n = config.runs;
+    const double mean = sum / n;
+    double spread = 0.0;
+    for (double e : estimates)
+        spread += (e - mean) * (e - mean);
+    const double mse = sum_squared_error / n;
+
+    EfficiencyResult result;
+    result.estimator = estimator;
+    result.mean_estimate = mean;
+    result.bias = mean - reference;
+    result.bias_standard_error = std::sqrt(spread / (n - 1) / n);
+    result.rmse = std::sqrt(mse);
+    result.mean_standard_error = sum_standard_error / n;
+    result.coverage = covered / n;
+    result.cpu_seconds = cpu / n;
+    result.efficiency = mse > 0.0 && result.cpu_seconds > 0.0 ? 1.0 / (mse * result.cpu_seconds) : 0.0;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const EfficiencyConfig config = parse_efficiency_args(argc, argv);
+
+        int fd = STDOUT_FILENO;
+        if (!config.output.empty())
+        {
+            fd = ::open(config.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open output file: " + config.output);
+        }
+
+        JsonWriter json(fd);
+        json.begin_object()
+            .field("trials", config.trials)
+            .field("runs", config.runs)
+            .field("seed", static_cast<int64_t>(config.seed));
+        json.key("contracts").begin_array();
+
+        for (const BatchContract &contract : config.contracts)
+        {
+            const double reference = black_scholes_analytical(contract.S0, contract.K, contract.r,
+                                                              contract.sigma, contract.T, contract.isCall);
+            json.begin_object()
+                .field("S0", contract.S0)
+                .field("K", contract.K)
+                .field("r", contract.r)
+                .field("sigma", contract.sigma)
+                .field("T", contract.T)
+                .field("isCall", contract.isCall)
+                .field("analyticalPrice", reference);
+
+            std::vector<EfficiencyResult> results;
+            double plain_efficiency = 0.0;
+            for (Estimator estimator : config.estimators)
+            {
+                std::fprintf(stderr, "K=%g %s\n", contract.K, estimator_name(estimator));
+                results.push_back(measure(estimator, contract, reference, config));
+                if (estimator == Estimator::Plain)
+                    plain_efficiency = results.back().efficiency;
+            }
+
+            json.key("methods").begin_array();
+            for (const EfficiencyResult &result : results)
+            {
+                json.begin_object()
+                    .field("method", estimator_name(result.estimator))
+                    .field("meanEstimate", result.mean_estimate)
+                    .field("bias", result.bias)
+                    .field("biasStandardError", result.bias_standard_error)
+                    .field("rmse", result.rmse)
+                    .field("meanStandardError", result.mean_standard_error)
+                    .field("coverage", result.coverage)
+                    .field("cpuSecondsPerRun", result.cpu_seconds)
+                    // RMSE one CPU-second of this method would reach, assuming 1/sqrt(work) scaling
+                    .field("rmseAtOneCpuSecond", result.rmse * std::sqrt(result.cpu_seconds))
+                    .field("efficiency", result.efficiency);
+                if (plain_efficiency > 0.0)
+                    json.field("relativeEfficiency", result.efficiency / plain_efficiency);
+                json.end_object();
+            }
+            json.end_array().end_object();
+        }
+
+        json.end_array().end_object().newline();
+        json.flush();
+
+        if (fd != STDOUT_FILENO)
+            ::close(fd);
+    }
+    catch (const std::exception &e)
+    {
+        JsonWriter json(STDERR_FILENO);
+        json.begin_object().field("error", e.what()).end_object().newline();
+        json.flush();
+        return 1;
+    }
+
+    return 0;
+}
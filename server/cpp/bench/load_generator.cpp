@@ -0,0 +1,856 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hdr_histogram.h"
+#include "json_writer.h"
+
+// Load generator for the pricing service. Replays a weighted request mix against the HTTP API
+// or a `monte_carlo --serve` engine (JSON protocol over its stdin/stdout) at a series of load
+// levels and reports throughput and latency per level, i.e. a throughput/latency curve.
+//
+// Closed loop (--concurrency): N workers each send a request and wait for the answer.
+// Open loop (--rate): requests are scheduled at fixed arrival times (Poisson or uniform)
+// regardless of how fast answers come back. Latency is measured from the scheduled time, not
+// from when a busy client got around to sending, so a stalled server is charged for the
+// requests it delayed (no coordinated omission).
+
+using Clock = std::chrono::steady_clock;
+
+struct MixEntry
+{
+    std::string product; // "call", "put" or "batch<N>"
+    bool isCall = true;
+    int contracts = 1;   // > 1 for batch requests
+    int numTrials = 0;
+    double weight = 1.0;
+};
+
+struct LoadConfig
+{
+    std::string target = "engine:./monte_carlo"; // engine:<executable> or http://host:port
+    std::string path = "/api/black-scholes";     // HTTP route for single-contract requests
+    std::vector<MixEntry> mix;
+    bool open_loop = false;
+    std::vector<double> levels;                  // Concurrencies (closed) or requests/s (open)
+    bool poisson = true;
+    int connections = 64;                        // Open loop: most requests outstanding at once
+    double duration = 10.0;                      // Measured seconds per level
+    double warmup = 2.0;                         // Unmeasured seconds before each level
+    double slo_p99_ms = 0.0;                     // > 0: saturation also requires p99 within this
+    uint64_t seed = 20240601;
+    std::string output;                          // empty = stdout
+};
+
+struct Contract
+{
+    double S0, K, r, sigma, T;
+    bool isCall;
+};
+
+struct Request
+{
+    int entry; // Index into the mix
+    int numTrials;
+    std::vector<Contract> contracts;
+};
+
+// --- configuration ---
+
+// "call:100000:70,put:10000:20,batch50:10000:10" = product:numTrials[:weight]
+static std::vector<MixEntry> parse_mix(const std::string &text)
+{
+    std::vector<MixEntry> mix;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        std::istringstream fields(item);
+        std::string product, trials, weight;
+        std::getline(fields, product, ':');
+        std::getline(fields, trials, ':');
+        std::getline(fields, weight, ':');
+
+        MixEntry entry;
+        entry.product = product;
+        if (product == "put")
+            entry.isCall = false;
+        else if (product.rfind("batch", 0) == 0)
+            entry.contracts = std::stoi(product.substr(5));
+        else if (product != "call")
+            throw std::invalid_argument("Unknown product in --mix: " + product);
+        entry.numTrials = std::stoi(trials);
+        entry.weight = weight.empty() ? 1.0 : std::stod(weight);
+        if (entry.numTrials <= 0 || entry.contracts <= 0 || entry.weight <= 0.0)
+            throw std::invalid_argument("--mix entries need positive trials, batch size and weight");
+        mix.push_back(entry);
+    }
+    return mix;
+}
+
+static std::vector<double> parse_levels(const std::string &text)
+{
+    std::vector<double> levels;
+    std::istringstream in(text);
+    std::string level;
+    while (std::getline(in, level, ','))
+    {
+        levels.push_back(std::stod(level));
+        if (levels.back() <= 0.0)
+            throw std::invalid_argument("Load levels must be positive");
+    }
+    return levels;
+}
+
+static LoadConfig parse_load_args(int argc, char *argv[])
+{
+    LoadConfig config;
+    bool closed = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--target")
+            config.target = value;
+        else if (key == "--path")
+            config.path = value;
+        else if (key == "--mix")
+            config.mix = parse_mix(value);
+        else if (key == "--concurrency")
+        {
+            config.levels = parse_levels(value);
+            closed = true;
+        }
+        else if (key == "--rate")
+        {
+            config.levels = parse_levels(value);
+            config.open_loop = true;
+        }
+        else if (key == "--arrivals")
+        {
+            if (value != "poisson" && value != "uniform")
+                throw std::invalid_argument("--arrivals must be poisson or uniform");
+            config.poisson = value == "poisson";
+        }
+        else if (key == "--connections")
+            config.connections = std::stoi(value);
+        else if (key == "--duration")
+            config.duration = std::stod(value);
+        else if (key == "--warmup")
+            config.warmup = std::stod(value);
+        else if (key == "--slo-p99-ms")
+            config.slo_p99_ms = std::stod(value);
+        else if (key == "--seed")
+            config.seed = std::stoull(value);
+        else if (key == "--out")
+            config.output = value;
+        else
+            throw std::invalid_argument("Unknown option: " + key);
+    }
+
+    if (closed && config.open_loop)
+        throw std::invalid_argument("Use either --concurrency (closed loop) or --rate (open loop)");
+    if (config.levels.empty())
+        config.levels = {1, 2, 4, 8, 16};
+    if (config.mix.empty())
+        config.mix = parse_mix("call:100000:60,put:100000:20,call:1000000:15,batch20:10000:5");
+    if (config.duration <= 0.0 || config.warmup < 0.0 || config.connections < 1)
+        throw std::invalid_argument("--duration and --connections must be positive");
+    if (config.target.rfind("http://", 0) == 0)
+    {
+        for (const auto &entry : config.mix)
+            if (entry.contracts > 1)
+                throw std::invalid_argument("batch requests need an engine: target");
+    }
+    else if (config.target.rfind("engine:", 0) != 0)
+    {
+        throw std::invalid_argument("--target must be engine:<executable> or http://host:port");
+    }
+    return config;
+}
+
+// --- clients ---
+
+class Client
+{
+public:
+    virtual ~Client() = default;
+    // Blocking request; true when the server answered without an error
+    virtual bool call(const Request &request) = 0;
+};
+
+// One keep-alive HTTP/1.1 connection (one per worker)
+class HttpClient : public Client
+{
+public:
+    HttpClient(const std::string &url, const std::string &path) : path_(path)
+    {
+        const std::string rest = url.substr(std::strlen("http://"));
+        const size_t colon = rest.find(':');
+        host_ = rest.substr(0, colon);
+        port_ = colon == std::string::npos ? "80" : rest.substr(colon + 1);
+        const size_t slash = port_.find('/');
+        if (slash != std::string::npos)
+            port_ = port_.substr(0, slash);
+    }
+
+    ~HttpClient() override { disconnect(); }
+
+    bool call(const Request &request) override
+    {
+        const Contract &c = request.contracts.front();
+        char body[256];
+        std::snprintf(body, sizeof(body),
+                      "{\"S0\":%.6g,\"K\":%.6g,\"r\":%.6g,\"sigma\":%.6g,\"T\":%.6g,\"isCall\":%s,\"numTrials\":%d}",
+                      c.S0, c.K, c.r, c.sigma, c.T, c.isCall ? "true" : "false", request.numTrials);
+        std::string message = "POST " + path_ + " HTTP/1.1\r\nHost: " + host_ + ":" + port_ +
+                              "\r\nContent-Type: application/json\r\nConnection: keep-alive\r\nContent-Length: " +
+                              std::to_string(std::strlen(body)) + "\r\n\r\n" + body;
+
+        // A keep-alive connection the server closed shows up on the first attempt; retry once
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            if (fd_ < 0 && !connect_socket())
+                return false;
+            int status = 0;
+            if (send_all(message) && read_response(status))
+                return status >= 200 && status < 300;
+            disconnect();
+        }
+        return false;
+    }
+
+private:
+    bool connect_socket()
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        if (getaddrinfo(host_.c_str(), port_.c_str(), &hints, &addresses) != 0)
+            return false;
+        for (addrinfo *a = addresses; a; a = a->ai_next)
+        {
+            fd_ = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd_ >= 0 && ::connect(fd_, a->ai_addr, a->ai_addrlen) == 0)
+            {
+                const int one = 1;
+                ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                break;
+            }
+            disconnect();
+        }
+        freeaddrinfo(addresses);
+        buffer_.clear();
+        return fd_ >= 0;
+    }
+
+    void disconnect()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool send_all(const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            const ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool fill()
+    {
+        char chunk[16384];
+        const ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            return false;
+        buffer_.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    bool read_line(std::string &line)
+    {
+        size_t end;
+        while ((end = buffer_.find("\r\n")) == std::string::npos)
+            if (!fill())
+                return false;
+        line = buffer_.substr(0, end);
+        buffer_.erase(0, end + 2);
+        return true;
+    }
+
+    bool skip_bytes(size_t count)
+    {
+        while (buffer_.size() < count)
+            if (!fill())
+                return false;
+        buffer_.erase(0, count);
+        return true;
+    }
+
+    // Status line, headers, then a Content-Length or chunked body (discarded)
+    bool read_response(int &status)
+    {
+        std::string line;
+        if (!read_line(line) || line.size() < 12)
+            return false;
+        status = std::atoi(line.c_str() + 9);
+
+        long content_length = -1;
+        bool chunked = false, close_after = false;
+        while (read_line(line) && !line.empty())
+        {
+            std::string lower = line;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            if (lower.rfind("content-length:", 0) == 0)
+                content_length = std::atol(lower.c_str() + 15);
+            else if (lower.rfind("transfer-encoding:", 0) == 0 && lower.find("chunked") != std::string::npos)
+                chunked = true;
+            else if (lower.rfind("connection:", 0) == 0 && lower.find("close") != std::string::npos)
+                close_after = true;
+        }
+        if (!line.empty())
+            return false;
+
+        bool ok = true;
+        if (chunked)
+        {
+            while (ok)
+            {
+                ok = read_line(line);
+                const size_t size = ok ? std::strtoul(line.c_str(), nullptr, 16) : 0;
+                if (!ok || size == 0)
+                    break;
+                ok = skip_bytes(size + 2);
+            }
+            ok = ok && read_line(line); // Blank line after the last chunk
+        }
+        else if (content_length > 0)
+        {
+            ok = skip_bytes(static_cast<size_t>(content_length));
+        }
+        if (close_after)
+            disconnect();
+        return ok;
+    }
+
+    std::string host_, port_, path_;
+    int fd_ = -1;
+    std::string buffer_;
+};
+
+// A `monte_carlo --serve` child speaking the JSON protocol. Requests from all workers are
+// multiplexed over its stdin by id; a reader thread completes them as answers arrive.
+class EngineProcess
+{
+public:
+    explicit EngineProcess(const std::string &executable)
+    {
+        int to_child[2], from_child[2];
+        if (::pipe(to_child) != 0 || ::pipe(from_child) != 0)
+            throw std::runtime_error("pipe() failed");
+        pid_ = ::fork();
+        if (pid_ < 0)
+            throw std::runtime_error("fork() failed");
+        if (pid_ == 0)
+        {
+            ::dup2(to_child[0], STDIN_FILENO);
+            ::dup2(from_child[1], STDOUT_FILENO);
+            ::close(to_child[1]);
+            ::close(from_child[0]);
+            ::execl(executable.c_str(), executable.c_str(), "--serve", static_cast<char *>(nullptr));
+            std::_Exit(127);
+        }
+        ::close(to_child[0]);
+        ::close(from_child[1]);
+        in_ = to_child[1];
+        out_ = from_child[0];
+
+        write_line("HELLO json\n");
+        std::string handshake;
+        if (!read_line(handshake) || handshake.find("\"json\"") == std::string::npos)
+            throw std::runtime_error("Engine did not acknowledge the JSON protocol: " + executable);
+        reader_ = std::thread([this] { read_responses(); });
+    }
+
+    ~EngineProcess()
+    {
+        ::close(in_); // The engine finishes accepted requests and exits
+        if (reader_.joinable())
+            reader_.join();
+        ::close(out_);
+        int status;
+        ::waitpid(pid_, &status, 0);
+    }
+
+    bool call(const Request &request)
+    {
+        std::promise<bool> answered;
+        std::future<bool> result = answered.get_future();
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            if (closed_)
+                return false;
+            id = next_id_++;
+            pending_.emplace(id, std::move(answered));
+        }
+
+        std::string line = std::to_string(id);
+        char number[512];
+        if (request.contracts.size() == 1)
+        {
+            const Contract &c = request.contracts.front();
+            std::snprintf(number, sizeof(number), " price %.17g %.17g %.17g %.17g %.17g %d %d\n",
+                          c.S0, c.K, c.r, c.sigma, c.T, c.isCall ? 1 : 0, request.numTrials);
+            line += number;
+        }
+        else
+        {
+            line += " batch " + std::to_string(request.numTrials) + " 0 " + std::to_string(request.contracts.size());
+            for (const Contract &c : request.contracts)
+            {
+                std::snprintf(number, sizeof(number), " %.17g %.17g %.17g %.17g %.17g %d",
+                              c.S0, c.K, c.r, c.sigma, c.T, c.isCall ? 1 : 0);
+                line += number;
+            }
+            line += '\n';
+        }
+        write_line(line);
+        return result.get();
+    }
+
+private:
+    void write_line(const std::string &line)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        size_t written = 0;
+        while (written < line.size())
+        {
+            const ssize_t n = ::write(in_, line.data() + written, line.size() - written);
+            if (n <= 0)
+                return; // Engine died - the reader fails the pending requests
+            written += static_cast<size_t>(n);
+        }
+    }
+
+    bool read_line(std::string &line)
+    {
+        size_t end;
+        while ((end = buffer_.find('\n')) == std::string::npos)
+        {
+            char chunk[65536];
+            const ssize_t n = ::read(out_, chunk, sizeof(chunk));
+            if (n <= 0)
+                return false;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+        line = buffer_.substr(0, end);
+        buffer_.erase(0, end + 1);
+        return true;
+    }
+
+    void read_responses()
+    {
+        std::string line;
+        while (read_line(line))
+        {
+            const size_t at = line.find("\"id\":");
+            if (at == std::string::npos)
+                continue;
+            const uint32_t id = static_cast<uint32_t>(std::strtoul(line.c_str() + at + 5, nullptr, 10));
+            const bool ok = line.find("\"error\"") == std::string::npos;
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_.find(id);
+            if (it != pending_.end())
+            {
+                it->second.set_value(ok);
+                pending_.erase(it);
+            }
+        }
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        closed_ = true;
+        for (auto &entry : pending_)
+            entry.second.set_value(false);
+        pending_.clear();
+    }
+
+    pid_t pid_ = -1;
+    int in_ = -1, out_ = -1;
+    std::string buffer_;
+    std::thread reader_;
+    std::mutex write_mutex_;
+    std::mutex pending_mutex_;
+    std::unordered_map<uint32_t, std::promise<bool>> pending_;
+    uint32_t next_id_ = 1;
+    bool closed_ = false;
+};
+
+class EngineClient : public Client
+{
+public:
+    explicit EngineClient(EngineProcess &engine) : engine_(engine) {}
+    bool call(const Request &request) override { return engine_.call(request); }
+
+private:
+    EngineProcess &engine_;
+};
+
+// --- load ---
+
+// Draws requests from the mix: contracts around an at-the-money reference with varied
+// strike, volatility and maturity
+class RequestSource
+{
+public:
+    RequestSource(const std::vector<MixEntry> &mix, uint64_t seed) : mix_(mix), rng_(seed)
+    {
+        std::vector<double> weights;
+        for (const auto &entry : mix)
+            weights.push_back(entry.weight);
+        pick_ = std::discrete_distribution<int>(weights.begin(), weights.end());
+    }
+
+    Request next()
+    {
+        Request request;
+        request.entry = pick_(rng_);
+        const MixEntry &entry = mix_[request.entry];
+        request.numTrials = entry.numTrials;
+        std::uniform_real_distribution<double> strike(80.0, 120.0), vol(0.15, 0.35), maturity(0.25, 2.0);
+        for (int i = 0; i < entry.contracts; ++i)
+            request.contracts.push_back({100.0, strike(rng_), 0.05, vol(rng_), maturity(rng_),
+                                         entry.contracts > 1 ? (i % 2 == 0) : entry.isCall});
+        return request;
+    }
+
+private:
+    const std::vector<MixEntry> &mix_;
+    std::mt19937_64 rng_;
+    std::discrete_distribution<int> pick_;
+};
+
+// Per-worker recording (each histogram has one writer)
+struct WorkerStats
+{
+    HdrHistogram latency;                                // ns
+    std::vector<std::unique_ptr<HdrHistogram>> by_entry; // ns, per mix entry
+    long requests = 0;
+    long errors = 0;
+    long paths = 0;
+    long late_starts = 0; // Open loop: sent more than 1 ms after the scheduled time
+};
+
+struct LevelResult
+{
+    double level;
+    long requests = 0;
+    long errors = 0;
+    long paths = 0;
+    long late_starts = 0;
+    HdrSnapshot latency;
+    std::vector<HdrSnapshot> by_entry;
+};
+
+// Scheduled send times (ns from the level start) for an open-loop level
+static std::vector<int64_t> arrival_schedule(double rate, double seconds, bool poisson, uint64_t seed)
+{
+    std::vector<int64_t> arrivals;
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap(rate);
+    double t = 0.0;
+    for (long i = 0;; ++i)
+    {
+        t = poisson ? t + gap(rng) : i / rate;
+        if (t >= seconds)
+            break;
+        arrivals.push_back(static_cast<int64_t>(t * 1e9));
+    }
+    return arrivals;
+}
+
+static LevelResult run_level(const LoadConfig &config, double level, int level_index,
+                             const std::function<std::unique_ptr<Client>()> &make_client)
+{
+    const int workers = config.open_loop ? config.connections : static_cast<int>(level);
+    const auto start = Clock::now() + std::chrono::milliseconds(50);
+    const auto measure_start = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+    const auto end = measure_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+    std::vector<int64_t> arrivals;
+    if (config.open_loop)
+        arrivals = arrival_schedule(level, config.warmup + config.duration, config.poisson, config.seed + level_index);
+    std::atomic<size_t> next_arrival{0};
+
+    std::vector<std::unique_ptr<WorkerStats>> stats;
+    for (int w = 0; w < workers; ++w)
+    {
+        stats.push_back(std::make_unique<WorkerStats>());
+        for (size_t e = 0; e < config.mix.size(); ++e)
+            stats.back()->by_entry.push_back(std::make_unique<HdrHistogram>());
+    }
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; ++w)
+    {
+        threads.emplace_back([&, w]
+                             {
+            WorkerStats &mine = *stats[w];
+            std::unique_ptr<Client> client = make_client();
+            RequestSource source(config.mix, config.seed * 7919 + level_index * 1000 + w);
+
+            while (true)
+            {
+                // Closed loop: the clock starts when the request is sent. Open loop: it starts at
+                // the scheduled arrival, even if every connection was busy at that moment.
+                Clock::time_point scheduled;
+                if (config.open_loop)
+                {
+                    const size_t i = next_arrival.fetch_add(1);
+                    if (i >= arrivals.size())
+                        break;
+                    scheduled = start + std::chrono::nanoseconds(arrivals[i]);
+                    std::this_thread::sleep_until(scheduled);
+                    if (Clock::now() - scheduled > std::chrono::milliseconds(1) && scheduled >= measure_start)
+                        mine.late_starts++;
+                }
+                else
+                {
+                    std::this_thread::sleep_until(start); // Start together
+                    scheduled = Clock::now();
+                    if (scheduled >= end)
+                        break;
+                }
+
+                const Request request = source.next();
+                const bool ok = client->call(request);
+                const auto finished = Clock::now();
+                if (scheduled < measure_start || scheduled >= end)
+                    continue;
+
+                const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(finished - scheduled).count();
+                mine.requests++;
+                if (!ok)
+                {
+                    mine.errors++;
+                    continue;
+                }
+                mine.latency.record(ns);
+                mine.by_entry[request.entry]->record(ns);
+                mine.paths += static_cast<long>(request.numTrials) * static_cast<long>(request.contracts.size());
+            } });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    LevelResult result;
+    result.level = level;
+    result.by_entry.resize(config.mix.size());
+    for (const auto &worker : stats)
+    {
+        result.requests += worker->requests;
+        result.errors += worker->errors;
+        result.paths += worker->paths;
+        result.late_starts += worker->late_starts;
+        result.latency.add(worker->latency);
+        for (size_t e = 0; e < config.mix.size(); ++e)
+            result.by_entry[e].add(*worker->by_entry[e]);
+    }
+    return result;
+}
+
+static double ms(uint64_t ns) { return ns * 1e-6; }
+
+static void write_latency(JsonWriter &json, const HdrSnapshot &latency)
+{
+    json.begin_object()
+        .field("p50", ms(latency.value_at_quantile(0.5)))
+        .field("p90", ms(latency.value_at_quantile(0.9)))
+        .field("p99", ms(latency.value_at_quantile(0.99)))
+        .field("p999", ms(latency.value_at_quantile(0.999)))
+        .field("max", ms(latency.max))
+        .end_object();
+}
+
+// Open loop: the highest rate still served (>= 95% of offered, < 1% errors).
+// Closed loop: the last concurrency before throughput stops growing by 5% per step.
+// With --slo-p99-ms, levels whose p99 exceeds it do not count as served.
+static int saturation_index(const LoadConfig &config, const std::vector<LevelResult> &results)
+{
+    int index = -1;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const LevelResult &r = results[i];
+        const double throughput = (r.requests - r.errors) / config.duration;
+        if (config.slo_p99_ms > 0.0 && ms(r.latency.value_at_quantile(0.99)) > config.slo_p99_ms)
+            break;
+        if (config.open_loop)
+        {
+            if (throughput >= 0.95 * r.level && r.errors <= 0.01 * r.requests)
+                index = static_cast<int>(i);
+        }
+        else
+        {
+            if (i > 0)
+            {
+                const LevelResult &p = results[i - 1];
+                if (throughput < 1.05 * (p.requests - p.errors) / config.duration)
+                    return static_cast<int>(i) - 1;
+            }
+            index = static_cast<int>(i);
+        }
+    }
+    return index;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const LoadConfig config = parse_load_args(argc, argv);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        std::unique_ptr<EngineProcess> engine;
+        std::function<std::unique_ptr<Client>()> make_client;
+        if (config.target.rfind("engine:", 0) == 0)
+        {
+            engine = std::make_unique<EngineProcess>(config.target.substr(std::strlen("engine:")));
+            make_client = [&engine] { return std::unique_ptr<Client>(new EngineClient(*engine)); };
+        }
+        else
+        {
+            make_client = [&config] { return std::unique_ptr<Client>(new HttpClient(config.target, config.path)); };
+        }
+
+        std::vector<LevelResult> results;
+        for (size_t i = 0; i < config.levels.size(); ++i)
+        {
+            std::fprintf(stderr, "%s %g\n", config.open_loop ? "rate" : "concurrency", config.levels[i]);
+            results.push_back(run_level(config, config.levels[i], static_cast<int>(i), make_client));
+        }
+        engine.reset();
+
+        int fd = STDOUT_FILENO;
+        if (!config.output.empty())
+        {
+            fd = ::open(config.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open output file: " + config.output);
+        }
+
+        JsonWriter json(fd);
+        json.begin_object()
+            .field("target", config.target)
+            .field("mode", config.open_loop ? "open" : "closed")
+            .field("arrivals", config.open_loop ? (config.poisson ? "poisson" : "uniform") : "closed")
+            .field("durationSeconds", config.duration)
+            .field("warmupSeconds", config.warmup);
+        if (config.slo_p99_ms > 0.0)
+            json.field("sloP99Ms", config.slo_p99_ms);
+        if (config.open_loop)
+            json.field("connections", config.connections);
+
+        json.key("mix").begin_array();
+        for (const auto &entry : config.mix)
+        {
+            json.begin_object()
+                .field("product", entry.product)
+                .field("contracts", entry.contracts)
+                .field("numTrials", entry.numTrials)
+                .field("weight", entry.weight)
+                .end_object();
+        }
+        json.end_array();
+
+        json.key("levels").begin_array();
+        for (const LevelResult &r : results)
+        {
+            json.begin_object()
+                .field(config.open_loop ? "offeredRate" : "concurrency", r.level)
+                .field("requests", r.requests)
+                .field("errors", r.errors)
+                .field("throughput", (r.requests - r.errors) / config.duration)
+                .field("pathsPerSecond", r.paths / config.duration);
+            if (config.open_loop)
+                json.field("lateStarts", r.late_starts);
+            json.key("latencyMs");
+            write_latency(json, r.latency);
+
+            json.key("byProduct").begin_array();
+            for (size_t e = 0; e < config.mix.size(); ++e)
+            {
+                json.begin_object()
+                    .field("product", config.mix[e].product)
+                    .field("numTrials", config.mix[e].numTrials)
+                    .field("requests", static_cast<int64_t>(r.by_entry[e].total))
+                    .key("latencyMs");
+                write_latency(json, r.by_entry[e]);
+                json.end_object();
+            }
+            json.end_array().end_object();
+        }
+        json.end_array();
+
+        const int saturated = saturation_index(config, results);
+        json.key("saturation");
+        if (saturated < 0)
+        {
+            json.value(std::nan(""));
+        }
+        else
+        {
+            const LevelResult &r = results[saturated];
+            json.begin_object()
+                .field(config.open_loop ? "offeredRate" : "concurrency", r.level)
+                .field("throughput", (r.requests - r.errors) / config.duration)
+                .field("p99Ms", ms(r.latency.value_at_quantile(0.99)))
+                .end_object();
+        }
+        json.end_object().newline();
+        json.flush();
+
+        if (fd != STDOUT_FILENO)
+            ::close(fd);
+    }
+    catch (const std::exception &e)
+    {
+        JsonWriter json(STDERR_FILENO);
+        json.begin_object().field("error", e.what()).end_object().newline();
+        json.flush();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "bench_harness.h"
+#include "engine.h"
+#include "json_writer.h"
+#include "kernels.h"
+
+// Reference contract used by every kernel (S0 = K = 100, r = 5%, sigma = 20%, T = 1)
+constexpr double BENCH_S0 = 100.0;
+constexpr double BENCH_K = 100.0;
+constexpr double BENCH_R = 0.05;
+constexpr double BENCH_SIGMA = 0.2;
+constexpr double BENCH_T = 1.0;
+
+// Path stepping uses a 252-step (daily) grid over T
+constexpr int BENCH_TIME_STEPS = 252;
+
+// Array sizes for the isolated kernels: L1-resident, L2-resident and memory-bound
+const long KERNEL_SIZES[] = {4096, 65536, 1048576};
+
+// Trial counts for end-to-end pricing
+const int PRICING_SIZES[] = {10000, 100000, 1000000};
+
+struct BenchConfig
+{
+    std::string filter;
+    double min_time = 0.2; // seconds per repetition
+    int repetitions = 10;
+    std::string output;    // empty = stdout
+};
+
+static BenchConfig parse_bench_args(int argc, char *argv[])
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--filter")
+            config.filter = value;
+        else if (key == "--min-time")
+            config.min_time = std::stod(value);
+        else if (key == "--repetitions")
+            config.repetitions = std::stoi(value);
+        else if (key == "--out")
+            config.output = value;
+        else
+            throw std::invalid_argument("Unknown option: " + key);
+    }
+    if (config.min_time <= 0.0)
+        throw std::invalid_argument("--min-time must be positive");
+    if (config.repetitions < 1)
+        throw std::invalid_argument("--repetitions must be at least 1");
+    return config;
+}
+
+// Isolated kernels operate on shared arena buffers filled once up front
+struct KernelBuffers
+{
+    double *normals;
+    double *terminal;
+    double *payoffs;
+    double *paths;
+};
+
+static void add_kernel_benchmarks(std::vector<Benchmark> &benchmarks, long n, const KernelBuffers &buffers)
+{
+    const double drift = (BENCH_R - 0.5 * BENCH_SIGMA * BENCH_SIGMA) * BENCH_T;
+    const double volatility = BENCH_SIGMA * std::sqrt(BENCH_T);
+    const std::string size = "/" + std::to_string(n);
+
+    benchmarks.push_back({"normals/lane_box_muller" + size, n, [=](long iterations)
+                          {
+                              LaneRng rng(42);
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  fill_normals(rng, buffers.normals, n);
+                                  clobber_memory();
+                              }
+                          }});
+
+    // The single-threaded engine's generator, for comparison
+    benchmarks.push_back({"normals/mt19937_normal_distribution" + size, n, [=](long iterations)
+                          {
+                              std::mt19937_64 gen(42);
+                              std::normal_distribution<> norm_dist(0.0, 1.0);
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  for (long i = 0; i < n; ++i)
+                                      buffers.terminal[i] = norm_dist(gen);
+                                  clobber_memory();
+                              }
+                          }});
+
+    benchmarks.push_back({"exp/terminal_price" + size, n, [=](long iterations)
+                          {
+                              for (long it = 0; it < iterations; ++it)
+                              {
+#pragma GCC unroll 1
+                                  for (long i = 0; i < n; ++i)
+                                      buffers.terminal[i] = BENCH_S0 * std::exp(drift + volatility * buffers.normals[i]);
+                                  clobber_memory();
+                              }
+                          }});
+
+    benchmarks.push_back({"payoff/call" + size, n, [=](long iterations)
+                          {
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  for (long i = 0; i < n; ++i)
+                                      buffers.payoffs[i] = calculate_payoff(buffers.terminal[i], BENCH_K, true);
+                                  clobber_memory();
+                              }
+                          }});
+
+    benchmarks.push_back({"reduction/sum_and_squares" + size, n, [=](long iterations)
+                          {
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  double sum = 0.0, sum_squared = 0.0;
+                                  for (long i = 0; i < n; ++i)
+                                  {
+                                      sum += buffers.payoffs[i];
+                                      sum_squared += buffers.payoffs[i] * buffers.payoffs[i];
+                                  }
+                                  do_not_optimize(sum);
+                                  do_not_optimize(sum_squared);
+                              }
+                          }});
+
+    // One time step across n paths (items = path-steps)
+    const double dt = BENCH_T / BENCH_TIME_STEPS;
+    const double drift_dt = (BENCH_R - 0.5 * BENCH_SIGMA * BENCH_SIGMA) * dt;
+    const double vol_sqrt_dt = BENCH_SIGMA * std::sqrt(dt);
+    benchmarks.push_back({"path_step/gbm" + size, n, [=](long iterations)
+                          {
+                              for (long i = 0; i < n; ++i)
+                                  buffers.paths[i] = BENCH_S0;
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  gbm_step(buffers.paths, buffers.normals, n, drift_dt, vol_sqrt_dt);
+                                  clobber_memory();
+                              }
+                          }});
+
+    benchmarks.push_back({"fused/f64" + size, n, [=](long iterations)
+                          {
+                              LaneRng rng(42);
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  double sum = 0.0, sum_squared = 0.0;
+                                  fused_gbm_payoff(rng, n, BENCH_S0, BENCH_K, drift, volatility, true, sum, sum_squared);
+                                  do_not_optimize(sum);
+                                  do_not_optimize(sum_squared);
+                              }
+                          }});
+
+    benchmarks.push_back({"fused/f32" + size, n, [=](long iterations)
+                          {
+                              LaneRngF32 rng(42);
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  double sum = 0.0, sum_squared = 0.0;
+                                  fused_gbm_payoff_f32(rng, n, BENCH_S0, BENCH_K, drift, volatility, true, sum, sum_squared);
+                                  do_not_optimize(sum);
+                                  do_not_optimize(sum_squared);
+                              }
+                          }});
+}
+
+static void add_pricing_benchmarks(std::vector<Benchmark> &benchmarks, int numTrials)
+{
+    const std::string size = "/" + std::to_string(numTrials);
+
+    benchmarks.push_back({"pricing/single_thread" + size, numTrials, [=](long iterations)
+                          {
+                              for (long it = 0; it < iterations; ++it)
+                              {
+                                  double price, lower, upper;
+                                  monte_carlo_black_scholes(BENCH_S0, BENCH_K, BENCH_R, BENCH_SIGMA, BENCH_T, true,
+                                                            numTrials, price, lower, upper);
+                                  do_not_optimize(price);
+                              }
+                          }});
+
+    for (Precision precision : {Precision::Double, Precision::Single})
+    {
+        SimulationOptions options;
+        options.precision = precision;
+        const std::string name = precision == Precision::Single ? "pricing/mt_f32" : "pricing/mt_f64";
+        benchmarks.push_back({name + size, numTrials, [=](long iterations)
+                              {
+                                  for (long it = 0; it < iterations; ++it)
+                                  {
+                                      double price, lower, upper;
+                                      monte_carlo_black_scholes_mt(BENCH_S0, BENCH_K, BENCH_R, BENCH_SIGMA, BENCH_T, true,
+                                                                   numTrials, 0, price, lower, upper, options);
+                                      do_not_optimize(price);
+                                  }
+                              }});
+    }
+}
+
+// First "model name" line of /proc/cpuinfo, if present
+static std::string cpu_model()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.compare(0, 10, "model name") == 0)
+        {
+            const size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                return line.substr(colon + 2);
+        }
+    }
+    return "unknown";
+}
+
+// Widest vector ISA the build was compiled for
+static const char *compiled_isa()
+{
+#if defined(__AVX512F__)
+    return "avx512f";
+#elif defined(__AVX2__)
+    return "avx2";
+#elif defined(__AVX__)
+    return "avx";
+#elif defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+static const char *arena_backing_name(ArenaBacking backing)
+{
+    switch (backing)
+    {
+    case ArenaBacking::HugeTLB:
+        return "hugetlb";
+    case ArenaBacking::TransparentHuge:
+        return "thp";
+    default:
+        return "regular";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        const BenchConfig config = parse_bench_args(argc, argv);
+
+        // Buffers for the largest kernel size, shared by all isolated kernels
+        const long max_size = KERNEL_SIZES[sizeof(KERNEL_SIZES) / sizeof(KERNEL_SIZES[0]) - 1];
+        Arena arena(4 * max_size * sizeof(double) + 4 * 4096);
+        KernelBuffers buffers{arena.allocate<double>(max_size), arena.allocate<double>(max_size),
+                              arena.allocate<double>(max_size), arena.allocate<double>(max_size)};
+        LaneRng seed_rng(7);
+        fill_normals(seed_rng, buffers.normals, max_size);
+        for (long i = 0; i < max_size; ++i)
+        {
+            buffers.terminal[i] = BENCH_S0 * std::exp(0.2 * buffers.normals[i]);
+            buffers.payoffs[i] = calculate_payoff(buffers.terminal[i], BENCH_K, true);
+        }
+
+        std::vector<Benchmark> benchmarks;
+        for (long n : KERNEL_SIZES)
+            add_kernel_benchmarks(benchmarks, n, buffers);
+        for (int numTrials : PRICING_SIZES)
+            add_pricing_benchmarks(benchmarks, numTrials);
+
+        int fd = STDOUT_FILENO;
+        if (!config.output.empty())
+        {
+            fd = ::open(config.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open output file: " + config.output);
+        }
+
+        JsonWriter json(fd);
+        json.begin_object().key("context").begin_object()
+            .field("cpu", cpu_model())
+            .field("hardwareThreads", static_cast<int>(std::thread::hardware_concurrency()))
+            .field("isa", compiled_isa())
+#if defined(__VERSION__)
+            .field("compiler", __VERSION__)
+#endif
+            .field("arenaBacking", arena_backing_name(arena.backing()))
+            .field("minTime", config.min_time)
+            .field("repetitions", config.repetitions)
+            .end_object();
+
+        json.key("benchmarks").begin_array();
+        for (const Benchmark &benchmark : benchmarks)
+        {
+            if (!config.filter.empty() && benchmark.name.find(config.filter) == std::string::npos)
+                continue;
+
+            std::fprintf(stderr, "%s\n", benchmark.name.c_str());
+            const BenchmarkSample sample = run_benchmark_case(benchmark, config.min_time * 1e9, config.repetitions);
+
+            json.begin_object()
+                .field("name", sample.name)
+                .field("itemsPerIteration", sample.items_per_iteration)
+                .field("iterations", sample.iterations)
+                .field("nsPerItem", sample.median_ns_per_item)
+                .field("nsPerItemMin", sample.min_ns_per_item)
+                .field("nsPerItemMax", sample.max_ns_per_item)
+                .field("nsPerItemStddev", sample.stddev_ns_per_item)
+                .field("itemsPerSecond", 1e9 / sample.median_ns_per_item);
+            json.key("samples").begin_array();
+            for (double ns : sample.ns_per_item)
+                json.value(ns);
+            json.end_array().end_object();
+        }
+        json.end_array().end_object().newline();
+        json.flush();
+
+        if (fd != STDOUT_FILENO)
+            ::close(fd);
+    }
+    catch (const std::exception &e)
+    {
+        JsonWriter json(STDERR_FILENO);
+        json.begin_object().field("error", e.what()).end_object().newline();
+        json.flush();
+        return 1;
+    }
+
+    return 0;
+}
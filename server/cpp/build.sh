@@ -8,7 +8,9 @@ cd build
 cmake ..
 make -j$(nproc 2>/dev/null || sysctl -n hw.ncpu)
 
-# Copy executable to parent directory
-cp monte_carlo ../monte_carlo
+# Copy executable to parent directory. Rename over the old one so a running server's
+# engine pool never sees (or runs) a half-written binary.
+cp monte_carlo ../monte_carlo.tmp
+mv -f ../monte_carlo.tmp ../monte_carlo
 
 echo "Build completed. Executable is at: $(pwd)/../monte_carlo" 
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+
+// Closed-form Black-Scholes, C++ port of server/utils/black_scholes_analytical.js. The normal
+// CDF uses erfc (full double precision) instead of the JS file's A&S 7.1.26 approximation
+// (~1e-7 absolute error), so it can serve as the reference price when measuring estimator bias.
+
+constexpr double SQRT_HALF = 0.70710678118654752440;
+
+inline double normal_cdf(double x)
+{
+    return 0.5 * std::erfc(-x * SQRT_HALF);
+}
+
+// Inverse standard normal CDF: Acklam's rational approximation (relative error ~1e-9)
+// refined with one Halley step against erfc, accurate to near machine precision on (0, 1)
+inline double inverse_normal_cdf(double p)
+{
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    constexpr double P_LOW = 0.02425;
+
+    double x;
+    if (p < P_LOW)
+    {
+        const double q = std::sqrt(-2.0 * std::log(p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    else if (p <= 1.0 - P_LOW)
+    {
+        const double q = p - 0.5;
+        const double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    }
+    else
+    {
+        const double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    // Halley refinement
+    const double e = normal_cdf(x) - p;
+    const double u = e * std::sqrt(2.0 * 3.14159265358979323846) * std::exp(0.5 * x * x);
+    return x - u / (1.0 + 0.5 * x * u);
+}
+
+// Black-Scholes price of a European call or put
+inline double black_scholes_analytical(double S0, double K, double r, double sigma, double T, bool isCall)
+{
+    const double sqrt_T = std::sqrt(T);
+    const double d1 = (std::log(S0 / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt_T);
+    const double d2 = d1 - sigma * sqrt_T;
+    const double discount = std::exp(-r * T);
+
+    if (isCall)
+        return S0 * normal_cdf(d1) - K * discount * normal_cdf(d2);
+    return K * discount * normal_cdf(-d2) - S0 * normal_cdf(-d1);
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Huge page size used by x86-64 and aarch64 Linux for both hugetlbfs and THP
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Default reservation per worker - large enough for a few million doubles
+constexpr std::size_t DEFAULT_ARENA_BYTES = 16 * HUGE_PAGE_SIZE;
+
+// How the memory behind an arena block was obtained
+enum class ArenaBacking
+{
+    HugeTLB,         // Explicit 2 MB pages from the hugetlbfs pool
+    TransparentHuge, // Regular mapping with MADV_HUGEPAGE, 2 MB aligned
+    Regular          // Plain heap memory (non-Linux or mmap failure)
+};
+
+// Bump-pointer allocator for large transient per-job buffers (paths, payoffs, scratch).
+// Memory is only returned to the OS when the arena is destroyed, so after the first
+// job the hot loops run on already-faulted pages with few TLB entries.
+class Arena
+{
+public:
+    explicit Arena(std::size_t reserve_bytes = DEFAULT_ARENA_BYTES)
+        : reserve_bytes_(round_up(std::max<std::size_t>(reserve_bytes, HUGE_PAGE_SIZE), HUGE_PAGE_SIZE))
+    {
+    }
+
+    ~Arena()
+    {
+        for (auto &block : blocks_)
+        {
+            release_block(block);
+        }
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Allocate uninitialized storage for count objects of trivially destructible type T
+    template <typename T>
+    T *allocate(std::size_t count, std::size_t alignment = 64)
+    {
+        alignment = std::max(alignment, alignof(T));
+        return static_cast<T *>(allocate_bytes(count * sizeof(T), alignment));
+    }
+
+    void *allocate_bytes(std::size_t bytes, std::size_t alignment = 64)
+    {
+        // First allocation of a job after the last one spilled into several blocks: coalesce
+        // them into one so a job of the same size stays contiguous (nothing is live yet)
+        if (blocks_.size() > 1 && current_ == 0 && blocks_[0].used == 0)
+        {
+            coalesce();
+        }
+
+        if (!blocks_.empty())
+        {
+            Block &block = blocks_[current_];
+            std::size_t offset = round_up(block.used, alignment);
+            if (offset + bytes <= block.size)
+            {
+                block.used = offset + bytes;
+                return block.base + offset;
+            }
+
+            // Reuse a later block left over from a previous job if it is big enough
+            while (current_ + 1 < blocks_.size())
+            {
+                Block &next = blocks_[++current_];
+                next.used = 0;
+                if (bytes <= next.size)
+                {
+                    next.used = bytes;
+                    return next.base;
+                }
+            }
+        }
+
+        // Grow geometrically so a job needing more than the reservation causes few mappings
+        std::size_t size = reserve_bytes_;
+        if (!blocks_.empty())
+        {
+            size = std::max(size, blocks_.back().size * 2);
+        }
+        size = round_up(std::max(size, bytes), HUGE_PAGE_SIZE);
+
+        blocks_.push_back(acquire_block(size));
+        current_ = blocks_.size() - 1;
+        blocks_[current_].used = bytes;
+        return blocks_[current_].base;
+    }
+
+    // Position of the next allocation, for rewinding a scope's allocations with rewind()
+    struct Mark
+    {
+        std::size_t block;
+        std::size_t used;
+    };
+
+    Mark mark() const
+    {
+        return blocks_.empty() ? Mark{0, 0} : Mark{current_, blocks_[current_].used};
+    }
+
+    // Release everything allocated since m. Never allocates or frees, so it is safe in
+    // destructors; later blocks are reused as the arena grows again.
+    void rewind(Mark m) noexcept
+    {
+        if (blocks_.empty())
+            return;
+        current_ = m.block;
+        blocks_[current_].used = m.used;
+    }
+
+    // Rewind to empty. Blocks are kept (and coalesced by the next allocation).
+    void reset() noexcept
+    {
+        rewind(Mark{0, 0});
+    }
+
+    std::size_t bytes_reserved() const
+    {
+        std::size_t total = 0;
+        for (const auto &block : blocks_)
+        {
+            total += block.size;
+        }
+        return total;
+    }
+
+    // Backing of the first block (ArenaBacking::Regular until something is allocated)
+    ArenaBacking backing() const
+    {
+        return blocks_.empty() ? ArenaBacking::Regular : blocks_.front().backing;
+    }
+
+private:
+    struct Block
+    {
+        char *base;
+        std::size_t size;
+        std::size_t used;
+        std::size_t mapped_size; // Size passed to munmap (0 for heap blocks)
+        char *mapped_base;
+        ArenaBacking backing;
+    };
+
+    static std::size_t round_up(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void coalesce()
+    {
+        std::size_t total = 0;
+        for (auto &block : blocks_)
+        {
+            total += block.size;
+        }
+        Block merged = acquire_block(total);
+        for (auto &block : blocks_)
+        {
+            release_block(block);
+        }
+        blocks_.clear();
+        blocks_.push_back(merged);
+        current_ = 0;
+    }
+
+    static Block acquire_block(std::size_t size)
+    {
+#if defined(__linux__)
+        // 1. Explicit huge pages - only succeeds when the admin reserved a hugetlbfs pool
+#ifdef MAP_HUGETLB
+        void *huge = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED)
+        {
+            return {static_cast<char *>(huge), size, 0, size, static_cast<char *>(huge), ArenaBacking::HugeTLB};
+        }
+#endif
+
+        // 2. Over-map by one huge page so the block can start on a 2 MB boundary,
+        //    which is required for the kernel to back it with transparent huge pages
+        const std::size_t mapped_size = size + HUGE_PAGE_SIZE;
+        void *raw = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw != MAP_FAILED)
+        {
+            char *mapped_base = static_cast<char *>(raw);
+            char *base = reinterpret_cast<char *>(
+                round_up(reinterpret_cast<std::uintptr_t>(mapped_base), HUGE_PAGE_SIZE));
+#ifdef MADV_HUGEPAGE
+            madvise(base, size, MADV_HUGEPAGE);
+#endif
+            return {base, size, 0, mapped_size, mapped_base, ArenaBacking::TransparentHuge};
+        }
+#endif
+
+        // 3. Portable fallback
+        char *base = static_cast<char *>(::operator new(size, std::align_val_t(HUGE_PAGE_SIZE)));
+        return {base, size, 0, 0, nullptr, ArenaBacking::Regular};
+    }
+
+    static void release_block(Block &block)
+    {
+#if defined(__linux__)
+        if (block.mapped_size != 0)
+        {
+            munmap(block.mapped_base, block.mapped_size);
+            return;
+        }
+#endif
+        ::operator delete(block.base, std::align_val_t(HUGE_PAGE_SIZE));
+    }
+
+    std::size_t reserve_bytes_;
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0;
+};
+
+// Write one byte in each page of a buffer, so its page faults happen now rather than in the
+// first loop that uses it (volatile, so the stores are not dropped as dead)
+inline void prefault(void *data, std::size_t bytes)
+{
+    if (bytes == 0)
+        return;
+    volatile char *bytes_ptr = static_cast<volatile char *>(data);
+    for (std::size_t offset = 0; offset < bytes; offset += 4096)
+        bytes_ptr[offset] = 0;
+    bytes_ptr[bytes - 1] = 0;
+}
+
+// Per-worker arena. Threads that live across jobs keep their faulted pages.
+inline Arena &worker_arena()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+// Releases the allocations made during its lifetime, so scopes nest: an inner scope (a
+// contract priced inside a batch worker) leaves the outer scope's buffers alone
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena &arena) : arena_(arena), mark_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(mark_); }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    Arena &arena_;
+    Arena::Mark mark_;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary framing used by server mode (--serve) once a connection negotiates "HELLO binary".
+// Every message is a FrameHeader followed by payload_bytes of payload. All structs are
+// fixed-layout little-endian with natural alignment, so both sides can read them in place;
+// payloads start 8-byte aligned and result vectors are stored columnar (all prices, then
+// all lower bounds, then all upper bounds) for zero-copy Float64Array views in Node.
+//
+// The layout is mirrored in server/utils/engine_connection.js - keep the two in sync.
+
+constexpr uint32_t FRAME_MAGIC = 0x3142434D; // "MCB1" read as little-endian bytes
+constexpr uint16_t PROTOCOL_VERSION = 1;
+
+enum FrameType : uint16_t
+{
+    // Requests
+    FRAME_PRICE_REQUEST = 0x01,
+    FRAME_BATCH_REQUEST = 0x02,
+    FRAME_PING = 0x03,
+    FRAME_STATS_REQUEST = 0x04, // Empty payload
+    FRAME_PATHS_REQUEST = 0x05,
+
+    // Responses (request type | 0x80)
+    FRAME_PRICE_RESULT = 0x81,
+    FRAME_BATCH_RESULT = 0x82,
+    FRAME_PONG = 0x83,
+    FRAME_STATS_RESULT = 0x84,
+    FRAME_PATHS_RESULT = 0x85,
+    FRAME_ERROR = 0xFF, // Payload is a UTF-8 message
+
+    // Price responses with REQUEST_FLAG_TIMING/CONVERGENCE/DISTRIBUTION/PROGRESS set
+    FRAME_PROGRESS = 0x90,            // ProgressPayload; any number, ahead of the result
+    FRAME_PRICE_DETAIL_RESULT = 0x91  // PriceResultPayload, PriceDetailHeader, then the details
+};
+
+// Request flags
+constexpr uint32_t REQUEST_FLAG_SINGLE_PRECISION = 1u << 0;
+constexpr uint32_t REQUEST_FLAG_TRACE = 1u << 1; // Request ends with a TraceContextPayload
+// Price requests only: the same reports as the --timing, --convergence, --distribution and
+// --progress flags of the JSON protocol, with their default settings
+constexpr uint32_t REQUEST_FLAG_TIMING = 1u << 2;
+constexpr uint32_t REQUEST_FLAG_CONVERGENCE = 1u << 3;
+constexpr uint32_t REQUEST_FLAG_DISTRIBUTION = 1u << 4;
+constexpr uint32_t REQUEST_FLAG_PROGRESS = 1u << 5;
+
+struct FrameHeader
+{
+    uint32_t magic;
+    uint16_t type;
+    uint16_t version;
+    uint32_t request_id;
+    uint32_t payload_bytes;
+};
+
+struct PriceRequestPayload
+{
+    double S0;
+    double K;
+    double r;
+    double sigma;
+    double T;
+    int32_t isCall;
+    int32_t numTrials;
+    int32_t threads; // <= 0 for automatic
+    uint32_t flags;
+};
+
+struct PriceResultPayload
+{
+    double price;
+    double lower;
+    double upper;
+    int32_t threadsUsed;
+    uint32_t cpuMicros; // Process CPU time of the job (all its threads), microseconds
+};
+
+// Price result with details: PriceResultPayload, PriceDetailHeader, then a UTF-8 JSON object
+// of json_bytes with whichever of "timing", "convergence" and "distribution" were requested
+// (as in the JSON protocol's price response), padded with spaces to a multiple of 8 bytes
+struct PriceDetailHeader
+{
+    uint32_t json_bytes; // Without the padding
+    uint32_t reserved;
+};
+
+// Running estimate of a price request with REQUEST_FLAG_PROGRESS
+struct ProgressPayload
+{
+    int64_t paths; // Simulated so far
+    int64_t totalPaths;
+    double price;
+    double lower;
+    double upper;
+};
+
+// Batch request: BatchRequestHeader followed by count BatchContractPayload records
+struct BatchRequestHeader
+{
+    uint32_t count;
+    int32_t numTrials;
+    int32_t threads;
+    uint32_t flags;
+};
+
+struct BatchContractPayload
+{
+    double S0;
+    double K;
+    double r;
+    double sigma;
+    double T;
+    int32_t isCall;
+    uint32_t reserved;
+};
+
+// Batch result: BatchResultHeader followed by double prices[count], lower[count], upper[count]
+struct BatchResultHeader
+{
+    uint32_t count;
+    int32_t threadsUsed;
+};
+
+// Sample paths request: GBM paths for plotting, each downsampled to `points` points (LTTB)
+struct PathsRequestPayload
+{
+    double S0;
+    double r;
+    double sigma;
+    double T;
+    uint64_t seed; // 0 picks one from the clock
+    int32_t count;
+    int32_t steps;
+    int32_t points;
+    uint32_t flags;
+};
+
+// Sample paths result: PathsResultHeader followed by float times[count * points], then
+// float prices[count * points], both path-major
+struct PathsResultHeader
+{
+    uint32_t count;
+    uint32_t points;
+};
+
+// Engine counters since start-up (also available as "<id> stats" in JSON mode)
+struct StatsPayload
+{
+    double uptimeSeconds;
+    double cpuSeconds;       // User + system time of the whole process
+    uint64_t requestsTotal;  // Requests received, including pings and rejected ones
+    uint64_t jobsCompleted;
+    uint64_t jobsFailed;
+    uint64_t pathsTotal;     // Paths simulated by completed jobs
+    uint32_t queueDepth;     // Jobs waiting for the executor
+    uint32_t inFlight;       // Jobs executing (0 or 1)
+};
+
+// Latency summaries follow the StatsPayload in a stats response: REQUEST_CLASS_COUNT x
+// LATENCY_STAGE_COUNT LatencySummaryPayload records, class-major
+enum RequestClass : uint32_t
+{
+    REQUEST_CLASS_PRICE,
+    REQUEST_CLASS_BATCH,
+    REQUEST_CLASS_PATHS,
+    REQUEST_CLASS_COUNT
+};
+
+enum LatencyStage : uint32_t
+{
+    LATENCY_QUEUE_WAIT, // Queued until the executor picks the job up
+    LATENCY_SERVICE,    // Executor start until the response is written
+    LATENCY_END_TO_END, // Reader receiving the request until the response is written
+    LATENCY_STAGE_COUNT
+};
+
+// Since start-up, in microseconds, from HDR histograms (within 0.8%)
+struct LatencySummaryPayload
+{
+    uint64_t count;
+    double p50;
+    double p99;
+    double p999;
+    double max;
+};
+
+// Trace extension. A request with REQUEST_FLAG_TRACE appends the caller's W3C trace context to
+// its payload; the response then appends a TraceResultHeader and span_count TraceSpanPayload
+// records after its usual payload. Ids are in traceparent byte order.
+struct TraceContextPayload
+{
+    uint8_t trace_id[16];
+    uint8_t parent_span_id[8];
+};
+
+struct TraceResultHeader
+{
+    uint32_t span_count;
+    uint32_t reserved;
+};
+
+struct TraceSpanPayload
+{
+    uint8_t span_id[8];
+    uint8_t parent_span_id[8];
+    uint64_t startUnixNano;
+    uint64_t endUnixNano;
+    uint32_t kind; // TraceSpanKind (include/trace_context.h)
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FrameHeader) == 16, "FrameHeader layout changed");
+static_assert(sizeof(PriceRequestPayload) == 56, "PriceRequestPayload layout changed");
+static_assert(sizeof(PriceResultPayload) == 32, "PriceResultPayload layout changed");
+static_assert(sizeof(PriceDetailHeader) == 8, "PriceDetailHeader layout changed");
+static_assert(sizeof(ProgressPayload) == 40, "ProgressPayload layout changed");
+static_assert(sizeof(BatchRequestHeader) == 16, "BatchRequestHeader layout changed");
+static_assert(sizeof(BatchContractPayload) == 48, "BatchContractPayload layout changed");
+static_assert(sizeof(BatchResultHeader) == 8, "BatchResultHeader layout changed");
+static_assert(sizeof(PathsRequestPayload) == 56, "PathsRequestPayload layout changed");
+static_assert(sizeof(PathsResultHeader) == 8, "PathsResultHeader layout changed");
+static_assert(sizeof(StatsPayload) == 56, "StatsPayload layout changed");
+static_assert(sizeof(LatencySummaryPayload) == 40, "LatencySummaryPayload layout changed");
+static_assert(sizeof(TraceContextPayload) == 24, "TraceContextPayload layout changed");
+static_assert(sizeof(TraceResultHeader) == 8, "TraceResultHeader layout changed");
+static_assert(sizeof(TraceSpanPayload) == 40, "TraceSpanPayload layout changed");
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary protocol assumes a little-endian host"
+#endif
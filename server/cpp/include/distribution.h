@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "kernels.h"
+
+// Default bin count of --distribution histograms, and the largest accepted
+constexpr int DISTRIBUTION_DEFAULT_BINS = 50;
+constexpr int DISTRIBUTION_MAX_BINS = 10000;
+
+// Accuracy parameter of the quantile sketch: rank error is about 1.7 / k (0.2% at 800, so the
+// 1st and 99th percentiles stay meaningful). Memory is about 3k doubles per worker.
+constexpr int KLL_DEFAULT_K = 800;
+// Smallest level capacity: keeps low levels from compacting on every insert once the sketch is deep
+constexpr size_t KLL_MIN_LEVEL_CAPACITY = 8;
+
+// Fixed-bin histogram over [lower, upper). Values outside the range are counted in below/above.
+// Workers share the range, so merging is adding counts.
+class FixedHistogram
+{
+public:
+    FixedHistogram() = default;
+
+    FixedHistogram(double lower, double upper, int bins)
+        : lower_(lower), upper_(upper), scale_(bins / (upper - lower)), counts_(bins)
+    {
+    }
+
+    void add(double value)
+    {
+        if (value < lower_)
+        {
+            below_++;
+            return;
+        }
+        const long bin = static_cast<long>((value - lower_) * scale_);
+        if (bin >= static_cast<long>(counts_.size()))
+        {
+            above_++;
+            return;
+        }
+        counts_[bin]++;
+    }
+
+    void merge(const FixedHistogram &other)
+    {
+        for (size_t i = 0; i < counts_.size(); i++)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        below_ += other.below_;
+        above_ += other.above_;
+    }
+
+    double lower() const { return lower_; }
+    double upper() const { return upper_; }
+    const std::vector<uint64_t> &counts() const { return counts_; }
+    uint64_t below() const { return below_; }
+    uint64_t above() const { return above_; }
+
+private:
+    double lower_ = 0.0;
+    double upper_ = 1.0;
+    double scale_ = 1.0;
+    std::vector<uint64_t> counts_;
+    uint64_t below_ = 0;
+    uint64_t above_ = 0;
+};
+
+// KLL quantile sketch (Karnin, Lang, Liberty 2016). Level h holds items of weight 2^h. When the
+// sketch is full, every other item (odd or even positions, chosen at random) of the lowest
+// level over its capacity moves up a level. Capacities shrink by 2/3 per level below the top,
+// so memory is O(k) plus a few items per level, whatever the stream length. Level 0 is sorted
+// when it compacts; higher levels are kept sorted by merging. Sketches built from disjoint
+// streams merge level by level.
+class KllSketch
+{
+public:
+    explicit KllSketch(int k = KLL_DEFAULT_K, uint64_t seed = 1) : k_(k), random_state_(seed)
+    {
+        grow();
+    }
+
+    void add(double value)
+    {
+        levels_[0].push_back(value);
+        count_++;
+        if (++size_ >= max_size_)
+            compress();
+    }
+
+    void merge(const KllSketch &other)
+    {
+        while (levels_.size() < other.levels_.size())
+            grow();
+        for (size_t h = 0; h < other.levels_.size(); h++)
+        {
+            std::vector<double> &level = levels_[h];
+            const size_t middle = level.size();
+            level.insert(level.end(), other.levels_[h].begin(), other.levels_[h].end());
+            if (h > 0)
+                std::inplace_merge(level.begin(), level.begin() + middle, level.end());
+        }
+        count_ += other.count_;
+        size_ += other.size_;
+        while (size_ >= max_size_)
+            compress();
+    }
+
+    uint64_t count() const { return count_; }
+
+    // Value at rank q * count (q in [0, 1]); NaN for an empty sketch
+    double quantile(double q) const
+    {
+        std::vector<std::pair<double, uint64_t>> weighted;
+        weighted.reserve(size_);
+        for (size_t h = 0; h < levels_.size(); h++)
+        {
+            for (double value : levels_[h])
+                weighted.emplace_back(value, uint64_t(1) << h);
+        }
+        if (weighted.empty())
+            return std::nan("");
+        std::sort(weighted.begin(), weighted.end());
+
+        uint64_t total = 0;
+        for (const auto &item : weighted)
+            total += item.second;
+        const double target = q * total;
+        uint64_t rank = 0;
+        for (const auto &item : weighted)
+        {
+            rank += item.second;
+            if (rank >= target)
+                return item.first;
+        }
+        return weighted.back().first;
+    }
+
+private:
+    // Level capacities depend on the level count, so they are recomputed (and cached) on growth
+    void grow()
+    {
+        levels_.emplace_back();
+        capacities_.resize(levels_.size());
+        max_size_ = 0;
+        for (size_t h = 0; h < levels_.size(); h++)
+        {
+            const double depth = static_cast<double>(levels_.size() - h - 1);
+            capacities_[h] = std::max(KLL_MIN_LEVEL_CAPACITY, static_cast<size_t>(std::ceil(k_ * std::pow(2.0 / 3.0, depth))));
+            max_size_ += capacities_[h];
+        }
+    }
+
+    void compress()
+    {
+        for (size_t h = 0; h < levels_.size(); h++)
+        {
+            if (levels_[h].size() < capacities_[h])
+                continue;
+            if (h + 1 == levels_.size())
+                grow();
+
+            // Promote every other item of the sorted level; an odd one out stays behind
+            std::vector<double> &level = levels_[h];
+            std::vector<double> &next = levels_[h + 1];
+            if (h == 0)
+                std::sort(level.begin(), level.end());
+            const size_t pairs = level.size() / 2;
+            const size_t offset = splitmix64(random_state_) & 1;
+            const size_t middle = next.size();
+            for (size_t i = 0; i < pairs; i++)
+            {
+                next.push_back(level[2 * i + offset]);
+            }
+            std::inplace_merge(next.begin(), next.begin() + middle, next.end());
+            const bool odd = level.size() % 2 != 0;
+            const double leftover = odd ? level.back() : 0.0;
+            level.clear();
+            if (odd)
+                level.push_back(leftover);
+            size_ -= pairs;
+            if (size_ < max_size_)
+                break;
+        }
+    }
+
+    int k_;
+    uint64_t random_state_;
+    std::vector<std::vector<double>> levels_;
+    std::vector<size_t> capacities_;
+    size_t size_ = 0;
+    size_t max_size_ = 0;
+    uint64_t count_ = 0;
+};
+
+// Terminal-price and (undiscounted) payoff distributions of a job (--distribution). Both get a
+// fixed-bin histogram, but only terminal prices are sketched: the payoff is monotone in the
+// terminal price (rising for calls, falling for puts), so payoff quantiles are the payoffs of
+// terminal-price quantiles, which halves the per-path sketch cost.
+struct PathDistribution
+{
+    FixedHistogram terminal_price;
+    FixedHistogram payoff;
+    KllSketch sketch; // Terminal prices
+    double K = 0.0;
+    bool isCall = true;
+
+    PathDistribution() = default;
+    PathDistribution(double price_lower, double price_upper, double max_payoff, int bins, double K, bool isCall,
+                     uint64_t seed)
+        : terminal_price(price_lower, price_upper, bins), payoff(0.0, max_payoff, bins), sketch(KLL_DEFAULT_K, seed),
+          K(K), isCall(isCall)
+    {
+    }
+
+    void add(double ST, double path_payoff)
+    {
+        terminal_price.add(ST);
+        payoff.add(path_payoff);
+        sketch.add(ST);
+    }
+
+    void merge(const PathDistribution &other)
+    {
+        terminal_price.merge(other.terminal_price);
+        payoff.merge(other.payoff);
+        sketch.merge(other.sketch);
+    }
+
+    uint64_t count() const { return sketch.count(); }
+
+    double terminal_price_quantile(double q) const { return sketch.quantile(q); }
+
+    double payoff_quantile(double q) const
+    {
+        return calculate_payoff(sketch.quantile(isCall ? q : 1.0 - q), K, isCall);
+    }
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "distribution.h"
+#include "kernels.h"
+#include "path_dump.h"
+#include "perf_counters.h"
+#include "phase_timer.h"
+#include "trace_context.h"
+
+// Measurements from one worker thread of a job
+struct WorkerReport
+{
+    int worker;
+    long paths;
+    PerfCounts counters; // Filled when SimulationOptions::perf_counters is set
+    PhaseTimes phases;   // threadStart, rng and pathEvaluation when SimulationOptions::timing is set
+};
+
+// Per-job instrumentation sink, filled by the multi-threaded engine when attached to the options
+struct JobInstrumentation
+{
+    std::vector<WorkerReport> workers;
+    PhaseTimes phases; // Job-level phases (validate, reduction) when SimulationOptions::timing is set
+};
+
+// Running estimate of a job that is still simulating
+struct ProgressReport
+{
+    long paths;      // Paths simulated so far
+    long totalPaths; // Paths in the job
+    double price;
+    double lower;
+    double upper;
+};
+
+// Estimate over the first `paths` paths of a job (--convergence)
+struct ConvergencePoint
+{
+    long paths;
+    double price;
+    double lower;
+    double upper;
+};
+
+// Defaults of --progress and --convergence without a value
+constexpr double PROGRESS_DEFAULT_INTERVAL_MS = 100.0;
+constexpr long CONVERGENCE_DEFAULT_START = 1000;
+
+// Optional engine settings passed as --key=value flags after the positional arguments
+struct SimulationOptions
+{
+    Precision precision = Precision::Double;
+    bool perf_counters = false;                    // --perf-counters
+    bool timing = false;                           // --timing: per-phase breakdown (split kernel)
+    JobInstrumentation *instrumentation = nullptr; // Receives per-worker reports when set
+    TraceContext trace;                            // --trace=<traceparent>: report engine spans
+    double progress_interval_ms = 0.0;             // --progress[=ms]: report running estimates this often
+    std::function<void(const ProgressReport &)> on_progress; // Receives them (from a worker thread)
+    long convergence_start = 0;                    // --convergence[=paths]: estimates at paths, 2x, 4x, ... (0 = off)
+    std::vector<ConvergencePoint> *convergence = nullptr; // Receives those checkpoints when set
+    int distribution_bins = 0;                     // --distribution[=bins]: histograms and quantiles (0 = off)
+    PathDistribution *distribution = nullptr;      // Receives them, merged over the workers, when set
+    std::string dump_path;                         // --dump-paths=<file>: write every path to a path dump
+    int dump_steps = PATH_DUMP_DEFAULT_STEPS;      // --dump-steps=<n>: time steps per dumped path
+    int dump_chunk_paths = PATH_DUMP_DEFAULT_CHUNK_PATHS; // --dump-chunk=<paths>: paths per chunk
+    uint64_t dump_seed = 0;                        // --dump-seed=<n>: 0 picks one from the clock
+};
+
+// Structure to hold benchmark results
+struct BenchmarkResult
+{
+    double executionTime;
+    double optionPrice;
+    double lowerBound;
+    double upperBound;
+    int threadsUsed;
+    std::vector<WorkerReport> workers; // With --perf-counters
+};
+
+// One configuration of a scaling sweep
+struct ScalingPoint
+{
+    int threads;
+    int numTrials;
+    double medianTime;     // ms
+    double speedup;        // single-threaded median / this median
+    double efficiency;     // speedup / threads
+    double pathsPerSecond;
+};
+
+// One contract of a batch request
+struct BatchContract
+{
+    double S0;
+    double K;
+    double r;
+    double sigma;
+    double T;
+    bool isCall;
+};
+
+// Sample paths for plotting (server-mode "paths" requests): count GBM paths simulated over
+// steps equal time steps, each reduced to points (time, price) pairs by LTTB
+struct SamplePathsSpec
+{
+    double S0;
+    double r;
+    double sigma;
+    double T;
+    int count;
+    int steps;
+    int points;
+    uint64_t seed; // 0 picks one from the clock
+};
+
+constexpr int SAMPLE_PATHS_MAX_COUNT = 1000;
+constexpr int SAMPLE_PATHS_MAX_STEPS = 10000;
+constexpr int SAMPLE_PATHS_MAX_POINTS = 2000;
+
+// Outcome of a --dump-paths run: the option priced from the dumped terminal prices, and the file
+struct PathDumpResult
+{
+    double price;
+    double lower;
+    double upper;
+    int threadsUsed;
+    PathDumpHeader header; // As written (seed resolved)
+    uint64_t bytes;        // File size
+};
+
+// Single-threaded pricer that keeps every payoff (two-pass variance)
+void monte_carlo_black_scholes(double S0, double K, double r, double sigma,
+                               double T, bool isCall, int numTrials,
+                               double &price, double &lower, double &upper);
+
+// Multi-threaded pricer (num_threads <= 0 picks the count from the job size)
+void monte_carlo_black_scholes_mt(double S0, double K, double r, double sigma,
+                                  double T, bool isCall, int numTrials, int num_threads,
+                                  double &price, double &lower, double &upper,
+                                  const SimulationOptions &options = SimulationOptions());
+
+// Price many contracts with the same trial count. Results are written columnar into
+// prices/lowers/uppers (count entries each). Returns the number of threads used.
+int price_batch(const BatchContract *contracts, int count, int numTrials, int num_threads,
+                double *prices, double *lowers, double *uppers,
+                const SimulationOptions &options = SimulationOptions());
+
+// Throws std::invalid_argument unless the spec is within the SAMPLE_PATHS_MAX_* limits
+// and points <= steps + 1
+void validate_sample_paths(const SamplePathsSpec &spec);
+
+// Simulate spec.count paths and write their downsampled points path-major into times and
+// prices (count * points floats each). Cost is O(count * steps), whatever the pricing job size.
+void sample_paths(const SamplePathsSpec &spec, float *times, float *prices);
+
+// Simulate numTrials full GBM paths of options.dump_steps exact steps into the path dump
+// options.dump_path (float32 with --precision=single, float64 otherwise; see path_dump.h).
+// Worker threads each fill their own range of chunks directly in the mapped file. The option is
+// priced from the same paths' terminal prices, so the file comes with its reference estimate.
+PathDumpResult dump_paths(double S0, double K, double r, double sigma, double T, bool isCall,
+                          int numTrials, int num_threads, const SimulationOptions &options);
+
+// Largest thread count a request may ask for (server requests beyond it are rejected)
+constexpr int MAX_REQUEST_THREADS = 256;
+
+// Hardware threads of the machine (4 when unknown)
+int hardware_thread_count();
+
+// Resolve a requested thread count (<= 0 means automatic, at most hardware_thread_count())
+// for a job of numTrials paths
+int choose_thread_count(int numTrials, int requested_threads);
+
+// Function to run multiple benchmark iterations
+std::vector<BenchmarkResult> run_benchmark(double S0, double K, double r, double sigma,
+                                           double T, bool isCall, int numTrials,
+                                           int threads, int iterations,
+                                           const SimulationOptions &options = SimulationOptions());
+
+// Function to calculate statistics from benchmark results
+void calculate_stats(const std::vector<BenchmarkResult> &results,
+                     double &min, double &max, double &avg, double &median);
+
+// Thread-count sweep (1, 2, 4, ... max_threads) at a fixed job size
+std::vector<ScalingPoint> run_thread_sweep(double S0, double K, double r, double sigma,
+                                           double T, bool isCall, int numTrials,
+                                           int max_threads, int iterations,
+                                           const SimulationOptions &options = SimulationOptions());
+
+// Trial-count sweep (decades up to numTrials) at max_threads, each against one thread
+std::vector<ScalingPoint> run_trial_sweep(double S0, double K, double r, double sigma,
+                                          double T, bool isCall, int numTrials,
+                                          int max_threads, int iterations,
+                                          const SimulationOptions &options = SimulationOptions());
+
+// User + system CPU seconds consumed by this process so far
+double process_cpu_seconds();
+
+// Apply one --key=value flag to the options
+void parse_option(const std::string &arg, SimulationOptions &options);
@@ -0,0 +1,8 @@
+#pragma once
+
+// Run the engine as a long-lived process answering requests on stdin/stdout (--serve).
+// The first line sent by the client selects the protocol for the connection:
+//   "HELLO json"   - one request per line, one JSON response per line
+//   "HELLO binary" - fixed-layout frames, see binary_protocol.h
+// Returns the process exit code once stdin is closed or a quit request arrives.
+int run_server();
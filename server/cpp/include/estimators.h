@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "engine.h"
+
+// Variance-reduction estimators for a European option. Each is single-threaded and
+// deterministic for a given seed, so repeated runs can be compared against the analytical
+// price (see bench/efficiency_benchmark.cpp).
+enum class Estimator
+{
+    Plain,              // Independent normals
+    Antithetic,         // Pairs (z, -z), averaged per pair
+    ControlVariate,     // Discounted terminal price as control (known mean S0)
+    QuasiMonteCarlo,    // Randomly shifted van der Corput points through the inverse normal CDF
+    Stratified,         // Equal-probability strata of the normal, one draw each, in independent replications
+    ImportanceSampling  // Normal mean shifted to the payoff-weighted mode, likelihood-ratio weighted
+};
+
+constexpr int ESTIMATOR_COUNT = 6;
+
+// Price estimate and its standard error (discounted)
+struct Estimate
+{
+    double price;
+    double standardError;
+    double criticalValue; // 95% CI half-width / standardError (Student t for few replications)
+};
+
+const char *estimator_name(Estimator estimator);
+
+// Throws std::invalid_argument for an unknown name
+Estimator parse_estimator(const std::string &name);
+
+// Estimate the price of contract with numTrials payoff evaluations
+Estimate estimate_price(Estimator estimator, const BatchContract &contract, int numTrials, uint64_t seed);
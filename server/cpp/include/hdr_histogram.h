@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// High-dynamic-range histogram with log-linear buckets: values below 2^SUB_BITS are counted
+// exactly, above that every power of two is split into 2^SUB_BITS equal buckets, so any
+// recorded value (and any quantile) is within 1 / 2^SUB_BITS (0.8%) of the truth.
+//
+// Each histogram has a single writer (its owning thread). record() is a relaxed load + store
+// per field - no locked instructions - and readers on other threads take relaxed snapshots,
+// which may be at most one in-progress record behind.
+class HdrHistogram
+{
+public:
+    static constexpr int SUB_BITS = 7;
+    static constexpr int MAX_BITS = 44; // Larger values are clamped (2^44 TSC ticks is over an hour)
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    HdrHistogram() : counts_(BUCKETS) {}
+
+    HdrHistogram(const HdrHistogram &) = delete;
+    HdrHistogram &operator=(const HdrHistogram &) = delete;
+
+    static int bucket_index(uint64_t value)
+    {
+        value = std::min<uint64_t>(value, (uint64_t(1) << MAX_BITS) - 1);
+        if (value < SUB_COUNT)
+            return static_cast<int>(value);
+        const int shift = (63 - __builtin_clzll(value)) - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + static_cast<int>((value >> shift) - SUB_COUNT);
+    }
+
+    // Highest value that maps to the bucket
+    static uint64_t bucket_upper(int index)
+    {
+        const int group = index >> SUB_BITS;
+        if (group == 0)
+            return static_cast<uint64_t>(index);
+        const int shift = group - 1;
+        const uint64_t lower = (static_cast<uint64_t>(SUB_COUNT + (index & (SUB_COUNT - 1)))) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+    // Owning thread only
+    void record(uint64_t value)
+    {
+        auto &bucket = counts_[bucket_index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    // Merge into an aggregate (any thread)
+    void add_to(std::vector<uint64_t> &counts, uint64_t &total, uint64_t &max) const
+    {
+        counts.resize(BUCKETS);
+        for (int i = 0; i < BUCKETS; ++i)
+            counts[i] += counts_[i].load(std::memory_order_relaxed);
+        total += total_.load(std::memory_order_relaxed);
+        max = std::max(max, max_.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::vector<std::atomic<uint64_t>> counts_;
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Merged view of one or more histograms
+struct HdrSnapshot
+{
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    void add(const HdrHistogram &histogram) { histogram.add_to(counts, total, max); }
+
+    // Smallest bucket bound with at least quantile * total values at or below it (0 if empty)
+    uint64_t value_at_quantile(double quantile) const
+    {
+        if (total == 0)
+            return 0;
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(HdrHistogram::bucket_upper(static_cast<int>(i)), max);
+        }
+        return max;
+    }
+};
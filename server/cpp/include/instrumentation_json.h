@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "json_writer.h"
+
+// JSON sections for the optional engine instrumentation (--perf-counters, --timing, --trace)
+// and outputs (--convergence, --distribution), shared by the command-line modes and server mode
+
+// Raw counters plus IPC, paths per cycle and misses per path; unavailable counters are null
+inline void write_counter_fields(JsonWriter &json, const PerfCounts &counts, long paths)
+{
+    static const char *const names[PERF_EVENT_COUNT] = {"cycles", "instructions", "cacheMisses",
+                                                        "branchMisses", "vectorFpOps"};
+    json.begin_object();
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        json.key(names[i]);
+        if (counts.available[i])
+            json.value(static_cast<int64_t>(counts.values[i]));
+        else
+            json.value(std::nan(""));
+    }
+
+    auto ratio = [&](int numerator, int denominator)
+    {
+        return counts.available[numerator] && counts.available[denominator] && counts.values[denominator] > 0
+                   ? static_cast<double>(counts.values[numerator]) / counts.values[denominator]
+                   : std::nan("");
+    };
+    auto per_path = [&](int event)
+    {
+        return counts.available[event] && paths > 0 ? static_cast<double>(counts.values[event]) / paths : std::nan("");
+    };
+    json.field("ipc", ratio(PERF_INSTRUCTIONS, PERF_CYCLES))
+        .field("pathsPerCycle", counts.available[PERF_CYCLES] && counts.values[PERF_CYCLES] > 0
+                                    ? static_cast<double>(paths) / counts.values[PERF_CYCLES]
+                                    : std::nan(""))
+        .field("cyclesPerPath", per_path(PERF_CYCLES))
+        .field("cacheMissesPerPath", per_path(PERF_CACHE_MISSES))
+        .field("branchMissesPerPath", per_path(PERF_BRANCH_MISSES))
+        .field("vectorFpOpsPerPath", per_path(PERF_VECTOR_FP_OPS))
+        .end_object();
+}
+
+// Per-worker counters of one benchmark run, followed by the run total
+inline void write_perf_counters(JsonWriter &json, const BenchmarkResult &result)
+{
+    long paths = 0;
+    json.key("workers").begin_array();
+    for (const auto &worker : result.workers)
+    {
+        json.begin_object().field("worker", worker.worker).field("paths", worker.paths).key("counters");
+        write_counter_fields(json, worker.counters, worker.paths);
+        json.end_object();
+        paths += worker.paths;
+    }
+    json.end_array().key("counters");
+    write_counter_fields(json, sum_perf_counts(result.workers.begin(), result.workers.end(),
+                                               [](const WorkerReport &w) -> const PerfCounts & { return w.counters; }),
+                         paths);
+}
+
+// Per-phase breakdown in ms. Worker phases (threadStart, rng, pathEvaluation) are summed over
+// workers, i.e. CPU time; `total` is the caller's wall time from parsing to formatted output.
+inline void write_phase_timing(JsonWriter &json, const PhaseTimes &caller, const JobInstrumentation &job,
+                               uint64_t total_ticks)
+{
+    PhaseTimes phases = caller;
+    phases += job.phases;
+    for (const auto &worker : job.workers)
+        phases += worker.phases;
+
+    json.begin_object()
+        .field("unit", "ms")
+        .field("kernel", "split_f64")
+        .field("total", ticks_to_ms(total_ticks))
+        .key("phases")
+        .begin_object();
+    for (int i = 0; i < PHASE_COUNT; ++i)
+        json.field(phase_name(static_cast<Phase>(i)), ticks_to_ms(phases.ticks[i]));
+    json.end_object();
+
+    json.key("workers").begin_array();
+    for (const auto &worker : job.workers)
+    {
+        json.begin_object().field("worker", worker.worker).field("paths", worker.paths);
+        for (Phase phase : {PHASE_THREAD_START, PHASE_RNG, PHASE_PATHS})
+            json.field(phase_name(phase), ticks_to_ms(worker.phases.ticks[phase]));
+        json.end_object();
+    }
+    json.end_array().end_object();
+}
+
+// Convergence checkpoints: [{ paths, optionPrice, confidence: { lower, upper } }, ...]
+inline void write_convergence(JsonWriter &json, const std::vector<ConvergencePoint> &points)
+{
+    json.begin_array();
+    for (const auto &point : points)
+    {
+        json.begin_object()
+            .field("paths", static_cast<int64_t>(point.paths))
+            .field("optionPrice", point.price)
+            .key("confidence")
+            .begin_object()
+            .field("lower", point.lower)
+            .field("upper", point.upper)
+            .end_object()
+            .end_object();
+    }
+    json.end_array();
+}
+
+// One --distribution quantity: { histogram: { lower, upper, counts, below, above }, quantiles: [{ q, value }] }
+template <typename Quantile>
+inline void write_value_distribution(JsonWriter &json, const FixedHistogram &histogram, Quantile quantile)
+{
+    static const double levels[] = {0.01, 0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99};
+    json.begin_object()
+        .key("histogram")
+        .begin_object()
+        .field("lower", histogram.lower())
+        .field("upper", histogram.upper())
+        .key("counts")
+        .begin_array();
+    for (uint64_t count : histogram.counts())
+        json.value(static_cast<int64_t>(count));
+    json.end_array()
+        .field("below", static_cast<int64_t>(histogram.below()))
+        .field("above", static_cast<int64_t>(histogram.above()))
+        .end_object()
+        .key("quantiles")
+        .begin_array();
+    for (double q : levels)
+    {
+        json.begin_object().field("q", q).field("value", quantile(q)).end_object();
+    }
+    json.end_array().end_object();
+}
+
+// { count, terminalPrice, payoff } - payoffs are undiscounted
+inline void write_distribution(JsonWriter &json, const PathDistribution &distribution)
+{
+    json.begin_object().field("count", static_cast<int64_t>(distribution.count())).key("terminalPrice");
+    write_value_distribution(json, distribution.terminal_price,
+                             [&](double q) { return distribution.terminal_price_quantile(q); });
+    json.key("payoff");
+    write_value_distribution(json, distribution.payoff, [&](double q) { return distribution.payoff_quantile(q); });
+    json.end_object();
+}
+
+// Engine spans of a traced request; times are strings because Unix nanoseconds exceed 2^53
+inline void write_trace(JsonWriter &json, const TraceRecorder &trace)
+{
+    json.begin_object()
+        .field("traceId", hex_encode(trace.context().trace_id, 16))
+        .key("spans")
+        .begin_array();
+    for (const auto &span : trace.spans())
+    {
+        json.begin_object()
+            .field("spanId", hex_encode(span.span_id, 8))
+            .field("parentSpanId", hex_encode(span.parent_span_id, 8))
+            .field("name", trace_span_name(span.kind))
+            .field("startTimeUnixNano", std::to_string(ticks_to_unix_ns(span.start_ticks)))
+            .field("endTimeUnixNano", std::to_string(ticks_to_unix_ns(span.end_ticks)))
+            .end_object();
+    }
+    json.end_array().end_object();
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Default size at which a streaming writer hands its buffer to write(2)
+constexpr std::size_t JSON_FLUSH_THRESHOLD = 256 * 1024;
+
+// Initial buffer size; the buffer grows as documents need it
+constexpr std::size_t JSON_INITIAL_BUFFER = 4096;
+
+// Maximum nesting depth of objects/arrays
+constexpr int JSON_MAX_DEPTH = 32;
+
+// Receives the chunks of a streaming writer that does not write to a file descriptor
+using JsonSink = std::function<void(const char *, std::size_t)>;
+
+// Allocation-free JSON output. Values are formatted with std::to_chars straight into a
+// reusable buffer (doubles in shortest round-trip form) and handed to the OS in one
+// write(2) per response. With a file descriptor or a sink the writer also streams: once the
+// buffer passes the flush threshold it is written out mid-document, so arbitrarily large
+// arrays need only a bounded buffer. With fd = -1 it only buffers (see data()/size()).
+// The buffer starts small and grows on demand, so a writer kept and reused with clear()
+// stops allocating after its first few documents.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(int fd = STDOUT_FILENO, std::size_t flush_threshold = JSON_FLUSH_THRESHOLD)
+        : fd_(fd), streaming_(fd >= 0), flush_threshold_(flush_threshold)
+    {
+        buffer_.resize(JSON_INITIAL_BUFFER);
+    }
+
+    // Stream to sink instead of a file descriptor; flush() hands it the rest of the document
+    JsonWriter(JsonSink sink, std::size_t flush_threshold)
+        : fd_(-1), streaming_(true), sink_(std::move(sink)), flush_threshold_(flush_threshold)
+    {
+        buffer_.resize(JSON_INITIAL_BUFFER);
+    }
+
+    JsonWriter &begin_object() { return open('{'); }
+    JsonWriter &end_object() { return close('}'); }
+    JsonWriter &begin_array() { return open('['); }
+    JsonWriter &end_array() { return close(']'); }
+
+    // Object key; the next value call supplies its value
+    JsonWriter &key(const char *name)
+    {
+        separator();
+        put('"');
+        append(name, std::strlen(name));
+        append("\":", 2);
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter &value(double number)
+    {
+        separator();
+        if (!is_finite(number))
+        {
+            append("null", 4); // JSON has no NaN/Infinity
+            return *this;
+        }
+        reserve(32);
+        const auto result = std::to_chars(buffer_.data() + size_, buffer_.data() + buffer_.size(), number);
+        size_ = result.ptr - buffer_.data();
+        return *this;
+    }
+
+    JsonWriter &value(int64_t number)
+    {
+        separator();
+        reserve(24);
+        const auto result = std::to_chars(buffer_.data() + size_, buffer_.data() + buffer_.size(), number);
+        size_ = result.ptr - buffer_.data();
+        return *this;
+    }
+
+    JsonWriter &value(int number) { return value(static_cast<int64_t>(number)); }
+    JsonWriter &value(uint32_t number) { return value(static_cast<int64_t>(number)); }
+    JsonWriter &value(std::size_t number) { return value(static_cast<int64_t>(number)); }
+
+    JsonWriter &value(bool flag)
+    {
+        separator();
+        if (flag)
+            append("true", 4);
+        else
+            append("false", 5);
+        return *this;
+    }
+
+    JsonWriter &value(const char *text) { return value(text, std::strlen(text)); }
+    JsonWriter &value(const std::string &text) { return value(text.data(), text.size()); }
+
+    JsonWriter &value(const char *text, std::size_t length)
+    {
+        separator();
+        put('"');
+        for (std::size_t i = 0; i < length; i++)
+        {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c == '"' || c == '\\')
+            {
+                put('\\');
+                put(static_cast<char>(c));
+            }
+            else if (c < 0x20)
+            {
+                static const char hex[] = "0123456789abcdef";
+                const char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                append(escaped, sizeof(escaped));
+            }
+            else
+            {
+                put(static_cast<char>(c));
+            }
+        }
+        put('"');
+        return *this;
+    }
+
+    // Shorthand for key(name).value(v)
+    template <typename T>
+    JsonWriter &field(const char *name, T v)
+    {
+        key(name);
+        return value(v);
+    }
+
+    // Append a newline (NDJSON / line protocols)
+    JsonWriter &newline()
+    {
+        put('\n');
+        return *this;
+    }
+
+    // Write everything buffered so far with a single write(2) (or one call of the sink)
+    void flush()
+    {
+        if (sink_)
+        {
+            if (size_ > 0)
+                sink_(buffer_.data(), size_);
+            size_ = 0;
+            return;
+        }
+        if (fd_ < 0)
+            return;
+        const char *data = buffer_.data();
+        std::size_t remaining = size_;
+        while (remaining > 0)
+        {
+            const ssize_t n = ::write(fd_, data, remaining);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            data += n;
+            remaining -= static_cast<std::size_t>(n);
+        }
+        size_ = 0;
+    }
+
+    // Reset for the next document, keeping the buffer
+    void clear()
+    {
+        size_ = 0;
+        depth_ = 0;
+        after_key_ = false;
+    }
+
+    const char *data() const { return buffer_.data(); }
+    std::size_t size() const { return size_; }
+
+private:
+    // Exponent-bits test: std::isfinite is folded to true under -ffast-math
+    static bool is_finite(double number)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return (bits & 0x7FF0000000000000ULL) != 0x7FF0000000000000ULL;
+    }
+
+    JsonWriter &open(char bracket)
+    {
+        separator();
+        put(bracket);
+        if (depth_ < JSON_MAX_DEPTH)
+            first_[depth_] = true;
+        depth_++;
+        return *this;
+    }
+
+    JsonWriter &close(char bracket)
+    {
+        depth_--;
+        put(bracket);
+        return *this;
+    }
+
+    // Comma before every element except the first in its container (and never after a key)
+    void separator()
+    {
+        if (after_key_)
+        {
+            after_key_ = false;
+            return;
+        }
+        if (depth_ > 0 && depth_ <= JSON_MAX_DEPTH)
+        {
+            if (!first_[depth_ - 1])
+                put(',');
+            first_[depth_ - 1] = false;
+        }
+    }
+
+    // Make room for n more bytes: stream out past the threshold, otherwise grow
+    void reserve(std::size_t n)
+    {
+        if (streaming_ && size_ >= flush_threshold_)
+            flush();
+        if (size_ + n > buffer_.size())
+            buffer_.resize(std::max(buffer_.size() * 2, size_ + n));
+    }
+
+    void put(char c)
+    {
+        reserve(1);
+        buffer_[size_++] = c;
+    }
+
+    void append(const char *text, std::size_t length)
+    {
+        reserve(length);
+        std::memcpy(buffer_.data() + size_, text, length);
+        size_ += length;
+    }
+
+    int fd_;
+    bool streaming_;
+    JsonSink sink_;
+    std::size_t flush_threshold_;
+    std::vector<char> buffer_;
+    std::size_t size_ = 0;
+    int depth_ = 0;
+    bool first_[JSON_MAX_DEPTH] = {};
+    bool after_key_ = false;
+};
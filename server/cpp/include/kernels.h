@@ -0,0 +1,379 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Use aligned memory allocation for better performance with SIMD instructions
+#if defined(__GNUC__) || defined(__clang__)
+#define ALIGN_DATA(x) __attribute__((aligned(x)))
+#else
+#define ALIGN_DATA(x) __declspec(align(x))
+#endif
+
+// Force inline for critical functions to reduce function call overhead
+#if defined(__GNUC__) || defined(__clang__)
+#define FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define FORCE_INLINE __forceinline
+#endif
+
+// Paths evaluated together by the fused kernel - one AVX-512 register (two AVX2 registers) of doubles
+constexpr int SIMD_LANES = 8;
+
+// Same register width in float32 - twice the lanes
+constexpr int SIMD_LANES_F32 = 16;
+
+// Steps of float32 partial sums before they are flushed into the double accumulators
+constexpr long F32_ACCUMULATION_BLOCK = 64;
+
+// Arithmetic precision of the path kernels (accumulation is always double)
+enum class Precision
+{
+    Double,
+    Single
+};
+
+constexpr double M_PI_VALUE = 3.14159265358979323846264338327950288;
+constexpr double TWO_PI = 2.0 * M_PI_VALUE;
+
+// Force inline function to calculate payoff (minimize function call overhead)
+FORCE_INLINE double calculate_payoff(double ST, double K, bool isCall)
+{
+    // Branchless version to avoid branch prediction failures
+    const double call_payoff = ST - K;
+    const double put_payoff = K - ST;
+    const double call_result = call_payoff > 0.0 ? call_payoff : 0.0;
+    const double put_result = put_payoff > 0.0 ? put_payoff : 0.0;
+    return isCall ? call_result : put_result;
+}
+
+// SplitMix64 - used only to expand a single seed into generator state
+FORCE_INLINE uint64_t splitmix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+FORCE_INLINE uint64_t rotl64(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// Reinterpret the bits of a 64-bit word as a double (vectorizer-friendly std::bit_cast)
+FORCE_INLINE double bits_as_double(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bit_cast(double, bits);
+#else
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d;
+#endif
+}
+
+// Map the top 52 bits of a random word to a double in (0, 1] without an int->float
+// conversion: build a double in [1, 2) from the bits and subtract it from 2
+FORCE_INLINE double bits_to_unit_interval(uint64_t x)
+{
+    return 2.0 - bits_as_double((x >> 12) | 0x3FF0000000000000ULL);
+}
+
+// float32 counterpart: 23 random mantissa bits -> float in (0, 1]
+FORCE_INLINE float bits_to_unit_interval_f32(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 2.0f - __builtin_bit_cast(float, (x >> 9) | 0x3F800000U);
+#else
+    const uint32_t bits = (x >> 9) | 0x3F800000U;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return 2.0f - f;
+#endif
+}
+
+FORCE_INLINE uint32_t rotl32(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// One xoshiro128+ step on a single lane's state (32-bit words for the float32 kernels)
+FORCE_INLINE uint32_t xoshiro128p_next(uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3)
+{
+    const uint32_t result = s0 + s3;
+    const uint32_t t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl32(s3, 11);
+    return result;
+}
+
+// One xoshiro256+ step on a single lane's state
+FORCE_INLINE uint64_t xoshiro256p_next(uint64_t &s0, uint64_t &s1, uint64_t &s2, uint64_t &s3)
+{
+    const uint64_t result = s0 + s3;
+    const uint64_t t = s1 << 17;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl64(s3, 45);
+    return result;
+}
+
+// Box-Muller: a pair of uniforms becomes two independent standard normals.
+// sin is written as cos(theta - pi/2): GCC fuses sin+cos of the same argument into a
+// sincos call that has no vector variant, which would stop the whole loop vectorizing.
+FORCE_INLINE void box_muller(double u1, double u2, double &z0, double &z1)
+{
+    const double radius = std::sqrt(-2.0 * std::log(u1));
+    const double theta = TWO_PI * u2;
+    z0 = radius * std::cos(theta);
+    z1 = radius * std::cos(theta - 0.5 * M_PI_VALUE);
+}
+
+// SIMD_LANES independent xoshiro256+ generators stored structure-of-arrays, so one call
+// advances all lanes with plain vector shifts, xors and adds
+struct LaneRng
+{
+    ALIGN_DATA(64) uint64_t s0[SIMD_LANES];
+    ALIGN_DATA(64) uint64_t s1[SIMD_LANES];
+    ALIGN_DATA(64) uint64_t s2[SIMD_LANES];
+    ALIGN_DATA(64) uint64_t s3[SIMD_LANES];
+
+    explicit LaneRng(uint64_t seed)
+    {
+        for (int lane = 0; lane < SIMD_LANES; ++lane)
+        {
+            s0[lane] = splitmix64(seed);
+            s1[lane] = splitmix64(seed);
+            s2[lane] = splitmix64(seed);
+            s3[lane] = splitmix64(seed);
+        }
+    }
+
+    // Fill u with one uniform in (0, 1] per lane
+    FORCE_INLINE void next_uniform(double *u)
+    {
+#pragma GCC unroll 1
+        for (int lane = 0; lane < SIMD_LANES; ++lane)
+        {
+            u[lane] = bits_to_unit_interval(xoshiro256p_next(s0[lane], s1[lane], s2[lane], s3[lane]));
+        }
+    }
+
+    // Fill z with two standard normals per lane (2 * SIMD_LANES values)
+    FORCE_INLINE void next_normal_pair(double *z)
+    {
+#pragma GCC unroll 1
+        for (int lane = 0; lane < SIMD_LANES; ++lane)
+        {
+            const double u1 = bits_to_unit_interval(xoshiro256p_next(s0[lane], s1[lane], s2[lane], s3[lane]));
+            const double u2 = bits_to_unit_interval(xoshiro256p_next(s0[lane], s1[lane], s2[lane], s3[lane]));
+            box_muller(u1, u2, z[lane], z[lane + SIMD_LANES]);
+        }
+    }
+};
+
+// float32 lane generators: 16 lanes of xoshiro128+ fill the same register width as LaneRng
+struct LaneRngF32
+{
+    ALIGN_DATA(64) uint32_t s0[SIMD_LANES_F32];
+    ALIGN_DATA(64) uint32_t s1[SIMD_LANES_F32];
+    ALIGN_DATA(64) uint32_t s2[SIMD_LANES_F32];
+    ALIGN_DATA(64) uint32_t s3[SIMD_LANES_F32];
+
+    explicit LaneRngF32(uint64_t seed)
+    {
+        for (int lane = 0; lane < SIMD_LANES_F32; ++lane)
+        {
+            const uint64_t a = splitmix64(seed);
+            const uint64_t b = splitmix64(seed);
+            s0[lane] = static_cast<uint32_t>(a);
+            s1[lane] = static_cast<uint32_t>(a >> 32);
+            s2[lane] = static_cast<uint32_t>(b);
+            s3[lane] = static_cast<uint32_t>(b >> 32) | 1U; // State must not be all zero
+        }
+    }
+};
+
+// Fill out[0..count) with standard normals from the lane generators (count rounded up to
+// whole lane pairs is drawn; the excess is discarded)
+inline void fill_normals(LaneRng &rng, double *out, long count)
+{
+    ALIGN_DATA(64) double z[2 * SIMD_LANES];
+    long i = 0;
+    for (; i + 2 * SIMD_LANES <= count; i += 2 * SIMD_LANES)
+    {
+        rng.next_normal_pair(out + i);
+    }
+    if (i < count)
+    {
+        rng.next_normal_pair(z);
+        std::memcpy(out + i, z, (count - i) * sizeof(double));
+    }
+}
+
+// Advance count GBM paths by one time step: S *= exp(drift_dt + vol_sqrt_dt * z), with
+// drift_dt = (r - sigma^2 / 2) * dt and vol_sqrt_dt = sigma * sqrt(dt)
+FORCE_INLINE void gbm_step(double *S, const double *z, long count, double drift_dt, double vol_sqrt_dt)
+{
+#pragma GCC unroll 1
+    for (long i = 0; i < count; ++i)
+    {
+        S[i] *= std::exp(drift_dt + vol_sqrt_dt * z[i]);
+    }
+}
+
+// Split counterpart of fused_gbm_payoff: terminal price, payoff and accumulation for count
+// precomputed normals. Used when RNG and path evaluation are timed separately (--timing).
+FORCE_INLINE void gbm_payoff_from_normals(const double *z, long count,
+                                          double S0, double K, double drift, double volatility, bool isCall,
+                                          double &sum, double &sum_squared)
+{
+    const double sign = isCall ? 1.0 : -1.0;
+    double local_sum = 0.0;
+    double local_sum_squared = 0.0;
+#pragma GCC unroll 1
+    for (long i = 0; i < count; ++i)
+    {
+        const double payoff = std::fmax(sign * (S0 * std::exp(drift + volatility * z[i]) - K), 0.0);
+        local_sum += payoff;
+        local_sum_squared += payoff * payoff;
+    }
+    sum += local_sum;
+    sum_squared += local_sum_squared;
+}
+
+// Fused GBM terminal-price kernel: uniforms -> normals -> exp -> payoff -> accumulate for one
+// vector of lanes per iteration. The only memory touched is the generator state and the
+// per-lane accumulators, so the loop stays in registers/L1 and is bound by log/cos/exp throughput.
+// Adds the payoff sum and sum of squares of num_paths paths to sum and sum_squared.
+//
+// The lane loops carry "unroll 1" so GCC vectorizes them as loops (which can call the libmvec
+// exp/log/cos variants) instead of fully unrolling and SLP-vectorizing them (which cannot).
+FORCE_INLINE void fused_gbm_payoff(LaneRng &rng, long num_paths,
+                                   double S0, double K, double drift, double volatility, bool isCall,
+                                   double &sum, double &sum_squared)
+{
+    // Payoff is max(sign * (ST - K), 0) - hoisting the call/put choice keeps the body branch-free
+    const double sign = isCall ? 1.0 : -1.0;
+
+    ALIGN_DATA(64) double acc[SIMD_LANES] = {};
+    ALIGN_DATA(64) double acc_squared[SIMD_LANES] = {};
+
+    // Each lane produces two paths per iteration (one Box-Muller pair)
+    constexpr long PATHS_PER_STEP = 2 * SIMD_LANES;
+    const long steps = (num_paths + PATHS_PER_STEP - 1) / PATHS_PER_STEP;
+    const long full_steps = num_paths / PATHS_PER_STEP;
+
+    for (long step = 0; step < steps; ++step)
+    {
+        // Lanes past num_paths in the final partial step are weighted out
+        const long remaining = step < full_steps ? PATHS_PER_STEP : num_paths - step * PATHS_PER_STEP;
+
+#pragma GCC unroll 1
+        for (int lane = 0; lane < SIMD_LANES; ++lane)
+        {
+            const double u1 = bits_to_unit_interval(xoshiro256p_next(rng.s0[lane], rng.s1[lane], rng.s2[lane], rng.s3[lane]));
+            const double u2 = bits_to_unit_interval(xoshiro256p_next(rng.s0[lane], rng.s1[lane], rng.s2[lane], rng.s3[lane]));
+            double z0, z1;
+            box_muller(u1, u2, z0, z1);
+
+            const double w0 = lane < remaining ? 1.0 : 0.0;
+            const double w1 = lane + SIMD_LANES < remaining ? 1.0 : 0.0;
+            const double ST0 = S0 * std::exp(drift + volatility * z0);
+            const double ST1 = S0 * std::exp(drift + volatility * z1);
+            const double p0 = w0 * std::fmax(sign * (ST0 - K), 0.0);
+            const double p1 = w1 * std::fmax(sign * (ST1 - K), 0.0);
+            acc[lane] += p0 + p1;
+            acc_squared[lane] += p0 * p0 + p1 * p1;
+        }
+    }
+
+    for (int lane = 0; lane < SIMD_LANES; ++lane)
+    {
+        sum += acc[lane];
+        sum_squared += acc_squared[lane];
+    }
+}
+
+// float32 variant of fused_gbm_payoff: RNG, Box-Muller, exp and payoff run on 16 float lanes.
+// Each lane sums payoffs in float for at most F32_ACCUMULATION_BLOCK steps (a few hundred
+// values, well inside float's relative precision) and then flushes into double accumulators,
+// so the long-run sums and the variance estimate keep double precision.
+FORCE_INLINE void fused_gbm_payoff_f32(LaneRngF32 &rng, long num_paths,
+                                       double S0, double K, double drift, double volatility, bool isCall,
+                                       double &sum, double &sum_squared)
+{
+    const float sign = isCall ? 1.0f : -1.0f;
+    const float S0_f = static_cast<float>(S0);
+    const float K_f = static_cast<float>(K);
+    const float drift_f = static_cast<float>(drift);
+    const float volatility_f = static_cast<float>(volatility);
+    constexpr float TWO_PI_F = static_cast<float>(TWO_PI);
+    constexpr float HALF_PI_F = static_cast<float>(0.5 * M_PI_VALUE);
+
+    ALIGN_DATA(64) double acc[SIMD_LANES_F32] = {};
+    ALIGN_DATA(64) double acc_squared[SIMD_LANES_F32] = {};
+    ALIGN_DATA(64) float block_acc[SIMD_LANES_F32];
+    ALIGN_DATA(64) float block_acc_squared[SIMD_LANES_F32];
+
+    constexpr long PATHS_PER_STEP = 2 * SIMD_LANES_F32;
+    const long steps = (num_paths + PATHS_PER_STEP - 1) / PATHS_PER_STEP;
+    const long full_steps = num_paths / PATHS_PER_STEP;
+
+    for (long block_start = 0; block_start < steps; block_start += F32_ACCUMULATION_BLOCK)
+    {
+        const long block_end = block_start + F32_ACCUMULATION_BLOCK < steps ? block_start + F32_ACCUMULATION_BLOCK : steps;
+
+        for (int lane = 0; lane < SIMD_LANES_F32; ++lane)
+        {
+            block_acc[lane] = 0.0f;
+            block_acc_squared[lane] = 0.0f;
+        }
+
+        for (long step = block_start; step < block_end; ++step)
+        {
+            const long remaining = step < full_steps ? PATHS_PER_STEP : num_paths - step * PATHS_PER_STEP;
+
+#pragma GCC unroll 1
+            for (int lane = 0; lane < SIMD_LANES_F32; ++lane)
+            {
+                const float u1 = bits_to_unit_interval_f32(xoshiro128p_next(rng.s0[lane], rng.s1[lane], rng.s2[lane], rng.s3[lane]));
+                const float u2 = bits_to_unit_interval_f32(xoshiro128p_next(rng.s0[lane], rng.s1[lane], rng.s2[lane], rng.s3[lane]));
+                const float radius = std::sqrt(-2.0f * std::log(u1));
+                const float theta = TWO_PI_F * u2;
+                const float z0 = radius * std::cos(theta);
+                const float z1 = radius * std::cos(theta - HALF_PI_F);
+
+                const float w0 = lane < remaining ? 1.0f : 0.0f;
+                const float w1 = lane + SIMD_LANES_F32 < remaining ? 1.0f : 0.0f;
+                const float ST0 = S0_f * std::exp(drift_f + volatility_f * z0);
+                const float ST1 = S0_f * std::exp(drift_f + volatility_f * z1);
+                const float p0 = w0 * std::fmax(sign * (ST0 - K_f), 0.0f);
+                const float p1 = w1 * std::fmax(sign * (ST1 - K_f), 0.0f);
+                block_acc[lane] += p0 + p1;
+                block_acc_squared[lane] += p0 * p0 + p1 * p1;
+            }
+        }
+
+        for (int lane = 0; lane < SIMD_LANES_F32; ++lane)
+        {
+            acc[lane] += block_acc[lane];
+            acc_squared[lane] += block_acc_squared[lane];
+        }
+    }
+
+    for (int lane = 0; lane < SIMD_LANES_F32; ++lane)
+    {
+        sum += acc[lane];
+        sum_squared += acc_squared[lane];
+    }
+}
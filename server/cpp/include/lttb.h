@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Largest-Triangle-Three-Buckets downsampling (Steinarsson 2013). Keeps the first and last
+// points and, from each of points - 2 equal buckets in between, the point that forms the
+// largest triangle with the point kept before it and the average of the next bucket. Peaks and
+// troughs survive, which taking every n-th point does not guarantee.
+//
+// x must be increasing. Writes the indices of the kept points (ascending) to out and returns
+// how many there are: min(points, n), at least 2 when n >= 2.
+inline int lttb(const double *x, const double *y, int n, int points, int *out)
+{
+    if (points >= n || n <= 2)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = i;
+        return n;
+    }
+    points = std::max(points, 2);
+
+    const double bucket = static_cast<double>(n - 2) / (points - 2);
+    int kept = 0;
+    int previous = 0;
+    out[kept++] = 0;
+    for (int b = 0; b < points - 2; b++)
+    {
+        // Average of the next bucket (the last point for the final bucket)
+        const int next_start = static_cast<int>(std::floor((b + 1) * bucket)) + 1;
+        const int next_end = std::min(static_cast<int>(std::floor((b + 2) * bucket)) + 1, n);
+        double avg_x = 0.0;
+        double avg_y = 0.0;
+        for (int i = next_start; i < next_end; i++)
+        {
+            avg_x += x[i];
+            avg_y += y[i];
+        }
+        avg_x /= next_end - next_start;
+        avg_y /= next_end - next_start;
+
+        const int start = static_cast<int>(std::floor(b * bucket)) + 1;
+        const int end = next_start;
+        double largest = -1.0;
+        int chosen = start;
+        for (int i = start; i < end; i++)
+        {
+            // Twice the triangle's area; the factor does not change the choice
+            const double area = std::fabs((x[previous] - avg_x) * (y[i] - y[previous]) -
+                                          (x[previous] - x[i]) * (avg_y - y[previous]));
+            if (area > largest)
+            {
+                largest = area;
+                chosen = i;
+            }
+        }
+        out[kept++] = chosen;
+        previous = chosen;
+    }
+    out[kept++] = n - 1;
+    return kept;
+}
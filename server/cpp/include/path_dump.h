@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bulk path dump (--dump-paths): every price of every simulated path, in a file that analysis
+// tools can memory-map. All fields are little-endian (the engine's native order).
+//
+//   [0, header_bytes)    PathDumpHeader, zero padded
+//   chunk c              at header_bytes + c * chunk_bytes, for c in [0, chunk_count)
+//
+// A chunk holds chunk_paths consecutive paths (the last one may hold fewer) stored
+// column-major: step j of path p within the chunk is value (j * chunk_paths + p), at time
+// (j + 1) * dt. The initial price S0 is in the header rather than repeated as a column. One
+// time step across all paths is one contiguous run per chunk, and any chunk can be mapped on
+// its own because chunk offsets are multiples of PATH_DUMP_ALIGNMENT.
+//
+// Chunk c is simulated from its own seed (derived from the header seed and c), so the contents
+// depend on the seed and layout only, not on how many threads wrote them.
+
+constexpr char PATH_DUMP_MAGIC[8] = {'M', 'C', 'P', 'A', 'T', 'H', 'S', '\0'};
+constexpr uint32_t PATH_DUMP_VERSION = 1;
+
+// Header size and chunk alignment: a page on every mainstream platform
+constexpr uint64_t PATH_DUMP_ALIGNMENT = 4096;
+
+// Default paths per chunk (4 MB of float32 at 252 steps), and the largest accepted layout
+constexpr int PATH_DUMP_DEFAULT_CHUNK_PATHS = 4096;
+constexpr int PATH_DUMP_DEFAULT_STEPS = 252;
+constexpr int PATH_DUMP_MAX_STEPS = 100000;
+constexpr int PATH_DUMP_MAX_CHUNK_PATHS = 1 << 20;
+
+struct PathDumpHeader
+{
+    char magic[8];         // PATH_DUMP_MAGIC; written last, so a file cut short has none
+    uint32_t version;      // PATH_DUMP_VERSION
+    uint32_t header_bytes; // Offset of chunk 0
+    uint32_t value_bytes;  // 4 (float32) or 8 (float64)
+    uint32_t steps;        // Values per path: prices at dt, 2 dt, ..., T
+    uint64_t paths;
+    uint64_t chunk_paths;  // Paths per chunk (column stride within a chunk)
+    uint64_t chunk_count;
+    uint64_t chunk_bytes;  // Distance between chunks, a multiple of PATH_DUMP_ALIGNMENT
+    uint64_t seed;
+    double S0;
+    double r;
+    double sigma;
+    double T;
+    double dt; // T / steps
+};
+
+static_assert(sizeof(PathDumpHeader) == 104, "PathDumpHeader layout is part of the file format");
+static_assert(sizeof(PathDumpHeader) <= PATH_DUMP_ALIGNMENT, "Header must fit before chunk 0");
+
+// Fill in the geometry fields of a header for paths x steps values of value_bytes each
+inline void path_dump_layout(PathDumpHeader &header, uint64_t paths, uint32_t steps, uint64_t chunk_paths,
+                             uint32_t value_bytes)
+{
+    header.version = PATH_DUMP_VERSION;
+    header.header_bytes = static_cast<uint32_t>(PATH_DUMP_ALIGNMENT);
+    header.value_bytes = value_bytes;
+    header.steps = steps;
+    header.paths = paths;
+    header.chunk_paths = chunk_paths;
+    header.chunk_count = (paths + chunk_paths - 1) / chunk_paths;
+    const uint64_t data_bytes = chunk_paths * steps * value_bytes;
+    header.chunk_bytes = (data_bytes + PATH_DUMP_ALIGNMENT - 1) / PATH_DUMP_ALIGNMENT * PATH_DUMP_ALIGNMENT;
+}
+
+inline uint64_t path_dump_file_bytes(const PathDumpHeader &header)
+{
+    return header.header_bytes + header.chunk_count * header.chunk_bytes;
+}
+
+// Paths stored in chunk c (chunk_paths except possibly for the last chunk)
+inline uint64_t path_dump_chunk_paths(const PathDumpHeader &header, uint64_t chunk)
+{
+    const uint64_t first = chunk * header.chunk_paths;
+    return first >= header.paths ? 0 : std::min(header.chunk_paths, header.paths - first);
+}
+
+// A dump file mapped into memory: created read-write at its full size for the engine's writer
+// threads, or opened read-only by analysis tools. Pages are only touched as they are accessed,
+// so neither side holds the whole file in memory. Writers fill disjoint chunks without locking.
+class PathDumpFile
+{
+public:
+    // Create (or truncate) path with the header's layout; the magic is written by finish()
+    static PathDumpFile create(const std::string &path, const PathDumpHeader &header)
+    {
+        PathDumpFile file;
+        file.fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (file.fd_ < 0)
+            fail("Cannot create " + path);
+        file.size_ = path_dump_file_bytes(header);
+        if (::ftruncate(file.fd_, static_cast<off_t>(file.size_)) != 0)
+            fail("Cannot size " + path);
+#if defined(__linux__)
+        // Reserve the blocks now: running out of disk later would fault the writers with SIGBUS
+        if (const int error = posix_fallocate(file.fd_, 0, static_cast<off_t>(file.size_)))
+        {
+            errno = error;
+            fail("Cannot allocate " + path);
+        }
+#endif
+        file.map(PROT_READ | PROT_WRITE, path);
+#ifdef MADV_SEQUENTIAL
+        madvise(file.base_, file.size_, MADV_SEQUENTIAL);
+#endif
+        std::memcpy(file.base_, &header, sizeof(header));
+        std::memset(file.base_, 0, sizeof(PATH_DUMP_MAGIC));
+        return file;
+    }
+
+    // Map an existing, complete dump read-only
+    static PathDumpFile open(const std::string &path)
+    {
+        PathDumpFile file;
+        file.fd_ = ::open(path.c_str(), O_RDONLY);
+        if (file.fd_ < 0)
+            fail("Cannot open " + path);
+        struct stat st;
+        if (::fstat(file.fd_, &st) != 0)
+            fail("Cannot stat " + path);
+        file.size_ = static_cast<uint64_t>(st.st_size);
+        if (file.size_ < sizeof(PathDumpHeader))
+            throw std::runtime_error(path + " is not a path dump");
+        file.map(PROT_READ, path);
+        const PathDumpHeader &header = file.header();
+        if (std::memcmp(header.magic, PATH_DUMP_MAGIC, sizeof(PATH_DUMP_MAGIC)) != 0 ||
+            header.version != PATH_DUMP_VERSION || path_dump_file_bytes(header) > file.size_)
+            throw std::runtime_error(path + " is not a complete version " + std::to_string(PATH_DUMP_VERSION) +
+                                     " path dump");
+        return file;
+    }
+
+    PathDumpFile(PathDumpFile &&other) noexcept
+        : fd_(other.fd_), base_(other.base_), size_(other.size_)
+    {
+        other.fd_ = -1;
+        other.base_ = nullptr;
+    }
+
+    PathDumpFile(const PathDumpFile &) = delete;
+    PathDumpFile &operator=(const PathDumpFile &) = delete;
+    PathDumpFile &operator=(PathDumpFile &&) = delete;
+
+    ~PathDumpFile()
+    {
+        if (base_)
+            munmap(base_, size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    const PathDumpHeader &header() const { return *reinterpret_cast<const PathDumpHeader *>(base_); }
+    uint64_t size() const { return size_; }
+
+    // First value of chunk c; cast to float or double according to header().value_bytes
+    char *chunk(uint64_t c) { return base_ + header().header_bytes + c * header().chunk_bytes; }
+    const char *chunk(uint64_t c) const { return base_ + header().header_bytes + c * header().chunk_bytes; }
+
+    // Mark the dump complete once every chunk is written. Dirty pages reach the disk through
+    // the page cache; readers mapping the file see them straight away.
+    void finish()
+    {
+        std::memcpy(base_, PATH_DUMP_MAGIC, sizeof(PATH_DUMP_MAGIC));
+    }
+
+private:
+    PathDumpFile() = default;
+
+    void map(int protection, const std::string &path)
+    {
+        void *base = mmap(nullptr, size_, protection, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED)
+            fail("Cannot map " + path);
+        base_ = static_cast<char *>(base);
+    }
+
+    [[noreturn]] static void fail(const std::string &what)
+    {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    int fd_ = -1;
+    char *base_ = nullptr;
+    uint64_t size_ = 0;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters read per worker thread in benchmark mode (--perf-counters)
+enum PerfEvent
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,  // Last-level cache misses
+    PERF_BRANCH_MISSES,
+    PERF_VECTOR_FP_OPS, // Packed FP instructions retired (Intel FP_ARITH_INST_RETIRED, 128/256/512-bit)
+    PERF_EVENT_COUNT
+};
+
+// Counter values for one measured interval. Values are scaled for multiplexing; an event the
+// kernel or CPU cannot count (VMs without a virtual PMU, non-Intel vector-FP) is unavailable.
+struct PerfCounts
+{
+    uint64_t values[PERF_EVENT_COUNT] = {};
+    bool available[PERF_EVENT_COUNT] = {};
+};
+
+// Sum of several intervals; an event is available in the total only if every part counted it
+template <typename Iterator, typename Projection>
+PerfCounts sum_perf_counts(Iterator first, Iterator last, Projection counts_of)
+{
+    PerfCounts total;
+    if (first == last)
+        return total;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        total.available[i] = true;
+    for (; first != last; ++first)
+    {
+        const PerfCounts &part = counts_of(*first);
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        {
+            total.values[i] += part.values[i];
+            total.available[i] = total.available[i] && part.available[i];
+        }
+    }
+    return total;
+}
+
+// Counters for the calling thread (user space only, so perf_event_paranoid <= 2 suffices).
+// Each event is opened on its own rather than as a group, so an unsupported event does not
+// take the others down with it.
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+            fds_[i] = -1;
+#if defined(__linux__)
+        fds_[PERF_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[PERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[PERF_CACHE_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[PERF_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if (cpu_is_intel())
+        {
+            // FP_ARITH_INST_RETIRED (event 0xC7), umask 0xFC = all packed single/double widths
+            fds_[PERF_VECTOR_FP_OPS] = open_event(PERF_TYPE_RAW, 0xFCC7);
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    void start()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    PerfCounts stop()
+    {
+        PerfCounts counts;
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        {
+            if (fds_[i] < 0)
+                continue;
+            // value, time_enabled, time_running
+            uint64_t data[3];
+            if (::read(fds_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+                continue;
+            const double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            counts.values[i] = static_cast<uint64_t>(data[0] * scale);
+            counts.available[i] = true;
+        }
+#endif
+        return counts;
+    }
+
+private:
+#if defined(__linux__)
+    static int open_event(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1, -1, 0));
+    }
+
+    static bool cpu_is_intel()
+    {
+        static const bool intel = []
+        {
+            std::ifstream cpuinfo("/proc/cpuinfo");
+            std::string line;
+            while (std::getline(cpuinfo, line))
+            {
+                if (line.compare(0, 9, "vendor_id") == 0)
+                    return line.find("GenuineIntel") != std::string::npos;
+            }
+            return false;
+        }();
+        return intel;
+    }
+#endif
+
+    int fds_[PERF_EVENT_COUNT];
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Phases of a pricing request reported by --timing
+enum Phase
+{
+    PHASE_PARSE,        // Request/argument parsing
+    PHASE_VALIDATE,     // Input validation
+    PHASE_THREAD_START, // Job start until the worker begins (spawn latency, worker setup and the first
+                        // touch of its buffers; worker 0 pays for the spawning)
+    PHASE_RNG,          // Uniform generation + Box-Muller
+    PHASE_PATHS,        // exp, payoff and accumulation
+    PHASE_REDUCTION,    // Combining worker results at join
+    PHASE_OUTPUT,       // Formatting the response
+    PHASE_COUNT
+};
+
+inline const char *phase_name(Phase phase)
+{
+    static const char *const names[PHASE_COUNT] = {"parse", "validate", "threadStart", "rng",
+                                                   "pathEvaluation", "reduction", "output"};
+    return names[phase];
+}
+
+// Cheap monotonic tick counter: the TSC on x86 (invariant on every CPU this runs on),
+// steady_clock nanoseconds elsewhere
+inline uint64_t read_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Ticks per nanosecond, calibrated once against steady_clock over ~2 ms
+inline double ticks_per_ns()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const double rate = []
+    {
+        const auto wall_start = std::chrono::steady_clock::now();
+        const uint64_t tick_start = read_ticks();
+        auto wall_end = wall_start;
+        while (wall_end - wall_start < std::chrono::milliseconds(2))
+            wall_end = std::chrono::steady_clock::now();
+        const uint64_t tick_end = read_ticks();
+        return (tick_end - tick_start) / std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+    }();
+    return rate;
+#else
+    return 1.0;
+#endif
+}
+
+inline double ticks_to_ms(uint64_t ticks)
+{
+    return ticks / ticks_per_ns() * 1e-6;
+}
+
+// Accumulated ticks per phase
+struct PhaseTimes
+{
+    uint64_t ticks[PHASE_COUNT] = {};
+
+    void add(Phase phase, uint64_t elapsed) { ticks[phase] += elapsed; }
+
+    PhaseTimes &operator+=(const PhaseTimes &other)
+    {
+        for (int i = 0; i < PHASE_COUNT; ++i)
+            ticks[i] += other.ticks[i];
+        return *this;
+    }
+};
+
+// Adds the lifetime of the scope to one phase
+class ScopedPhase
+{
+public:
+    ScopedPhase(PhaseTimes &times, Phase phase) : times_(times), phase_(phase), start_(read_ticks()) {}
+    ~ScopedPhase() { times_.add(phase_, read_ticks() - start_); }
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+private:
+    PhaseTimes &times_;
+    Phase phase_;
+    uint64_t start_;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "phase_timer.h"
+
+// W3C trace context propagated from the Node service (--trace=<traceparent>, or the
+// trace extension of the binary protocol). The engine records its own spans under the
+// caller's span and returns them with the response; Node exports them with its own.
+
+// Spans the engine reports
+enum TraceSpanKind : uint32_t
+{
+    TRACE_SPAN_PROCESS,  // One-shot run, from main() to the formatted result
+    TRACE_SPAN_JOB,      // Server mode request, from the reader picking it up to the response
+    TRACE_SPAN_PARSE,    // Argument/request parsing
+    TRACE_SPAN_VALIDATE, // Input validation
+    TRACE_SPAN_QUEUE,    // Waiting for the executor (server mode)
+    TRACE_SPAN_SIMULATE, // Pricing, including thread start-up and reduction
+    TRACE_SPAN_OUTPUT,   // Formatting the response
+    TRACE_SPAN_KIND_COUNT
+};
+
+inline const char *trace_span_name(uint32_t kind)
+{
+    static const char *const names[TRACE_SPAN_KIND_COUNT] = {"engine.process", "engine.job", "engine.parse",
+                                                             "engine.validate", "engine.queue", "engine.simulate",
+                                                             "engine.output"};
+    return kind < TRACE_SPAN_KIND_COUNT ? names[kind] : "engine.unknown";
+}
+
+struct TraceContext
+{
+    uint8_t trace_id[16] = {};
+    uint8_t parent_span_id[8] = {};
+    bool enabled = false;
+};
+
+inline int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+inline bool parse_hex(const std::string &text, size_t offset, uint8_t *bytes, size_t count)
+{
+    bool any_set = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int high = hex_digit(text[offset + 2 * i]);
+        const int low = hex_digit(text[offset + 2 * i + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        bytes[i] = static_cast<uint8_t>(high << 4 | low);
+        any_set |= bytes[i] != 0;
+    }
+    return any_set; // All-zero ids are invalid
+}
+
+// "00-<32 hex trace id>-<16 hex parent span id>-<2 hex flags>"; false if malformed
+inline bool parse_traceparent(const std::string &header, TraceContext &context)
+{
+    if (header.size() != 55 || header[2] != '-' || header[35] != '-' || header[52] != '-' ||
+        header.compare(0, 2, "00") != 0)
+        return false;
+    if (!parse_hex(header, 3, context.trace_id, 16) || !parse_hex(header, 36, context.parent_span_id, 8))
+        return false;
+    context.enabled = true;
+    return true;
+}
+
+inline std::string hex_encode(const uint8_t *bytes, size_t count)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text(2 * count, '0');
+    for (size_t i = 0; i < count; ++i)
+    {
+        text[2 * i] = digits[bytes[i] >> 4];
+        text[2 * i + 1] = digits[bytes[i] & 0xF];
+    }
+    return text;
+}
+
+// Nanoseconds since the Unix epoch for a read_ticks() value (anchored once per process)
+inline uint64_t ticks_to_unix_ns(uint64_t ticks)
+{
+    static const uint64_t anchor_ticks = read_ticks();
+    static const uint64_t anchor_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::system_clock::now().time_since_epoch())
+                                          .count();
+    const double offset_ns = (static_cast<double>(ticks) - static_cast<double>(anchor_ticks)) / ticks_per_ns();
+    return anchor_ns + static_cast<int64_t>(offset_ns);
+}
+
+struct TraceSpan
+{
+    uint8_t span_id[8];
+    uint8_t parent_span_id[8];
+    uint32_t kind;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+};
+
+// Collects the spans of one traced request. The first span recorded is the root and is
+// parented to the caller's span; later spans are its children.
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(const TraceContext &context) : context_(context) {}
+
+    bool enabled() const { return context_.enabled; }
+    const TraceContext &context() const { return context_; }
+    const std::vector<TraceSpan> &spans() const { return spans_; }
+
+    void record(uint32_t kind, uint64_t start_ticks, uint64_t end_ticks)
+    {
+        if (!context_.enabled)
+            return;
+        TraceSpan span;
+        span.kind = kind;
+        span.start_ticks = start_ticks;
+        span.end_ticks = end_ticks;
+        new_span_id(span.span_id);
+        const uint8_t *parent = spans_.empty() ? context_.parent_span_id : spans_.front().span_id;
+        std::copy(parent, parent + 8, span.parent_span_id);
+        spans_.push_back(span);
+    }
+
+    // Close the root span (recorded first, before its end is known)
+    void end_root(uint64_t end_ticks)
+    {
+        if (!spans_.empty())
+            spans_.front().end_ticks = end_ticks;
+    }
+
+private:
+    static void new_span_id(uint8_t *id)
+    {
+        thread_local std::mt19937_64 generator(std::random_device{}());
+        uint64_t bits;
+        do
+        {
+            bits = generator();
+        } while (bits == 0);
+        for (int i = 0; i < 8; ++i)
+            id[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+
+    TraceContext context_;
+    std::vector<TraceSpan> spans_;
+};
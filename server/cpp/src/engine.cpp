@@ -0,0 +1,1097 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <numeric> // For std::accumulate
+#include <memory>  // For std::unique_ptr
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+#include "engine.h"
+#include "arena.h"
+#include "lttb.h"
+
+// Batch size for random number generation - increased for better cache utilization
+constexpr int RANDOM_BATCH_SIZE = 4096;
+
+// Jobs at or below this many trials always run inline on the calling thread
+constexpr int INLINE_TRIAL_THRESHOLD = 4096;
+
+// Approximate cost of one path (normal draw + exp + payoff) used to size the thread pool
+constexpr double ESTIMATED_NS_PER_PATH = 20.0;
+
+// Paths a worker simulates between progress updates (about a millisecond of work)
+constexpr long PROGRESS_BLOCK_PATHS = 1L << 16;
+
+// Discounted mean and 95% confidence interval from payoff sums, using E[X²] - (E[X])²
+static void estimate_price(double sum, double sum_squared, long count, double discount,
+                           double &price, double &lower, double &upper)
+{
+    const double mean = sum / count;
+    const double discounted_mean = mean * discount;
+    const double variance = (sum_squared / count) - (mean * mean);
+    const double margin_of_error = 1.96 * (std::sqrt(variance) / std::sqrt(count)) * discount;
+    price = discounted_mean;
+    lower = discounted_mean - margin_of_error;
+    upper = discounted_mean + margin_of_error;
+}
+
+// Running totals of a job with --progress. Workers add each finished block; the block that
+// crosses the next report time reports the estimate over every path simulated so far.
+class ProgressTracker
+{
+public:
+    ProgressTracker(const SimulationOptions &options, long total_paths, double discount)
+        : options_(options), total_paths_(total_paths), discount_(discount),
+          interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double, std::milli>(options.progress_interval_ms))),
+          next_report_(std::chrono::steady_clock::now() + interval_)
+    {
+    }
+
+    void add(long paths, double sum, double sum_squared)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paths_ += paths;
+        sum_ += sum;
+        sum_squared_ += sum_squared;
+        const auto now = std::chrono::steady_clock::now();
+        if (paths_ >= total_paths_ || now < next_report_)
+            return; // The final result covers a finished job
+        next_report_ = now + interval_;
+        ProgressReport report{paths_, total_paths_, 0.0, 0.0, 0.0};
+        estimate_price(sum_, sum_squared_, paths_, discount_, report.price, report.lower, report.upper);
+        options_.on_progress(report);
+    }
+
+private:
+    const SimulationOptions &options_;
+    const long total_paths_;
+    const double discount_;
+    const std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point next_report_;
+    std::mutex mutex_;
+    long paths_ = 0;
+    double sum_ = 0.0;
+    double sum_squared_ = 0.0;
+};
+
+// Function to calculate option price using Monte Carlo simulation
+void monte_carlo_black_scholes(double S0, double K, double r, double sigma,
+                               double T, bool isCall, int numTrials,
+                               double &price, double &lower, double &upper)
+{
+    // Validate inputs
+    if (S0 <= 0.0)
+    {
+        throw std::invalid_argument("Stock price (S0) must be positive");
+    }
+    if (K <= 0.0)
+    {
+        throw std::invalid_argument("Strike price (K) must be positive");
+    }
+    if (sigma <= 0.0)
+    {
+        throw std::invalid_argument("Volatility (sigma) must be positive");
+    }
+    if (T <= 0.0)
+    {
+        throw std::invalid_argument("Time to maturity (T) must be positive");
+    }
+    if (numTrials <= 0)
+    {
+        throw std::invalid_argument("Number of trials must be positive");
+    }
+
+    // Take payoff and scratch buffers from the worker arena (huge-page backed when available)
+    // instead of the heap; the arena is rewound when this job returns
+    Arena &arena = worker_arena();
+    ArenaScope arena_scope(arena);
+    double *payoffs = arena.allocate<double>(numTrials);
+
+    // Initialize random number generator once with a good seed
+    std::mt19937_64 gen(std::random_device{}()); // Use 64-bit Mersenne Twister for better quality
+    std::normal_distribution<> norm_dist(0.0, 1.0);
+
+    // Pre-calculate constants to reduce operations in the loop
+    const double drift = (r - 0.5 * sigma * sigma) * T;
+    const double volatility = sigma * sqrt(T);
+    const double discount = exp(-r * T);
+
+    // Pre-generate batch of random numbers (64-byte aligned arena storage for SIMD)
+    double *random_numbers = arena.allocate<double>(RANDOM_BATCH_SIZE);
+
+    // Calculate each path with aggressive loop unrolling (8 at a time)
+    int i = 0;
+    while (i < numTrials)
+    {
+        // Refill random number batch when needed
+        if (i % RANDOM_BATCH_SIZE == 0)
+        {
+            for (int j = 0; j < RANDOM_BATCH_SIZE && i + j < numTrials; ++j)
+            {
+                random_numbers[j] = norm_dist(gen);
+            }
+        }
+
+        // Process 8 paths at once (more aggressive loop unrolling)
+        const int batch_end = std::min(i + 8, numTrials);
+        for (int j = i; j < batch_end; ++j)
+        {
+            // Get random number from pre-generated batch
+            const double z = random_numbers[j % RANDOM_BATCH_SIZE];
+
+            // Calculate stock price at maturity (minimizing operations)
+            const double ST = S0 * exp(drift + volatility * z);
+
+            // Calculate payoff using inline function
+            payoffs[j] = calculate_payoff(ST, K, isCall);
+        }
+        i = batch_end;
+    }
+
+    // Calculate the average payoff using std::accumulate for better optimization
+    double sum = std::accumulate(payoffs, payoffs + numTrials, 0.0);
+    double mean = sum / numTrials;
+    double discounted_mean = mean * discount;
+
+    // Calculate variance and standard deviation with optimized loop
+    double variance = 0.0;
+    for (int j = 0; j < numTrials; ++j)
+    {
+        double diff = payoffs[j] - mean;
+        variance += diff * diff; // Avoid pow() function call
+    }
+    variance /= (numTrials - 1);
+    double std_dev = sqrt(variance);
+
+    // Calculate 95% confidence interval (1.96 is the z-score for 95% confidence)
+    double margin_of_error = 1.96 * (std_dev / sqrt(numTrials)) * discount;
+
+    // Set output values
+    price = discounted_mean;
+    lower = discounted_mean - margin_of_error;
+    upper = discounted_mean + margin_of_error;
+}
+
+// Measure the cost of starting and joining one thread, cached for the process lifetime
+double measure_thread_overhead_ns()
+{
+    static const double overhead_ns = []
+    {
+        double best = 1e12;
+        for (int i = 0; i < 2; ++i) // First spawn also pays for the stack mapping, keep the minimum
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::thread([] {}).join();
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        return best;
+    }();
+    return overhead_ns;
+}
+
+int hardware_thread_count()
+{
+    const int threads = static_cast<int>(std::thread::hardware_concurrency());
+    return threads > 0 ? threads : 4; // Default to 4 if can't determine
+}
+
+// Pick the number of threads for a job. An explicit request is honoured up to the hardware
+// thread count; otherwise the count follows from the job size, since with n threads started
+// serially the wall time is roughly work/n + n*overhead, which is minimised at n = sqrt(work/overhead).
+int choose_thread_count(int numTrials, int requested_threads)
+{
+    const int max_threads = hardware_thread_count();
+    if (requested_threads > 0)
+    {
+        return std::max(1, std::min({requested_threads, max_threads, numTrials}));
+    }
+
+    // Tiny jobs finish faster than a single thread can be started - skip even the calibration
+    if (numTrials <= INLINE_TRIAL_THRESHOLD)
+    {
+        return 1;
+    }
+
+    const double work_ns = numTrials * ESTIMATED_NS_PER_PATH;
+    const int ideal = static_cast<int>(std::sqrt(work_ns / measure_thread_overhead_ns()));
+    return std::max(1, std::min({ideal, max_threads, numTrials}));
+}
+
+// Run worker(0) on the calling thread and worker(1..workers-1) on new threads. Every thread
+// that was started is joined before this returns or throws, so a failed thread creation
+// (std::system_error) or a throwing worker reaches the caller instead of terminating the process.
+template <typename Worker>
+static void run_workers(int workers, Worker worker)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    auto join_all = [&threads]
+    {
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    };
+    try
+    {
+        for (int w = 1; w < workers; w++)
+        {
+            threads.emplace_back(worker, w);
+        }
+        worker(0);
+    }
+    catch (...)
+    {
+        join_all();
+        throw;
+    }
+    join_all();
+}
+
+// Normals per block of the split kernels (a worker arena buffer that stays in L1)
+constexpr long TIMED_BLOCK = 1024;
+
+// Split kernel for --timing: normals go through a small buffer z of TIMED_BLOCK values so their
+// generation and the path evaluation can be timed apart. Slower than the fused kernel and
+// always double precision.
+static void timed_gbm_payoff(LaneRng &rng, long num_paths, double S0, double K, double drift,
+                             double volatility, bool isCall, double &sum, double &sum_squared,
+                             PhaseTimes &phases, double *z)
+{
+    for (long start = 0; start < num_paths; start += TIMED_BLOCK)
+    {
+        const long n = std::min(TIMED_BLOCK, num_paths - start);
+        const uint64_t t0 = read_ticks();
+        fill_normals(rng, z, n);
+        const uint64_t t1 = read_ticks();
+        gbm_payoff_from_normals(z, n, S0, K, drift, volatility, isCall, sum, sum_squared);
+        const uint64_t t2 = read_ticks();
+        phases.add(PHASE_RNG, t1 - t0);
+        phases.add(PHASE_PATHS, t2 - t1);
+    }
+}
+
+// Payoff sums of the paths simulated so far
+struct PathSums
+{
+    double sum;
+    double sum_squared;
+};
+
+// Run one worker's share through kernel(num_paths, sum, sum_squared) in segments. A segment
+// ends at each convergence cut, where the running sums are recorded in at_cuts, and (with a
+// progress tracker) after at most PROGRESS_BLOCK_PATHS paths, each block being added to the
+// running estimate. The generators carry over between segments; the progress blocks are whole
+// lane steps, so without cuts the paths are the same as in one call.
+template <typename Kernel>
+static void simulate_share(long share, ProgressTracker *progress, const std::vector<long> &cuts,
+                           std::vector<PathSums> &at_cuts, double &sum, double &sum_squared, Kernel &&kernel)
+{
+    const long block_limit = progress ? PROGRESS_BLOCK_PATHS : share;
+    size_t next_cut = 0;
+    long done = 0;
+    for (;;)
+    {
+        while (next_cut < cuts.size() && cuts[next_cut] <= done)
+        {
+            at_cuts[next_cut++] = {sum, sum_squared};
+        }
+        if (done >= share)
+            break;
+
+        long end = std::min(share, done + block_limit);
+        if (next_cut < cuts.size())
+            end = std::min(end, cuts[next_cut]);
+        double block_sum = 0.0;
+        double block_sum_squared = 0.0;
+        kernel(end - done, block_sum, block_sum_squared);
+        sum += block_sum;
+        sum_squared += block_sum_squared;
+        if (progress)
+            progress->add(end - done, block_sum, block_sum_squared);
+        done = end;
+    }
+}
+
+// Split kernel for --distribution: each block's terminal prices and payoffs are computed into
+// buffers z and payoffs of TIMED_BLOCK values (the pricing loop stays vectorized), then added
+// to the worker's histograms and sketch. Always double precision.
+static void distribution_gbm_payoff(LaneRng &rng, long num_paths, double S0, double K, double drift,
+                                    double volatility, bool isCall, double &sum, double &sum_squared,
+                                    PathDistribution &distribution, double *z, double *payoffs)
+{
+    for (long start = 0; start < num_paths; start += TIMED_BLOCK)
+    {
+        const long n = std::min(TIMED_BLOCK, num_paths - start);
+        fill_normals(rng, z, n);
+        for (long i = 0; i < n; ++i)
+        {
+            const double ST = S0 * std::exp(drift + volatility * z[i]);
+            const double payoff = calculate_payoff(ST, K, isCall);
+            sum += payoff;
+            sum_squared += payoff * payoff;
+            z[i] = ST;
+            payoffs[i] = payoff;
+        }
+        for (long i = 0; i < n; ++i)
+        {
+            distribution.add(z[i], payoffs[i]);
+        }
+    }
+}
+
+// Empty --distribution collector for one worker. Histograms cover terminal prices within
+// 5 standard deviations of the log-price mean (all but about 6e-7 of paths) and payoffs from
+// 0 to the largest payoff in that range; rarer paths land in below/above.
+static PathDistribution make_distribution(double S0, double K, double drift, double volatility,
+                                          bool isCall, int bins, uint64_t seed)
+{
+    const double low = S0 * std::exp(drift - 5.0 * volatility);
+    const double high = S0 * std::exp(drift + 5.0 * volatility);
+    const double max_payoff = std::max(calculate_payoff(low, K, isCall), calculate_payoff(high, K, isCall));
+    return PathDistribution(low, high, max_payoff > 0.0 ? max_payoff : 1.0, bins, K, isCall, seed);
+}
+
+// Multi-threaded version for better performance
+void monte_carlo_black_scholes_mt(double S0, double K, double r, double sigma,
+                                  double T, bool isCall, int numTrials, int num_threads,
+                                  double &price, double &lower, double &upper,
+                                  const SimulationOptions &options)
+{
+    const bool timing = options.timing && options.instrumentation;
+    const uint64_t validate_start = timing ? read_ticks() : 0;
+
+    // Validate inputs
+    if (S0 <= 0.0)
+    {
+        throw std::invalid_argument("Stock price (S0) must be positive");
+    }
+    if (K <= 0.0)
+    {
+        throw std::invalid_argument("Strike price (K) must be positive");
+    }
+    if (sigma <= 0.0)
+    {
+        throw std::invalid_argument("Volatility (sigma) must be positive");
+    }
+    if (T <= 0.0)
+    {
+        throw std::invalid_argument("Time to maturity (T) must be positive");
+    }
+    if (numTrials <= 0)
+    {
+        throw std::invalid_argument("Number of trials must be positive");
+    }
+    const bool collect_distribution = options.distribution && options.distribution_bins > 0;
+    if (collect_distribution && options.timing)
+    {
+        throw std::invalid_argument("--timing and --distribution cannot be combined");
+    }
+    // The split kernels are double only; a silent fallback would misreport the run
+    if (collect_distribution && options.precision == Precision::Single)
+    {
+        throw std::invalid_argument("--distribution requires --precision=double");
+    }
+    if (options.timing && options.precision == Precision::Single)
+    {
+        throw std::invalid_argument("--timing requires --precision=double");
+    }
+
+    // Determine number of threads to use (1 means the job runs inline on this thread)
+    num_threads = choose_thread_count(numTrials, num_threads);
+
+    PhaseTimes job_phases;
+    if (timing)
+    {
+        job_phases.add(PHASE_VALIDATE, read_ticks() - validate_start);
+    }
+
+    // Calculate trials per thread - ensure even distribution
+    int trials_per_thread = numTrials / num_threads;
+    int remaining_trials = numTrials % num_threads;
+
+    // Pre-calculate constants to reduce operations in the loop
+    const double drift = (r - 0.5 * sigma * sigma) * T;
+    const double volatility = sigma * sqrt(T);
+    const double discount = exp(-r * T);
+
+    // Structure to hold thread-local statistical accumulators
+    struct ThreadResult
+    {
+        double sum;
+        double sum_squared;
+        int count;
+    };
+
+    // Vector to store thread results (much smaller than storing all payoffs)
+    std::vector<ThreadResult> thread_results(num_threads, {0.0, 0.0, 0});
+
+    // Per-worker reports, only when the caller asked for instrumentation
+    std::vector<WorkerReport> reports(options.instrumentation ? num_threads : 0);
+
+    // Running estimate for --progress, fed one block of paths at a time
+    std::unique_ptr<ProgressTracker> progress;
+    if (options.progress_interval_ms > 0.0 && options.on_progress)
+    {
+        progress.reset(new ProgressTracker(options, numTrials, discount));
+    }
+
+    // --convergence checkpoints (start, 2x start, ... and numTrials). Checkpoint k covers the
+    // first cuts[t][k] paths of each worker t, split like the shares, so every worker records
+    // its running sums at its own cuts and no per-path payoffs are kept.
+    std::vector<long> checkpoints;
+    if (options.convergence && options.convergence_start > 0)
+    {
+        for (long paths = options.convergence_start; paths < numTrials; paths *= 2)
+        {
+            checkpoints.push_back(paths);
+        }
+        checkpoints.push_back(numTrials);
+    }
+    // --distribution collectors, one per worker, merged at join
+    std::vector<PathDistribution> distributions;
+    for (int t = 0; t < num_threads && collect_distribution; t++)
+    {
+        distributions.push_back(make_distribution(S0, K, drift, volatility, isCall, options.distribution_bins, t + 1));
+    }
+
+    std::vector<std::vector<long>> cuts(num_threads);
+    std::vector<std::vector<PathSums>> sums_at_cuts(num_threads, std::vector<PathSums>(checkpoints.size()));
+    for (int t = 0; t < num_threads && !checkpoints.empty(); t++)
+    {
+        const long share = trials_per_thread + (t < remaining_trials ? 1 : 0);
+        for (long paths : checkpoints)
+        {
+            cuts[t].push_back(std::min(share, paths / num_threads + (t < paths % num_threads ? 1 : 0)));
+        }
+    }
+
+    // Function to be executed by each thread
+    const uint64_t job_start = timing ? read_ticks() : 0;
+    auto thread_func = [&](int thread_id, int start_trial, int end_trial)
+    {
+        PhaseTimes phases;
+
+        // Split kernel buffers come from this worker's arena; a batch worker pricing contracts
+        // inline reuses the same pages for every contract
+        Arena &arena = worker_arena();
+        ArenaScope arena_scope(arena);
+
+        // Initialize thread-local accumulators
+        double local_sum = 0.0;
+        double local_sum_squared = 0.0;
+
+        // Independent vector RNG per thread, seeded from the clock and the thread id
+        const uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count() + thread_id;
+
+        // Hardware counters cover the kernel only (opening them costs a few syscalls)
+        std::unique_ptr<PerfCounters> counters;
+        if (options.perf_counters)
+        {
+            counters.reset(new PerfCounters());
+            counters->start();
+        }
+
+        // Fused kernel: normals are consumed in registers as they are generated,
+        // no intermediate random-number buffer
+        const long share = end_trial - start_trial;
+        if (timing)
+        {
+            LaneRng rng(seed);
+            double *z = arena.allocate<double>(TIMED_BLOCK);
+            // A fresh worker's arena pages fault on first touch; take that here, in threadStart,
+            // so rng times generation only
+            prefault(z, TIMED_BLOCK * sizeof(double));
+            phases.add(PHASE_THREAD_START, read_ticks() - job_start);
+            simulate_share(share, progress.get(), cuts[thread_id], sums_at_cuts[thread_id], local_sum, local_sum_squared,
+                           [&](long n, double &sum, double &sum_squared)
+                           { timed_gbm_payoff(rng, n, S0, K, drift, volatility, isCall, sum, sum_squared, phases, z); });
+        }
+        else if (collect_distribution)
+        {
+            LaneRng rng(seed);
+            PathDistribution &distribution = distributions[thread_id];
+            double *z = arena.allocate<double>(TIMED_BLOCK);
+            double *payoffs = arena.allocate<double>(TIMED_BLOCK);
+            simulate_share(share, progress.get(), cuts[thread_id], sums_at_cuts[thread_id], local_sum, local_sum_squared,
+                           [&](long n, double &sum, double &sum_squared)
+                           { distribution_gbm_payoff(rng, n, S0, K, drift, volatility, isCall, sum, sum_squared, distribution,
+                                                     z, payoffs); });
+        }
+        else if (options.precision == Precision::Single)
+        {
+            LaneRngF32 rng(seed);
+            simulate_share(share, progress.get(), cuts[thread_id], sums_at_cuts[thread_id], local_sum, local_sum_squared,
+                           [&](long n, double &sum, double &sum_squared)
+                           { fused_gbm_payoff_f32(rng, n, S0, K, drift, volatility, isCall, sum, sum_squared); });
+        }
+        else
+        {
+            LaneRng rng(seed);
+            simulate_share(share, progress.get(), cuts[thread_id], sums_at_cuts[thread_id], local_sum, local_sum_squared,
+                           [&](long n, double &sum, double &sum_squared)
+                           { fused_gbm_payoff(rng, n, S0, K, drift, volatility, isCall, sum, sum_squared); });
+        }
+
+        const PerfCounts counts = counters ? counters->stop() : PerfCounts();
+
+        // Store thread results (only 3 values, not an entire vector)
+        thread_results[thread_id] = {local_sum, local_sum_squared, end_trial - start_trial};
+        if (options.instrumentation)
+        {
+            reports[thread_id] = {thread_id, end_trial - start_trial, counts, phases};
+        }
+    };
+
+    // Helper threads take shares 1..n-1 and the calling thread share 0
+    // (for single-threaded jobs no thread is created at all)
+    std::vector<int> share_start(num_threads + 1, 0);
+    for (int i = 0; i < num_threads; i++)
+    {
+        share_start[i + 1] = share_start[i] + trials_per_thread + (i < remaining_trials ? 1 : 0);
+    }
+    run_workers(num_threads, [&](int i)
+                { thread_func(i, share_start[i], share_start[i + 1]); });
+
+    const uint64_t reduction_start = timing ? read_ticks() : 0;
+
+    // Combine results from all threads (much faster now)
+    double total_sum = 0.0;
+    double total_sum_squared = 0.0;
+    int total_count = 0;
+
+    for (const auto &result : thread_results)
+    {
+        total_sum += result.sum;
+        total_sum_squared += result.sum_squared;
+        total_count += result.count;
+    }
+
+    // Discounted mean and 95% confidence interval
+    estimate_price(total_sum, total_sum_squared, total_count, discount, price, lower, upper);
+
+    if (collect_distribution)
+    {
+        *options.distribution = std::move(distributions[0]);
+        for (int t = 1; t < num_threads; t++)
+        {
+            options.distribution->merge(distributions[t]);
+        }
+    }
+
+    // Merge the workers' running sums at each checkpoint
+    if (!checkpoints.empty())
+    {
+        options.convergence->clear();
+        for (size_t k = 0; k < checkpoints.size(); k++)
+        {
+            ConvergencePoint point{0, 0.0, 0.0, 0.0};
+            double sum = 0.0;
+            double sum_squared = 0.0;
+            for (int t = 0; t < num_threads; t++)
+            {
+                point.paths += cuts[t][k];
+                sum += sums_at_cuts[t][k].sum;
+                sum_squared += sums_at_cuts[t][k].sum_squared;
+            }
+            estimate_price(sum, sum_squared, point.paths, discount, point.price, point.lower, point.upper);
+            options.convergence->push_back(point);
+        }
+    }
+
+    if (options.instrumentation)
+    {
+        if (timing)
+        {
+            job_phases.add(PHASE_REDUCTION, read_ticks() - reduction_start);
+        }
+        options.instrumentation->workers = std::move(reports);
+        options.instrumentation->phases = job_phases;
+    }
+}
+
+// Batch pricing. With at least as many contracts as threads the contracts themselves are
+// the unit of parallelism (each priced on one thread, no per-contract thread start-up);
+// otherwise they are priced one after another with the multi-threaded engine.
+int price_batch(const BatchContract *contracts, int count, int numTrials, int num_threads,
+                double *prices, double *lowers, double *uppers,
+                const SimulationOptions &options)
+{
+    if (count <= 0)
+    {
+        throw std::invalid_argument("Batch must contain at least one contract");
+    }
+
+    // Size the pool from the total work of the batch
+    const long long total_trials = static_cast<long long>(count) * numTrials;
+    const int workers = choose_thread_count(
+        static_cast<int>(std::min<long long>(total_trials, std::numeric_limits<int>::max())), num_threads);
+
+    if (count < workers)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const BatchContract &c = contracts[i];
+            monte_carlo_black_scholes_mt(c.S0, c.K, c.r, c.sigma, c.T, c.isCall, numTrials, workers,
+                                         prices[i], lowers[i], uppers[i], options);
+        }
+        return workers;
+    }
+
+    std::atomic<int> next_contract{0};
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+
+    auto worker = [&]()
+    {
+        int i;
+        while ((i = next_contract.fetch_add(1, std::memory_order_relaxed)) < count)
+        {
+            const BatchContract &c = contracts[i];
+            try
+            {
+                monte_carlo_black_scholes_mt(c.S0, c.K, c.r, c.sigma, c.T, c.isCall, numTrials, 1,
+                                             prices[i], lowers[i], uppers[i], options);
+            }
+            catch (...)
+            {
+                // Stop handing out work and report the first failure from the calling thread
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error)
+                    first_error = std::current_exception();
+                next_contract.store(count, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    run_workers(workers, [&](int)
+                { worker(); });
+
+    if (first_error)
+    {
+        std::rethrow_exception(first_error);
+    }
+    return workers;
+}
+
+void validate_sample_paths(const SamplePathsSpec &spec)
+{
+    if (spec.S0 <= 0.0 || spec.sigma <= 0.0 || spec.T <= 0.0)
+        throw std::invalid_argument("S0, sigma and T must be positive");
+    if (spec.count < 1 || spec.count > SAMPLE_PATHS_MAX_COUNT)
+        throw std::invalid_argument("Path count must be between 1 and " + std::to_string(SAMPLE_PATHS_MAX_COUNT));
+    if (spec.steps < 1 || spec.steps > SAMPLE_PATHS_MAX_STEPS)
+        throw std::invalid_argument("Steps must be between 1 and " + std::to_string(SAMPLE_PATHS_MAX_STEPS));
+    if (spec.points < 2 || spec.points > SAMPLE_PATHS_MAX_POINTS || spec.points > spec.steps + 1)
+        throw std::invalid_argument("Points must be between 2 and min(steps + 1, " +
+                                    std::to_string(SAMPLE_PATHS_MAX_POINTS) + ")");
+}
+
+// Paths are simulated one at a time at full resolution (exact GBM increments, so the time
+// grid does not bias them) and reduced by LTTB; only steps + 1 prices are held at once.
+void sample_paths(const SamplePathsSpec &spec, float *times, float *prices)
+{
+    validate_sample_paths(spec);
+    const int n = spec.steps + 1;
+    const double dt = spec.T / spec.steps;
+    const double drift_dt = (spec.r - 0.5 * spec.sigma * spec.sigma) * dt;
+    const double vol_sqrt_dt = spec.sigma * std::sqrt(dt);
+    const uint64_t seed = spec.seed != 0 ? spec.seed
+                                         : std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    LaneRng rng(seed);
+
+    Arena &arena = worker_arena();
+    ArenaScope arena_scope(arena);
+    double *t = arena.allocate<double>(n);
+    double *S = arena.allocate<double>(n);
+    double *z = arena.allocate<double>(n);
+    int *kept = arena.allocate<int>(spec.points);
+    for (int i = 0; i < n; i++)
+    {
+        t[i] = i * dt;
+    }
+    for (int path = 0; path < spec.count; path++)
+    {
+        fill_normals(rng, z, spec.steps);
+        S[0] = spec.S0;
+        for (int i = 0; i < spec.steps; i++)
+        {
+            z[i] = std::exp(drift_dt + vol_sqrt_dt * z[i]);
+        }
+        for (int i = 0; i < spec.steps; i++)
+        {
+            S[i + 1] = S[i] * z[i];
+        }
+
+        const int points = lttb(t, S, n, spec.points, kept);
+        float *path_times = times + static_cast<size_t>(path) * spec.points;
+        float *path_prices = prices + static_cast<size_t>(path) * spec.points;
+        for (int j = 0; j < points; j++)
+        {
+            path_times[j] = static_cast<float>(t[kept[j]]);
+            path_prices[j] = static_cast<float>(S[kept[j]]);
+        }
+    }
+}
+
+// Simulate one chunk of a path dump: its paths advance together a step at a time, and each
+// step is stored as the chunk's next column (stride values apart). S ends at the terminal prices.
+template <typename Value>
+static void simulate_dump_chunk(Value *out, long paths, uint64_t stride, int steps, double S0,
+                                double drift_dt, double vol_sqrt_dt, uint64_t seed, double *S, double *z)
+{
+    LaneRng rng(seed);
+    std::fill(S, S + paths, S0);
+    for (int j = 0; j < steps; j++)
+    {
+        fill_normals(rng, z, paths);
+        gbm_step(S, z, paths, drift_dt, vol_sqrt_dt);
+        Value *column = out + j * stride;
+        for (long p = 0; p < paths; p++)
+        {
+            column[p] = static_cast<Value>(S[p]);
+        }
+    }
+}
+
+PathDumpResult dump_paths(double S0, double K, double r, double sigma, double T, bool isCall,
+                          int numTrials, int num_threads, const SimulationOptions &options)
+{
+    if (options.dump_path.empty())
+    {
+        throw std::invalid_argument("dump-paths needs a file name");
+    }
+    const uint64_t seed = options.dump_seed != 0
+                              ? options.dump_seed
+                              : std::chrono::high_resolution_clock::now().time_since_epoch().count();
+
+    PathDumpHeader header{};
+    path_dump_layout(header, static_cast<uint64_t>(numTrials), static_cast<uint32_t>(options.dump_steps),
+                     static_cast<uint64_t>(options.dump_chunk_paths),
+                     options.precision == Precision::Single ? sizeof(float) : sizeof(double));
+    header.seed = seed;
+    header.S0 = S0;
+    header.r = r;
+    header.sigma = sigma;
+    header.T = T;
+    header.dt = T / options.dump_steps;
+    PathDumpFile file = PathDumpFile::create(options.dump_path, header);
+
+    const double drift_dt = (r - 0.5 * sigma * sigma) * header.dt;
+    const double vol_sqrt_dt = sigma * std::sqrt(header.dt);
+    const long chunk_paths = options.dump_chunk_paths;
+    const uint64_t chunks = header.chunk_count;
+    const int workers = static_cast<int>(std::min<uint64_t>(choose_thread_count(numTrials, num_threads), chunks));
+
+    // Each worker owns a contiguous range of chunks, so writes never overlap and need no locks
+    std::vector<double> sums(workers, 0.0);
+    std::vector<double> sums_squared(workers, 0.0);
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+    auto worker = [&](int w)
+    {
+        try
+        {
+            Arena &arena = worker_arena();
+            ArenaScope arena_scope(arena);
+            double *S = arena.allocate<double>(chunk_paths);
+            double *z = arena.allocate<double>(chunk_paths);
+            double sum = 0.0;
+            double sum_squared = 0.0;
+            for (uint64_t c = chunks * w / workers; c < chunks * (w + 1) / workers; c++)
+            {
+                const long paths = static_cast<long>(path_dump_chunk_paths(header, c));
+                uint64_t chunk_state = seed + c;
+                const uint64_t chunk_seed = splitmix64(chunk_state);
+                if (header.value_bytes == sizeof(float))
+                    simulate_dump_chunk(reinterpret_cast<float *>(file.chunk(c)), paths, header.chunk_paths,
+                                        options.dump_steps, S0, drift_dt, vol_sqrt_dt, chunk_seed, S, z);
+                else
+                    simulate_dump_chunk(reinterpret_cast<double *>(file.chunk(c)), paths, header.chunk_paths,
+                                        options.dump_steps, S0, drift_dt, vol_sqrt_dt, chunk_seed, S, z);
+                for (long p = 0; p < paths; p++)
+                {
+                    const double payoff = calculate_payoff(S[p], K, isCall);
+                    sum += payoff;
+                    sum_squared += payoff * payoff;
+                }
+            }
+            sums[w] = sum;
+            sums_squared[w] = sum_squared;
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!first_error)
+                first_error = std::current_exception();
+        }
+    };
+
+    run_workers(workers, worker);
+    if (first_error)
+    {
+        std::rethrow_exception(first_error);
+    }
+    file.finish();
+
+    PathDumpResult result;
+    estimate_price(std::accumulate(sums.begin(), sums.end(), 0.0),
+                   std::accumulate(sums_squared.begin(), sums_squared.end(), 0.0), numTrials, std::exp(-r * T),
+                   result.price, result.lower, result.upper);
+    result.threadsUsed = workers;
+    result.header = header;
+    result.bytes = file.size();
+    return result;
+}
+
+// Function to run multiple benchmark iterations
+std::vector<BenchmarkResult> run_benchmark(double S0, double K, double r, double sigma,
+                                           double T, bool isCall, int numTrials,
+                                           int threads, int iterations,
+                                           const SimulationOptions &options)
+{
+    std::vector<BenchmarkResult> results;
+    results.reserve(iterations);
+
+    // Pre-calculate constants
+    const double drift = (r - 0.5 * sigma * sigma) * T;
+    const double volatility = sigma * sqrt(T);
+
+    // Warm-up run (not included in results)
+    double price, lower, upper;
+    monte_carlo_black_scholes_mt(S0, K, r, sigma, T, isCall, numTrials, threads, price, lower, upper, options);
+
+    // Collect per-worker reports from each timed run when counters are requested
+    JobInstrumentation instrumentation;
+    SimulationOptions run_options = options;
+    if (options.perf_counters)
+    {
+        run_options.instrumentation = &instrumentation;
+    }
+
+    // Timed benchmark runs
+    for (int i = 0; i < iterations; i++)
+    {
+        // Measure only computation time with high-resolution clock
+        auto start_time = std::chrono::high_resolution_clock::now();
+        monte_carlo_black_scholes_mt(S0, K, r, sigma, T, isCall, numTrials, threads, price, lower, upper, run_options);
+        auto end_time = std::chrono::high_resolution_clock::now();
+
+        double execution_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+        results.push_back({execution_time,
+                           price,
+                           lower,
+                           upper,
+                           threads,
+                           std::move(instrumentation.workers)});
+        instrumentation.workers.clear();
+    }
+
+    return results;
+}
+
+// Function to calculate statistics from benchmark results
+void calculate_stats(const std::vector<BenchmarkResult> &results,
+                     double &min, double &max, double &avg, double &median)
+{
+    if (results.empty())
+    {
+        min = max = avg = median = 0.0;
+        return;
+    }
+
+    std::vector<double> times;
+    times.reserve(results.size());
+
+    for (const auto &result : results)
+    {
+        times.push_back(result.executionTime);
+    }
+
+    min = *std::min_element(times.begin(), times.end());
+    max = *std::max_element(times.begin(), times.end());
+
+    // Use std::accumulate for better optimization
+    avg = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+
+    // Calculate median
+    std::vector<double> sorted_times = times;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    if (sorted_times.size() % 2 == 0)
+    {
+        median = (sorted_times[sorted_times.size() / 2 - 1] + sorted_times[sorted_times.size() / 2]) / 2.0;
+    }
+    else
+    {
+        median = sorted_times[sorted_times.size() / 2];
+    }
+}
+
+// Median wall time (ms) of a benchmark configuration
+static double median_time(double S0, double K, double r, double sigma, double T, bool isCall,
+                          int numTrials, int threads, int iterations, const SimulationOptions &options)
+{
+    const auto results = run_benchmark(S0, K, r, sigma, T, isCall, numTrials, threads, iterations, options);
+    double min, max, avg, median;
+    calculate_stats(results, min, max, avg, median);
+    return median;
+}
+
+static ScalingPoint make_scaling_point(int threads, int numTrials, double single_thread_ms, double ms)
+{
+    const double speedup = ms > 0.0 ? single_thread_ms / ms : 0.0;
+    return {threads, numTrials, ms, speedup, speedup / threads, ms > 0.0 ? numTrials / (ms / 1000.0) : 0.0};
+}
+
+// Thread-count sweep at a fixed job size: 1, 2, 4, ... up to max_threads (always included)
+std::vector<ScalingPoint> run_thread_sweep(double S0, double K, double r, double sigma,
+                                           double T, bool isCall, int numTrials,
+                                           int max_threads, int iterations,
+                                           const SimulationOptions &options)
+{
+    std::vector<int> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+
+    std::vector<ScalingPoint> points;
+    double single_thread_ms = 0.0;
+    for (int threads : counts)
+    {
+        const double ms = median_time(S0, K, r, sigma, T, isCall, numTrials, threads, iterations, options);
+        if (threads == 1)
+            single_thread_ms = ms;
+        points.push_back(make_scaling_point(threads, numTrials, single_thread_ms, ms));
+    }
+    return points;
+}
+
+// Trial-count sweep at max_threads: decades from 1,000 up to numTrials, each compared with
+// a single-threaded run of the same size
+std::vector<ScalingPoint> run_trial_sweep(double S0, double K, double r, double sigma,
+                                          double T, bool isCall, int numTrials,
+                                          int max_threads, int iterations,
+                                          const SimulationOptions &options)
+{
+    std::vector<int> sizes;
+    for (long long trials = 1000; trials < numTrials; trials *= 10)
+    {
+        sizes.push_back(static_cast<int>(trials));
+    }
+    sizes.push_back(numTrials);
+
+    std::vector<ScalingPoint> points;
+    for (int trials : sizes)
+    {
+        const double single_thread_ms = median_time(S0, K, r, sigma, T, isCall, trials, 1, iterations, options);
+        const double ms = max_threads == 1
+                              ? single_thread_ms
+                              : median_time(S0, K, r, sigma, T, isCall, trials, max_threads, iterations, options);
+        points.push_back(make_scaling_point(max_threads, trials, single_thread_ms, ms));
+    }
+    return points;
+}
+
+// User + system CPU time of the whole process
+double process_cpu_seconds()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+// Apply one --key=value flag to the options
+void parse_option(const std::string &arg, SimulationOptions &options)
+{
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (key == "precision")
+    {
+        if (value == "single")
+            options.precision = Precision::Single;
+        else if (value == "double")
+            options.precision = Precision::Double;
+        else
+            throw std::invalid_argument("precision must be 'single' or 'double'");
+    }
+    else if (key == "perf-counters")
+    {
+        options.perf_counters = true;
+    }
+    else if (key == "timing")
+    {
+        options.timing = true;
+    }
+    else if (key == "progress")
+    {
+        // Report interval in milliseconds
+        options.progress_interval_ms = value.empty() ? PROGRESS_DEFAULT_INTERVAL_MS : std::stod(value);
+        if (!(options.progress_interval_ms > 0.0))
+            throw std::invalid_argument("progress interval must be a positive number of milliseconds");
+    }
+    else if (key == "convergence")
+    {
+        // First checkpoint in paths
+        options.convergence_start = value.empty() ? CONVERGENCE_DEFAULT_START : std::stol(value);
+        if (options.convergence_start <= 0)
+            throw std::invalid_argument("convergence must start at a positive number of paths");
+    }
+    else if (key == "distribution")
+    {
+        options.distribution_bins = value.empty() ? DISTRIBUTION_DEFAULT_BINS : std::stoi(value);
+        if (options.distribution_bins < 1 || options.distribution_bins > DISTRIBUTION_MAX_BINS)
+            throw std::invalid_argument("distribution must have between 1 and " + std::to_string(DISTRIBUTION_MAX_BINS) + " bins");
+    }
+    else if (key == "dump-paths")
+    {
+        if (value.empty())
+            throw std::invalid_argument("dump-paths needs a file name");
+        options.dump_path = value;
+    }
+    else if (key == "dump-steps")
+    {
+        options.dump_steps = std::stoi(value);
+        if (options.dump_steps < 1 || options.dump_steps > PATH_DUMP_MAX_STEPS)
+            throw std::invalid_argument("dump-steps must be between 1 and " + std::to_string(PATH_DUMP_MAX_STEPS));
+    }
+    else if (key == "dump-chunk")
+    {
+        options.dump_chunk_paths = std::stoi(value);
+        if (options.dump_chunk_paths < 1 || options.dump_chunk_paths > PATH_DUMP_MAX_CHUNK_PATHS)
+            throw std::invalid_argument("dump-chunk must be between 1 and " + std::to_string(PATH_DUMP_MAX_CHUNK_PATHS) +
+                                        " paths");
+    }
+    else if (key == "dump-seed")
+    {
+        options.dump_seed = std::stoull(value);
+    }
+    else if (key == "trace")
+    {
+        if (!parse_traceparent(value, options.trace))
+            throw std::invalid_argument("trace must be a W3C traceparent (00-<trace id>-<span id>-<flags>)");
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown option: --" + key);
+    }
+}
@@ -0,0 +1,1194 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "binary_protocol.h"
+#include "engine.h"
+#include "engine_server.h"
+#include "hdr_histogram.h"
+#include "instrumentation_json.h"
+#include "json_writer.h"
+
+namespace
+{
+
+// Largest request payload accepted in binary mode (~1.4M batch contracts)
+constexpr uint32_t MAX_PAYLOAD_BYTES = 64 * 1024 * 1024;
+
+// Most contracts in one batch request, either protocol
+constexpr size_t MAX_BATCH_CONTRACTS = 1000000;
+
+enum class Protocol
+{
+    Json,
+    Binary
+};
+
+// Buffered reader over a file descriptor supporting both line and fixed-size reads
+class InputReader
+{
+public:
+    explicit InputReader(int fd) : fd_(fd), buffer_(64 * 1024) {}
+
+    bool read_line(std::string &line)
+    {
+        line.clear();
+        while (true)
+        {
+            char *begin = buffer_.data() + start_;
+            char *newline = static_cast<char *>(std::memchr(begin, '\n', end_ - start_));
+            if (newline)
+            {
+                line.append(begin, newline);
+                start_ += (newline - begin) + 1;
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                return true;
+            }
+            line.append(begin, end_ - start_);
+            start_ = end_ = 0;
+            if (!fill())
+                return !line.empty();
+        }
+    }
+
+    bool read_exact(void *destination, size_t bytes)
+    {
+        char *out = static_cast<char *>(destination);
+        while (bytes > 0)
+        {
+            if (start_ == end_)
+            {
+                start_ = end_ = 0;
+                if (!fill())
+                    return false;
+            }
+            const size_t chunk = std::min(bytes, end_ - start_);
+            std::memcpy(out, buffer_.data() + start_, chunk);
+            start_ += chunk;
+            out += chunk;
+            bytes -= chunk;
+        }
+        return true;
+    }
+
+private:
+    bool fill()
+    {
+        while (true)
+        {
+            const ssize_t n = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+            if (n > 0)
+            {
+                end_ += static_cast<size_t>(n);
+                return true;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+    }
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t start_ = 0;
+    size_t end_ = 0;
+};
+
+// Serializes complete responses onto stdout (the reader and the executor both write)
+class OutputWriter
+{
+public:
+    void write(const char *data, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_all(data, bytes);
+    }
+
+    void write(const std::string &text) { write(text.data(), text.size()); }
+
+    // Part of a response written in chunks (a large JSON result). The output stays locked from
+    // the first chunk until end_chunks(), so other responses cannot land inside it. Only the
+    // executor thread writes chunks.
+    void write_chunk(const char *data, size_t bytes)
+    {
+        if (!chunked_.owns_lock())
+            chunked_ = std::unique_lock<std::mutex>(mutex_);
+        write_all(data, bytes);
+    }
+
+    // Write the end of a response, releasing the output if earlier chunks locked it
+    void end_chunks(const char *data, size_t bytes)
+    {
+        if (!chunked_.owns_lock())
+        {
+            write(data, bytes);
+            return;
+        }
+        write_all(data, bytes);
+        chunked_.unlock();
+    }
+
+    // End the line of a response cut short after some chunks went out, so the error response
+    // that follows is read on its own
+    void abandon_chunks()
+    {
+        if (!chunked_.owns_lock())
+            return;
+        write_all("\n", 1);
+        chunked_.unlock();
+    }
+
+private:
+    void write_all(const char *data, size_t bytes)
+    {
+        while (bytes > 0)
+        {
+            const ssize_t n = ::write(STDOUT_FILENO, data, bytes);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return; // Client went away - nothing useful left to do with the response
+            }
+            data += n;
+            bytes -= static_cast<size_t>(n);
+        }
+    }
+
+    std::mutex mutex_;
+    std::unique_lock<std::mutex> chunked_;
+};
+
+struct Job
+{
+    uint32_t id = 0;
+    Protocol protocol = Protocol::Json;
+    RequestClass kind = REQUEST_CLASS_PRICE;
+    SimulationOptions options;
+    int numTrials = 0;                    // Sample paths requests: the path count
+    int threads = 0;
+    BatchContract contract{};             // Single price request
+    std::vector<BatchContract> contracts; // Batch request
+    SamplePathsSpec paths{};              // Sample paths request
+    uint64_t received_ticks = 0;          // When the reader started on the request
+    uint64_t queued_ticks = 0;            // When the request was parsed and queued
+    PhaseTimes phases;                    // --timing: phases measured by the reader (parse)
+};
+
+// FIFO of pending jobs. Requests are executed one at a time (each job is itself
+// multi-threaded); the reader thread stays free to answer pings while a job runs.
+class JobQueue
+{
+public:
+    void push(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        ready_.notify_one();
+    }
+
+    // Blocks until a job is available; returns false once closed and drained
+    bool pop(Job &job)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return closed_ || !jobs_.empty(); });
+        if (jobs_.empty())
+            return false;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Job> jobs_;
+    bool closed_ = false;
+};
+
+// Process-wide counters reported by the stats command. They change together (a job leaves
+// the queue as it starts, and stops being in flight as it completes), so they are updated and
+// read under one mutex: every snapshot counts each job in exactly one state.
+class EngineStats
+{
+public:
+    const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    void request_received()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counts_.requestsTotal++;
+    }
+
+    // Called before the job is pushed, so the executor never starts an uncounted job
+    void job_queued()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counts_.queueDepth++;
+    }
+
+    void job_started()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counts_.queueDepth--;
+        counts_.inFlight++;
+    }
+
+    void job_finished(bool completed, uint64_t paths)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counts_.inFlight--;
+        if (completed)
+        {
+            counts_.jobsCompleted++;
+            counts_.pathsTotal += paths;
+        }
+        else
+        {
+            counts_.jobsFailed++;
+        }
+    }
+
+    // Counters only; the caller fills in the times
+    StatsPayload counts()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return counts_;
+    }
+
+private:
+    std::mutex mutex_;
+    StatsPayload counts_{};
+};
+
+EngineStats engine_stats;
+
+// Count a job as queued, then hand it to the executor
+void enqueue(JobQueue &queue, Job job)
+{
+    engine_stats.job_queued();
+    queue.push(std::move(job));
+}
+
+// Latency histograms owned by one thread, per request class and stage
+struct LatencyHistograms
+{
+    HdrHistogram stages[REQUEST_CLASS_COUNT][LATENCY_STAGE_COUNT];
+};
+
+// Every thread's histograms. Threads record into their own without synchronization; the
+// stats command merges them. Entries are never freed, so they outlive their threads.
+class LatencyRegistry
+{
+public:
+    LatencyHistograms &local()
+    {
+        thread_local LatencyHistograms *histograms = nullptr;
+        if (!histograms)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            threads_.push_back(std::make_unique<LatencyHistograms>());
+            histograms = threads_.back().get();
+        }
+        return *histograms;
+    }
+
+    LatencySummaryPayload summary(RequestClass request_class, LatencyStage stage)
+    {
+        HdrSnapshot snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto &histograms : threads_)
+                snapshot.add(histograms->stages[request_class][stage]);
+        }
+        auto us = [](uint64_t ticks) { return ticks_to_ms(ticks) * 1e3; };
+        return {snapshot.total, us(snapshot.value_at_quantile(0.5)), us(snapshot.value_at_quantile(0.99)),
+                us(snapshot.value_at_quantile(0.999)), us(snapshot.max)};
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<LatencyHistograms>> threads_;
+};
+
+LatencyRegistry latency_registry;
+
+StatsPayload snapshot_stats()
+{
+    StatsPayload stats = engine_stats.counts();
+    stats.uptimeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - engine_stats.started).count();
+    stats.cpuSeconds = process_cpu_seconds();
+    return stats;
+}
+
+std::vector<char> make_frame(uint16_t type, uint32_t id, const void *payload, uint32_t payload_bytes)
+{
+    std::vector<char> frame(sizeof(FrameHeader) + payload_bytes);
+    const FrameHeader header{FRAME_MAGIC, type, PROTOCOL_VERSION, id, payload_bytes};
+    std::memcpy(frame.data(), &header, sizeof(header));
+    if (payload_bytes > 0)
+        std::memcpy(frame.data() + sizeof(header), payload, payload_bytes);
+    return frame;
+}
+
+// Latency summaries for the JSON stats response, microseconds
+void write_latency(JsonWriter &json)
+{
+    static const char *const classes[REQUEST_CLASS_COUNT] = {"price", "batch", "paths"};
+    static const char *const stages[LATENCY_STAGE_COUNT] = {"queueWait", "service", "endToEnd"};
+    json.begin_object().field("unit", "us");
+    for (uint32_t c = 0; c < REQUEST_CLASS_COUNT; ++c)
+    {
+        json.key(classes[c]).begin_object();
+        for (uint32_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+        {
+            const LatencySummaryPayload summary =
+                latency_registry.summary(static_cast<RequestClass>(c), static_cast<LatencyStage>(stage));
+            json.key(stages[stage])
+                .begin_object()
+                .field("count", static_cast<int64_t>(summary.count))
+                .field("p50", summary.p50)
+                .field("p99", summary.p99)
+                .field("p999", summary.p999)
+                .field("max", summary.max)
+                .end_object();
+        }
+        json.end_object();
+    }
+    json.end_object();
+}
+
+void write_frame(OutputWriter &out, uint16_t type, uint32_t id, const void *payload, uint32_t payload_bytes)
+{
+    const std::vector<char> frame = make_frame(type, id, payload, payload_bytes);
+    out.write(frame.data(), frame.size());
+}
+
+// Set the header's payload_bytes after appending to a frame
+void update_payload_bytes(std::vector<char> &frame)
+{
+    const uint32_t payload_bytes = static_cast<uint32_t>(frame.size() - sizeof(FrameHeader));
+    std::memcpy(frame.data() + offsetof(FrameHeader, payload_bytes), &payload_bytes, sizeof(payload_bytes));
+}
+
+// Append the trace extension (TraceResultHeader + spans) to a complete frame
+void append_trace(std::vector<char> &frame, const TraceRecorder &trace)
+{
+    const auto &spans = trace.spans();
+    const size_t offset = frame.size();
+    frame.resize(offset + sizeof(TraceResultHeader) + spans.size() * sizeof(TraceSpanPayload));
+
+    const TraceResultHeader header{static_cast<uint32_t>(spans.size()), 0};
+    std::memcpy(frame.data() + offset, &header, sizeof(header));
+    char *record = frame.data() + offset + sizeof(header);
+    for (const auto &span : spans)
+    {
+        TraceSpanPayload payload{};
+        std::memcpy(payload.span_id, span.span_id, sizeof(payload.span_id));
+        std::memcpy(payload.parent_span_id, span.parent_span_id, sizeof(payload.parent_span_id));
+        payload.startUnixNano = ticks_to_unix_ns(span.start_ticks);
+        payload.endUnixNano = ticks_to_unix_ns(span.end_ticks);
+        payload.kind = span.kind;
+        std::memcpy(record, &payload, sizeof(payload));
+        record += sizeof(payload);
+    }
+    update_payload_bytes(frame);
+}
+
+// Emit the JSON document built in json as one response line
+void write_json_line(OutputWriter &out, JsonWriter &json)
+{
+    json.newline();
+    out.write(json.data(), json.size());
+    json.clear();
+}
+
+// Emit the rest of a result line from the executor's writer, whose earlier parts may have
+// gone out as chunks while it was formatted
+void finish_json_line(OutputWriter &out, JsonWriter &json)
+{
+    json.newline();
+    out.end_chunks(json.data(), json.size());
+    json.clear();
+}
+
+void write_error(OutputWriter &out, JsonWriter &json, Protocol protocol, uint32_t id, const std::string &message)
+{
+    if (protocol == Protocol::Binary)
+    {
+        write_frame(out, FRAME_ERROR, id, message.data(), static_cast<uint32_t>(message.size()));
+    }
+    else
+    {
+        json.begin_object().field("id", id).field("error", message).end_object();
+        write_json_line(out, json);
+    }
+}
+
+// Running estimate of a price job, ahead of its result: a FRAME_PROGRESS frame, or a
+// {"id", "progress"} line in JSON mode
+void write_progress(OutputWriter &out, JsonWriter &json, Protocol protocol, uint32_t id, const ProgressReport &progress)
+{
+    if (protocol == Protocol::Binary)
+    {
+        const ProgressPayload payload{progress.paths, progress.totalPaths, progress.price, progress.lower, progress.upper};
+        write_frame(out, FRAME_PROGRESS, id, &payload, sizeof(payload));
+        return;
+    }
+    json.begin_object()
+        .field("id", id)
+        .key("progress")
+        .begin_object()
+        .field("paths", static_cast<int64_t>(progress.paths))
+        .field("totalPaths", static_cast<int64_t>(progress.totalPaths))
+        .field("optionPrice", progress.price)
+        .key("confidence")
+        .begin_object()
+        .field("lower", progress.lower)
+        .field("upper", progress.upper)
+        .end_object()
+        .end_object()
+        .end_object();
+    write_json_line(out, json);
+}
+
+// Record the output span and close the job span
+void finish_trace(TraceRecorder &trace, uint64_t output_start)
+{
+    const uint64_t output_end = read_ticks();
+    trace.record(TRACE_SPAN_OUTPUT, output_start, output_end);
+    trace.end_root(output_end);
+}
+
+// JSON mode: finish the trace and add it as the "trace" field
+void write_trace_field(JsonWriter &json, TraceRecorder &trace, uint64_t output_start)
+{
+    if (!trace.enabled())
+        return;
+    finish_trace(trace, output_start);
+    json.key("trace");
+    write_trace(json, trace);
+}
+
+void execute(const Job &job, OutputWriter &out, JsonWriter &json)
+{
+    // Counted just before the response is written, so a stats request sent after the client
+    // saw the response always includes this job (failures are counted on unwinding too)
+    struct Accounting
+    {
+        const Job &job;
+        const uint64_t started = read_ticks();
+        bool done = false;
+        Accounting(const Job &j) : job(j) { engine_stats.job_started(); }
+        ~Accounting() { finish(false); }
+
+        void finish(bool completed)
+        {
+            if (done)
+                return;
+            done = true;
+            const uint64_t finished = read_ticks();
+            auto &stages = latency_registry.local().stages[job.kind];
+            stages[LATENCY_QUEUE_WAIT].record(started - job.queued_ticks);
+            stages[LATENCY_SERVICE].record(finished - started);
+            stages[LATENCY_END_TO_END].record(finished - job.received_ticks);
+
+            const uint64_t contracts = job.kind == REQUEST_CLASS_BATCH ? job.contracts.size() : 1;
+            engine_stats.job_finished(completed, contracts * static_cast<uint64_t>(std::max(job.numTrials, 0)));
+        }
+    } accounting(job);
+
+    // Engine spans of a traced request: the job (closed once formatted), parsing by the reader,
+    // the wait for the executor, then simulate and output below
+    const uint64_t execute_start = accounting.started;
+    TraceRecorder trace(job.options.trace);
+    trace.record(TRACE_SPAN_JOB, job.received_ticks, job.received_ticks);
+    trace.record(TRACE_SPAN_PARSE, job.received_ticks, job.queued_ticks);
+    trace.record(TRACE_SPAN_QUEUE, job.queued_ticks, execute_start);
+
+    try
+    {
+        if (job.kind == REQUEST_CLASS_PRICE)
+        {
+            // Jobs run one at a time, so the process CPU clock over the job is the job's own
+            // CPU time, summed over its worker threads
+            const double cpu_start = process_cpu_seconds();
+            const BatchContract &c = job.contract;
+            const int threads = choose_thread_count(job.numTrials, job.threads);
+
+            JobInstrumentation instrumentation;
+            SimulationOptions options = job.options;
+            if (options.timing)
+            {
+                options.instrumentation = &instrumentation;
+            }
+            std::vector<ConvergencePoint> convergence;
+            if (options.convergence_start > 0)
+            {
+                options.convergence = &convergence;
+            }
+            PathDistribution distribution;
+            if (options.distribution_bins > 0)
+            {
+                options.distribution = &distribution;
+            }
+            // Reports come from worker threads; each formats them in its own reused writer
+            if (options.progress_interval_ms > 0.0)
+            {
+                options.on_progress = [&](const ProgressReport &progress)
+                {
+                    thread_local JsonWriter progress_json(-1, 1024);
+                    write_progress(out, progress_json, job.protocol, job.id, progress);
+                };
+            }
+
+            double price, lower, upper;
+            monte_carlo_black_scholes_mt(c.S0, c.K, c.r, c.sigma, c.T, c.isCall, job.numTrials, threads,
+                                         price, lower, upper, options);
+            const double cpu_seconds = process_cpu_seconds() - cpu_start;
+            const uint64_t output_start = read_ticks();
+            trace.record(TRACE_SPAN_SIMULATE, execute_start, output_start);
+
+            // The requested reports, as fields of the object open in json
+            auto write_details = [&](JsonWriter &json)
+            {
+                if (options.convergence)
+                {
+                    json.key("convergence");
+                    write_convergence(json, convergence);
+                }
+                if (options.distribution)
+                {
+                    json.key("distribution");
+                    write_distribution(json, distribution);
+                }
+                if (options.timing)
+                {
+                    // total runs from the reader picking up the request, so it includes queue wait
+                    PhaseTimes phases = job.phases;
+                    const uint64_t output_end = read_ticks();
+                    phases.add(PHASE_OUTPUT, output_end - output_start);
+                    json.key("timing");
+                    write_phase_timing(json, phases, instrumentation, output_end - job.received_ticks);
+                }
+            };
+
+            if (job.protocol == Protocol::Binary)
+            {
+                const PriceResultPayload result{price, lower, upper, threads,
+                                                static_cast<uint32_t>(std::min(cpu_seconds * 1e6, 4294967295.0))};
+                const bool details = options.convergence || options.distribution || options.timing;
+                std::vector<char> frame = make_frame(details ? FRAME_PRICE_DETAIL_RESULT : FRAME_PRICE_RESULT, job.id,
+                                                     &result, sizeof(result));
+                if (details)
+                {
+                    // Copied into the frame, so formatted by a buffer-only writer
+                    thread_local JsonWriter detail_json(-1, 4096);
+                    detail_json.clear();
+                    detail_json.begin_object();
+                    write_details(detail_json);
+                    detail_json.end_object();
+                    const PriceDetailHeader detail{static_cast<uint32_t>(detail_json.size()), 0};
+                    const size_t offset = frame.size();
+                    frame.resize(offset + sizeof(detail) + (detail_json.size() + 7) / 8 * 8, ' ');
+                    std::memcpy(frame.data() + offset, &detail, sizeof(detail));
+                    std::memcpy(frame.data() + offset + sizeof(detail), detail_json.data(), detail_json.size());
+                    update_payload_bytes(frame);
+                }
+                finish_trace(trace, output_start);
+                if (trace.enabled())
+                    append_trace(frame, trace);
+                accounting.finish(true);
+                out.write(frame.data(), frame.size());
+            }
+            else
+            {
+                json.begin_object()
+                    .field("id", job.id)
+                    .field("optionPrice", price)
+                    .key("confidence")
+                    .begin_object()
+                    .field("lower", lower)
+                    .field("upper", upper)
+                    .end_object()
+                    .field("threadsUsed", threads)
+                    .field("cpuSeconds", cpu_seconds);
+                write_details(json);
+                write_trace_field(json, trace, output_start);
+                json.end_object();
+                accounting.finish(true);
+                finish_json_line(out, json);
+            }
+            return;
+        }
+
+        if (job.kind == REQUEST_CLASS_PATHS)
+        {
+            // Validated before the response is sized by count * points
+            const SamplePathsSpec &spec = job.paths;
+            validate_sample_paths(spec);
+            const size_t values = static_cast<size_t>(spec.count) * spec.points;
+            if (job.protocol == Protocol::Binary)
+            {
+                // Simulate straight into the response frame: header, then times and prices
+                const uint32_t payload_bytes = static_cast<uint32_t>(sizeof(PathsResultHeader) + 2 * sizeof(float) * values);
+                std::vector<char> frame(sizeof(FrameHeader) + payload_bytes);
+                float *times = reinterpret_cast<float *>(frame.data() + sizeof(FrameHeader) + sizeof(PathsResultHeader));
+                sample_paths(spec, times, times + values);
+                const uint64_t output_start = read_ticks();
+                trace.record(TRACE_SPAN_SIMULATE, execute_start, output_start);
+
+                const FrameHeader header{FRAME_MAGIC, FRAME_PATHS_RESULT, PROTOCOL_VERSION, job.id, payload_bytes};
+                const PathsResultHeader paths{static_cast<uint32_t>(spec.count), static_cast<uint32_t>(spec.points)};
+                std::memcpy(frame.data(), &header, sizeof(header));
+                std::memcpy(frame.data() + sizeof(header), &paths, sizeof(paths));
+                finish_trace(trace, output_start);
+                if (trace.enabled())
+                    append_trace(frame, trace);
+                accounting.finish(true);
+                out.write(frame.data(), frame.size());
+            }
+            else
+            {
+                std::vector<float> results(2 * values);
+                sample_paths(spec, results.data(), results.data() + values);
+                const uint64_t output_start = read_ticks();
+                trace.record(TRACE_SPAN_SIMULATE, execute_start, output_start);
+
+                json.begin_object().field("id", job.id).field("count", spec.count).field("points", spec.points);
+                const char *names[] = {"times", "prices"};
+                for (int column = 0; column < 2; column++)
+                {
+                    json.key(names[column]).begin_array();
+                    for (size_t i = 0; i < values; i++)
+                    {
+                        json.value(static_cast<double>(results[column * values + i]));
+                    }
+                    json.end_array();
+                }
+                write_trace_field(json, trace, output_start);
+                json.end_object();
+                accounting.finish(true);
+                finish_json_line(out, json);
+            }
+            return;
+        }
+
+        const int count = static_cast<int>(job.contracts.size());
+        if (job.protocol == Protocol::Binary)
+        {
+            // Price straight into the response frame: header, then the three result columns
+            const uint32_t payload_bytes = static_cast<uint32_t>(sizeof(BatchResultHeader) + 3 * sizeof(double) * count);
+            std::vector<char> frame(sizeof(FrameHeader) + payload_bytes);
+            double *prices = reinterpret_cast<double *>(frame.data() + sizeof(FrameHeader) + sizeof(BatchResultHeader));
+            const int threads = price_batch(job.contracts.data(), count, job.numTrials, job.threads,
+                                            prices, prices + count, prices + 2 * count, job.options);
+            const uint64_t output_start = read_ticks();
+            trace.record(TRACE_SPAN_SIMULATE, execute_start, output_start);
+
+            const FrameHeader header{FRAME_MAGIC, FRAME_BATCH_RESULT, PROTOCOL_VERSION, job.id, payload_bytes};
+            const BatchResultHeader batch{static_cast<uint32_t>(count), threads};
+            std::memcpy(frame.data(), &header, sizeof(header));
+            std::memcpy(frame.data() + sizeof(header), &batch, sizeof(batch));
+            finish_trace(trace, output_start);
+            if (trace.enabled())
+                append_trace(frame, trace);
+            accounting.finish(true);
+            out.write(frame.data(), frame.size());
+        }
+        else
+        {
+            std::vector<double> results(3 * static_cast<size_t>(count));
+            const int threads = price_batch(job.contracts.data(), count, job.numTrials, job.threads,
+                                            results.data(), results.data() + count, results.data() + 2 * count,
+                                            job.options);
+            const uint64_t output_start = read_ticks();
+            trace.record(TRACE_SPAN_SIMULATE, execute_start, output_start);
+
+            json.begin_object().field("id", job.id).field("count", count).field("threadsUsed", threads);
+            const char *names[] = {"prices", "lower", "upper"};
+            for (int column = 0; column < 3; column++)
+            {
+                json.key(names[column]).begin_array();
+                for (int i = 0; i < count; i++)
+                {
+                    json.value(results[static_cast<size_t>(column) * count + i]);
+                }
+                json.end_array();
+            }
+            write_trace_field(json, trace, output_start);
+            json.end_object();
+            accounting.finish(true);
+            finish_json_line(out, json);
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        json.clear();
+        out.abandon_chunks();
+        accounting.finish(false);
+        write_error(out, json, job.protocol, job.id, e.what());
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        json.clear();
+        out.abandon_chunks();
+        accounting.finish(false);
+        write_error(out, json, job.protocol, job.id, "An unexpected error occurred");
+    }
+}
+
+BatchContract make_contract(double S0, double K, double r, double sigma, double T, bool isCall)
+{
+    return {S0, K, r, sigma, T, isCall};
+}
+
+// Requested thread counts: <= 0 for automatic, at most MAX_REQUEST_THREADS; the engine caps
+// the rest at the hardware thread count
+bool valid_threads(int threads)
+{
+    return threads <= MAX_REQUEST_THREADS;
+}
+
+const std::string INVALID_THREADS_ERROR = "threads must be at most " + std::to_string(MAX_REQUEST_THREADS);
+
+// Timing, progress, convergence and distribution reports exist for price requests only
+constexpr uint32_t PRICE_REPORT_FLAGS =
+    REQUEST_FLAG_TIMING | REQUEST_FLAG_CONVERGENCE | REQUEST_FLAG_DISTRIBUTION | REQUEST_FLAG_PROGRESS;
+
+bool has_price_reports(const SimulationOptions &options)
+{
+    return options.timing || options.progress_interval_ms > 0.0 || options.convergence_start > 0 ||
+           options.distribution_bins > 0;
+}
+
+const std::string PRICE_REPORTS_ERROR = "timing, progress, convergence and distribution apply to price requests only";
+
+// JSON mode request line: "<id> <command> [args...] [--key=value...]"
+//   price <S0> <K> <r> <sigma> <T> <isCall> <numTrials> [threads]
+//     (--timing, --convergence and --distribution add those reports; --progress sends
+//     {"id", "progress"} lines ahead of the result)
+//   (price and batch accept --trace=<traceparent> and then report their spans as "trace")
+//   batch <numTrials> <threads> <count> (<S0> <K> <r> <sigma> <T> <isCall>) x count
+//   paths <S0> <r> <sigma> <T> <count> <steps> <points> [seed]
+//   stats | ping | quit
+// Returns false when the client asked to quit.
+bool handle_json_line(const std::string &line, JobQueue &queue, OutputWriter &out, JsonWriter &json)
+{
+    const uint64_t received = read_ticks();
+    std::istringstream stream(line);
+    std::vector<std::string> args;
+    std::vector<std::string> flags;
+    Job job;
+    job.protocol = Protocol::Json;
+
+    std::string token;
+    while (stream >> token)
+    {
+        if (token.rfind("--", 0) == 0)
+            flags.push_back(token);
+        else
+            args.push_back(token);
+    }
+    if (args.empty())
+        return true;
+    engine_stats.request_received();
+
+    try
+    {
+        job.id = static_cast<uint32_t>(std::stoul(args[0]));
+        const std::string command = args.size() > 1 ? args[1] : "";
+        for (const auto &flag : flags)
+        {
+            parse_option(flag, job.options);
+        }
+        // Path dumps write files on the engine's host, so only one-shot runs may ask for them;
+        // per-worker counters are only reported by one-shot benchmarks
+        if (!job.options.dump_path.empty())
+        {
+            throw std::invalid_argument("--dump-paths is only available on one-shot runs");
+        }
+        if (job.options.perf_counters)
+        {
+            throw std::invalid_argument("--perf-counters is only available on one-shot runs");
+        }
+        if (has_price_reports(job.options) && command != "price")
+        {
+            throw std::invalid_argument(PRICE_REPORTS_ERROR);
+        }
+
+        if (command == "stats")
+        {
+            const StatsPayload stats = snapshot_stats();
+            json.begin_object()
+                .field("id", job.id)
+                .key("stats")
+                .begin_object()
+                .field("uptimeSeconds", stats.uptimeSeconds)
+                .field("cpuSeconds", stats.cpuSeconds)
+                .field("requestsTotal", static_cast<int64_t>(stats.requestsTotal))
+                .field("jobsCompleted", static_cast<int64_t>(stats.jobsCompleted))
+                .field("jobsFailed", static_cast<int64_t>(stats.jobsFailed))
+                .field("pathsTotal", static_cast<int64_t>(stats.pathsTotal))
+                .field("queueDepth", stats.queueDepth)
+                .field("inFlight", stats.inFlight)
+                .key("latency");
+            write_latency(json);
+            json.end_object().end_object();
+            write_json_line(out, json);
+        }
+        else if (command == "ping")
+        {
+            json.begin_object().field("id", job.id).field("pong", true).end_object();
+            write_json_line(out, json);
+        }
+        else if (command == "quit")
+        {
+            return false;
+        }
+        else if (command == "price")
+        {
+            if (args.size() < 9)
+                throw std::invalid_argument("price expects S0 K r sigma T isCall numTrials [threads]");
+            job.contract = make_contract(std::stod(args[2]), std::stod(args[3]), std::stod(args[4]),
+                                         std::stod(args[5]), std::stod(args[6]), std::stoi(args[7]) != 0);
+            job.numTrials = std::stoi(args[8]);
+            job.threads = args.size() > 9 ? std::stoi(args[9]) : 0;
+            if (!valid_threads(job.threads))
+                throw std::invalid_argument(INVALID_THREADS_ERROR);
+            job.received_ticks = received;
+            job.queued_ticks = read_ticks();
+            job.phases.add(PHASE_PARSE, job.queued_ticks - received);
+            enqueue(queue, std::move(job));
+        }
+        else if (command == "batch")
+        {
+            if (args.size() < 5)
+                throw std::invalid_argument("batch expects numTrials threads count contracts...");
+            job.kind = REQUEST_CLASS_BATCH;
+            job.numTrials = std::stoi(args[2]);
+            job.threads = std::stoi(args[3]);
+            if (!valid_threads(job.threads))
+                throw std::invalid_argument(INVALID_THREADS_ERROR);
+            const size_t count = std::stoul(args[4]);
+            if (count > MAX_BATCH_CONTRACTS)
+                throw std::invalid_argument("batch may hold at most " + std::to_string(MAX_BATCH_CONTRACTS) +
+                                            " contracts");
+            // Bounded by the token count before multiplying, so 6 * count cannot wrap
+            if (count == 0 || count > (args.size() - 5) / 6 || args.size() != 5 + 6 * count)
+                throw std::invalid_argument("batch contract count does not match the arguments");
+            job.contracts.reserve(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                const size_t base = 5 + 6 * i;
+                job.contracts.push_back(make_contract(std::stod(args[base]), std::stod(args[base + 1]),
+                                                      std::stod(args[base + 2]), std::stod(args[base + 3]),
+                                                      std::stod(args[base + 4]), std::stoi(args[base + 5]) != 0));
+            }
+            job.received_ticks = received;
+            job.queued_ticks = read_ticks();
+            enqueue(queue, std::move(job));
+        }
+        else if (command == "paths")
+        {
+            if (args.size() < 9)
+                throw std::invalid_argument("paths expects S0 r sigma T count steps points [seed]");
+            job.kind = REQUEST_CLASS_PATHS;
+            job.paths = {std::stod(args[2]), std::stod(args[3]), std::stod(args[4]), std::stod(args[5]),
+                         std::stoi(args[6]), std::stoi(args[7]), std::stoi(args[8]),
+                         args.size() > 9 ? std::stoull(args[9]) : 0};
+            job.numTrials = job.paths.count;
+            job.received_ticks = received;
+            job.queued_ticks = read_ticks();
+            enqueue(queue, std::move(job));
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown command: " + command);
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        // std::stod/stoi also throw invalid_argument, with the function name as message
+        const std::string message = std::strncmp(e.what(), "sto", 3) == 0 ? "Malformed request" : e.what();
+        write_error(out, json, Protocol::Json, job.id, message);
+    }
+    catch (const std::out_of_range &)
+    {
+        write_error(out, json, Protocol::Json, job.id, "Malformed request");
+    }
+    catch (const std::exception &e)
+    {
+        // Anything else (e.g. bad_alloc) fails this request only; the reader keeps serving
+        std::cerr << "Error: " << e.what() << std::endl;
+        write_error(out, json, Protocol::Json, job.id, "An unexpected error occurred");
+    }
+    return true;
+}
+
+// Request flags to options; a traced request's context is the last bytes of its payload
+SimulationOptions options_from_flags(uint32_t flags, const std::vector<char> &payload)
+{
+    SimulationOptions options;
+    if (flags & REQUEST_FLAG_SINGLE_PRECISION)
+        options.precision = Precision::Single;
+    if (flags & REQUEST_FLAG_TIMING)
+        options.timing = true;
+    if (flags & REQUEST_FLAG_CONVERGENCE)
+        options.convergence_start = CONVERGENCE_DEFAULT_START;
+    if (flags & REQUEST_FLAG_DISTRIBUTION)
+        options.distribution_bins = DISTRIBUTION_DEFAULT_BINS;
+    if (flags & REQUEST_FLAG_PROGRESS)
+        options.progress_interval_ms = PROGRESS_DEFAULT_INTERVAL_MS;
+    if (flags & REQUEST_FLAG_TRACE)
+    {
+        TraceContextPayload trace;
+        std::memcpy(&trace, payload.data() + payload.size() - sizeof(trace), sizeof(trace));
+        std::memcpy(options.trace.trace_id, trace.trace_id, sizeof(trace.trace_id));
+        std::memcpy(options.trace.parent_span_id, trace.parent_span_id, sizeof(trace.parent_span_id));
+        options.trace.enabled = true;
+    }
+    return options;
+}
+
+size_t trace_bytes(uint32_t flags)
+{
+    return (flags & REQUEST_FLAG_TRACE) ? sizeof(TraceContextPayload) : 0;
+}
+
+// Binary mode: read and dispatch one frame. Returns false on EOF or a corrupt stream.
+bool handle_binary_frame(InputReader &in, JobQueue &queue, OutputWriter &out, JsonWriter &json)
+{
+    FrameHeader header;
+    if (!in.read_exact(&header, sizeof(header)))
+        return false;
+    const uint64_t received = read_ticks();
+
+    if (header.magic != FRAME_MAGIC || header.payload_bytes > MAX_PAYLOAD_BYTES)
+    {
+        // Framing is lost - there is no way to find the next frame boundary
+        write_error(out, json, Protocol::Binary, header.request_id, "Corrupt frame");
+        return false;
+    }
+
+    std::vector<char> payload(header.payload_bytes);
+    if (header.payload_bytes > 0 && !in.read_exact(payload.data(), payload.size()))
+        return false;
+
+    if (header.version != PROTOCOL_VERSION)
+    {
+        write_error(out, json, Protocol::Binary, header.request_id, "Unsupported protocol version");
+        return true;
+    }
+
+    Job job;
+    job.id = header.request_id;
+    job.protocol = Protocol::Binary;
+    job.received_ticks = received;
+    engine_stats.request_received();
+
+    switch (header.type)
+    {
+    case FRAME_PING:
+        write_frame(out, FRAME_PONG, header.request_id, nullptr, 0);
+        return true;
+
+    case FRAME_STATS_REQUEST:
+    {
+        // StatsPayload followed by the latency summaries
+        struct
+        {
+            StatsPayload stats;
+            LatencySummaryPayload latency[REQUEST_CLASS_COUNT][LATENCY_STAGE_COUNT];
+        } result;
+        result.stats = snapshot_stats();
+        for (uint32_t c = 0; c < REQUEST_CLASS_COUNT; ++c)
+            for (uint32_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+                result.latency[c][stage] = latency_registry.summary(static_cast<RequestClass>(c),
+                                                                    static_cast<LatencyStage>(stage));
+        write_frame(out, FRAME_STATS_RESULT, header.request_id, &result, sizeof(result));
+        return true;
+    }
+
+    case FRAME_PRICE_REQUEST:
+    {
+        if (payload.size() < sizeof(PriceRequestPayload))
+            break;
+        PriceRequestPayload request;
+        std::memcpy(&request, payload.data(), sizeof(request));
+        if (payload.size() != sizeof(request) + trace_bytes(request.flags))
+            break;
+        job.contract = make_contract(request.S0, request.K, request.r, request.sigma, request.T, request.isCall != 0);
+        if (!valid_threads(request.threads))
+        {
+            write_error(out, json, Protocol::Binary, header.request_id, INVALID_THREADS_ERROR);
+            return true;
+        }
+        job.numTrials = request.numTrials;
+        job.threads = request.threads;
+        job.options = options_from_flags(request.flags, payload);
+        job.queued_ticks = read_ticks();
+        job.phases.add(PHASE_PARSE, job.queued_ticks - received);
+        enqueue(queue, std::move(job));
+        return true;
+    }
+
+    case FRAME_BATCH_REQUEST:
+    {
+        if (payload.size() < sizeof(BatchRequestHeader))
+            break;
+        BatchRequestHeader batch;
+        std::memcpy(&batch, payload.data(), sizeof(batch));
+        if (batch.count == 0 || batch.count > MAX_BATCH_CONTRACTS ||
+            payload.size() != sizeof(batch) + batch.count * sizeof(BatchContractPayload) + trace_bytes(batch.flags))
+            break;
+
+        if (!valid_threads(batch.threads))
+        {
+            write_error(out, json, Protocol::Binary, header.request_id, INVALID_THREADS_ERROR);
+            return true;
+        }
+        if (batch.flags & PRICE_REPORT_FLAGS)
+        {
+            write_error(out, json, Protocol::Binary, header.request_id, PRICE_REPORTS_ERROR);
+            return true;
+        }
+        job.kind = REQUEST_CLASS_BATCH;
+        job.numTrials = batch.numTrials;
+        job.threads = batch.threads;
+        job.options = options_from_flags(batch.flags, payload);
+        job.contracts.reserve(batch.count);
+        const char *record = payload.data() + sizeof(batch);
+        for (uint32_t i = 0; i < batch.count; i++, record += sizeof(BatchContractPayload))
+        {
+            BatchContractPayload c;
+            std::memcpy(&c, record, sizeof(c));
+            job.contracts.push_back(make_contract(c.S0, c.K, c.r, c.sigma, c.T, c.isCall != 0));
+        }
+        job.queued_ticks = read_ticks();
+        enqueue(queue, std::move(job));
+        return true;
+    }
+
+    case FRAME_PATHS_REQUEST:
+    {
+        if (payload.size() < sizeof(PathsRequestPayload))
+            break;
+        PathsRequestPayload request;
+        std::memcpy(&request, payload.data(), sizeof(request));
+        if (payload.size() != sizeof(request) + trace_bytes(request.flags))
+            break;
+        if (request.flags & PRICE_REPORT_FLAGS)
+        {
+            write_error(out, json, Protocol::Binary, header.request_id, PRICE_REPORTS_ERROR);
+            return true;
+        }
+        job.kind = REQUEST_CLASS_PATHS;
+        job.paths = {request.S0, request.r, request.sigma, request.T,
+                     request.count, request.steps, request.points, request.seed};
+        job.numTrials = request.count;
+        job.options = options_from_flags(request.flags, payload);
+        job.queued_ticks = read_ticks();
+        enqueue(queue, std::move(job));
+        return true;
+    }
+
+    default:
+        write_error(out, json, Protocol::Binary, header.request_id, "Unknown frame type");
+        return true;
+    }
+
+    write_error(out, json, Protocol::Binary, header.request_id, "Malformed request");
+    return true;
+}
+
+} // namespace
+
+int run_server()
+{
+    InputReader in(STDIN_FILENO);
+    OutputWriter out;
+    JobQueue queue;
+
+    // Each thread reuses its own writer; responses go out through OutputWriter. The reader's
+    // responses are small and only buffered; the executor streams large results (batch and
+    // paths arrays) in 64 KB chunks as they are formatted.
+    JsonWriter reader_json(-1, 4096);
+
+    std::thread executor([&]
+                         {
+                             JsonWriter executor_json([&out](const char *data, size_t bytes)
+                                                      { out.write_chunk(data, bytes); },
+                                                      64 * 1024);
+                             Job job;
+                             while (queue.pop(job))
+                             {
+                                 execute(job, out, executor_json);
+                             } });
+
+    // Protocol negotiation: "HELLO <json|binary>" selects the framing for this connection;
+    // a client that starts with a request is talking JSON
+    Protocol protocol = Protocol::Json;
+    std::string line;
+    bool running = in.read_line(line);
+    if (running && line.rfind("HELLO", 0) == 0)
+    {
+        const bool binary = line.find("binary") != std::string::npos;
+        protocol = binary ? Protocol::Binary : Protocol::Json;
+        reader_json.begin_object()
+            .field("protocol", binary ? "binary" : "json")
+            .field("version", static_cast<int>(PROTOCOL_VERSION))
+            .end_object();
+        write_json_line(out, reader_json);
+        line.clear();
+    }
+
+    if (protocol == Protocol::Json)
+    {
+        if (running && !line.empty())
+            running = handle_json_line(line, queue, out, reader_json);
+        while (running && in.read_line(line))
+        {
+            running = handle_json_line(line, queue, out, reader_json);
+        }
+    }
+    else
+    {
+        while (running)
+        {
+            running = handle_binary_frame(in, queue, out, reader_json);
+        }
+    }
+
+    // Finish what was already accepted, then exit
+    queue.close();
+    executor.join();
+    return 0;
+}
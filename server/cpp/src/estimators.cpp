@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "analytical.h"
+#include "arena.h"
+#include "estimators.h"
+#include "kernels.h"
+
+// Normals are drawn in blocks of this many values into arena scratch space
+constexpr long NORMAL_BLOCK = 4096;
+
+// Randomized QMC: independent random shifts, whose spread gives the standard error
+constexpr int QMC_REPLICATES = 16;
+
+// Independent replications of the stratified estimator, whose spread gives the standard error
+constexpr int STRATIFIED_REPLICATES = 20;
+
+// The two unbounded end strata are split into this many bands of halving probability (plus the
+// rest of the tail); left whole, their payoff spread dominates and skews every replication
+constexpr int TAIL_BANDS = 20;
+
+namespace
+{
+
+// Contract constants shared by every estimator
+struct PathModel
+{
+    double S0;
+    double K;
+    double drift;      // (r - sigma^2 / 2) * T
+    double volatility; // sigma * sqrt(T)
+    double discount;   // exp(-r * T)
+    double sign;       // +1 call, -1 put
+
+    explicit PathModel(const BatchContract &c)
+        : S0(c.S0), K(c.K),
+          drift((c.r - 0.5 * c.sigma * c.sigma) * c.T),
+          volatility(c.sigma * std::sqrt(c.T)),
+          discount(std::exp(-c.r * c.T)),
+          sign(c.isCall ? 1.0 : -1.0)
+    {
+    }
+
+    double terminal(double z) const { return S0 * std::exp(drift + volatility * z); }
+    double payoff(double ST) const { return std::fmax(sign * (ST - K), 0.0); }
+};
+
+// Running sum and sum of squares of i.i.d. samples
+struct Moments
+{
+    double sum = 0.0;
+    double sum_squared = 0.0;
+    long count = 0;
+
+    void add(double x)
+    {
+        sum += x;
+        sum_squared += x * x;
+        count++;
+    }
+
+    double mean() const { return sum / count; }
+    double variance() const
+    {
+        return count > 1 ? std::max(0.0, (sum_squared - sum * sum / count) / (count - 1)) : 0.0;
+    }
+};
+
+// Two-sided 95% quantile of Student's t (Cornish-Fisher expansion around the normal's 1.96;
+// within 1e-4 from 5 degrees of freedom)
+double student_t_95(double dof)
+{
+    const double z = 1.959963984540054;
+    const double z2 = z * z;
+    return z + z * (z2 + 1.0) / (4.0 * dof) +
+           z * ((5.0 * z2 + 16.0) * z2 + 3.0) / (96.0 * dof * dof) +
+           z * (((3.0 * z2 + 19.0) * z2 + 17.0) * z2 - 15.0) / (384.0 * dof * dof * dof);
+}
+
+Estimate from_moments(const Moments &m, double discount)
+{
+    return {discount * m.mean(), discount * std::sqrt(m.variance() / m.count), student_t_95(m.count - 1)};
+}
+
+// Call fn(z) for count standard normals from the lane generators
+template <typename Fn>
+void for_each_normal(LaneRng &rng, double *buffer, long count, Fn fn)
+{
+    for (long start = 0; start < count; start += NORMAL_BLOCK)
+    {
+        const long n = std::min(NORMAL_BLOCK, count - start);
+        fill_normals(rng, buffer, n);
+        for (long i = 0; i < n; ++i)
+            fn(buffer[i]);
+    }
+}
+
+// Scalar uniforms in [0, 1), drawn a lane vector at a time
+struct UniformStream
+{
+    LaneRng &rng;
+    ALIGN_DATA(64) double u[SIMD_LANES];
+    int next = SIMD_LANES;
+
+    explicit UniformStream(LaneRng &lanes) : rng(lanes) {}
+
+    double operator()()
+    {
+        if (next == SIMD_LANES)
+        {
+            rng.next_uniform(u);
+            next = 0;
+        }
+        return 1.0 - u[next++]; // (0, 1] -> [0, 1)
+    }
+};
+
+// Radical inverse of i in base 2 (van der Corput sequence)
+double van_der_corput(uint64_t i)
+{
+    uint64_t bits = i;
+    bits = ((bits >> 1) & 0x5555555555555555ULL) | ((bits & 0x5555555555555555ULL) << 1);
+    bits = ((bits >> 2) & 0x3333333333333333ULL) | ((bits & 0x3333333333333333ULL) << 2);
+    bits = ((bits >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((bits & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    bits = ((bits >> 8) & 0x00FF00FF00FF00FFULL) | ((bits & 0x00FF00FF00FF00FFULL) << 8);
+    bits = ((bits >> 16) & 0x0000FFFF0000FFFFULL) | ((bits & 0x0000FFFF0000FFFFULL) << 16);
+    bits = (bits >> 32) | (bits << 32);
+    return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
+// Keep uniforms strictly inside (0, 1) before the inverse CDF
+double clamp_open_unit(double u)
+{
+    return std::min(std::max(u, 0x1.0p-53), 1.0 - 0x1.0p-53);
+}
+
+// Mode of payoff(z) * phi(z): maximizes log(payoff(z)) - z^2 / 2, i.e. solves
+// volatility * ST(z) / (ST(z) - K) = z (call) or -volatility * ST(z) / (K - ST(z)) = z (put)
+// on the side of the strike where the payoff is positive. Found by bisection.
+double importance_shift(const PathModel &model)
+{
+    const double z_strike = (std::log(model.K / model.S0) - model.drift) / model.volatility;
+    auto gradient = [&](double z)
+    {
+        const double ST = model.terminal(z);
+        return model.sign * model.volatility * ST / (model.sign * (ST - model.K)) - z;
+    };
+
+    // The gradient decreases through zero exactly once on [lo, hi]
+    double lo = model.sign > 0 ? z_strike + 1e-9 : z_strike - 12.0;
+    double hi = model.sign > 0 ? z_strike + 12.0 : z_strike - 1e-9;
+    for (int i = 0; i < 100; ++i)
+    {
+        const double mid = 0.5 * (lo + hi);
+        if (gradient(mid) > 0.0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+} // namespace
+
+const char *estimator_name(Estimator estimator)
+{
+    switch (estimator)
+    {
+    case Estimator::Plain:
+        return "plain";
+    case Estimator::Antithetic:
+        return "antithetic";
+    case Estimator::ControlVariate:
+        return "control_variate";
+    case Estimator::QuasiMonteCarlo:
+        return "qmc";
+    case Estimator::Stratified:
+        return "stratified";
+    case Estimator::ImportanceSampling:
+        return "importance_sampling";
+    }
+    return "unknown";
+}
+
+Estimator parse_estimator(const std::string &name)
+{
+    for (int i = 0; i < ESTIMATOR_COUNT; ++i)
+    {
+        const Estimator estimator = static_cast<Estimator>(i);
+        if (name == estimator_name(estimator))
+            return estimator;
+    }
+    throw std::invalid_argument("Unknown estimator: " + name);
+}
+
+Estimate estimate_price(Estimator estimator, const BatchContract &contract, int numTrials, uint64_t seed)
+{
+    if (numTrials < 2 * std::max(QMC_REPLICATES, STRATIFIED_REPLICATES))
+    {
+        throw std::invalid_argument("Number of trials too small for the estimator comparison");
+    }
+
+    const PathModel model(contract);
+    LaneRng rng(seed);
+    Arena &arena = worker_arena();
+    ArenaScope arena_scope(arena);
+    double *normals = arena.allocate<double>(NORMAL_BLOCK);
+
+    switch (estimator)
+    {
+    case Estimator::Plain:
+    {
+        Moments m;
+        for_each_normal(rng, normals, numTrials, [&](double z)
+                        { m.add(model.payoff(model.terminal(z))); });
+        return from_moments(m, model.discount);
+    }
+
+    case Estimator::Antithetic:
+    {
+        // numTrials payoffs = numTrials / 2 pairs; pair averages are the i.i.d. samples
+        Moments m;
+        for_each_normal(rng, normals, numTrials / 2, [&](double z)
+                        { m.add(0.5 * (model.payoff(model.terminal(z)) + model.payoff(model.terminal(-z)))); });
+        return from_moments(m, model.discount);
+    }
+
+    case Estimator::ControlVariate:
+    {
+        // Y = payoff, X = ST with E[X] = S0 * exp(rT); beta = Cov(X, Y) / Var(X) from the same sample
+        const double expected_ST = model.S0 / model.discount;
+        double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_yy = 0.0, sum_xy = 0.0;
+        for_each_normal(rng, normals, numTrials, [&](double z)
+                        {
+                            const double x = model.terminal(z) - expected_ST;
+                            const double y = model.payoff(x + expected_ST);
+                            sum_x += x;
+                            sum_y += y;
+                            sum_xx += x * x;
+                            sum_yy += y * y;
+                            sum_xy += x * y; });
+        const double n = numTrials;
+        const double var_x = (sum_xx - sum_x * sum_x / n) / (n - 1);
+        const double var_y = (sum_yy - sum_y * sum_y / n) / (n - 1);
+        const double cov_xy = (sum_xy - sum_x * sum_y / n) / (n - 1);
+        const double beta = var_x > 0.0 ? cov_xy / var_x : 0.0;
+        const double mean = (sum_y - beta * sum_x) / n;
+        const double residual_variance = std::max(0.0, var_y - beta * cov_xy) * (n - 1) / (n - 2);
+        return {model.discount * mean, model.discount * std::sqrt(residual_variance / n), student_t_95(n - 2)};
+    }
+
+    case Estimator::QuasiMonteCarlo:
+    {
+        // Cranley-Patterson rotation: each replicate shifts the same van der Corput points
+        // by an independent uniform (mod 1), which keeps them low-discrepancy and unbiased
+        const long points = numTrials / QMC_REPLICATES;
+        UniformStream uniform(rng);
+        Moments replicates;
+        for (int rep = 0; rep < QMC_REPLICATES; ++rep)
+        {
+            const double shift = uniform();
+            double sum = 0.0;
+            for (long i = 0; i < points; ++i)
+            {
+                double u = van_der_corput(static_cast<uint64_t>(i)) + shift;
+                u -= std::floor(u);
+                sum += model.payoff(model.terminal(inverse_normal_cdf(clamp_open_unit(u))));
+            }
+            replicates.add(sum / points);
+        }
+        return from_moments(replicates, model.discount);
+    }
+
+    case Estimator::Stratified:
+    {
+        // Equal-probability strata [j/M, (j+1)/M) of the uniform, one draw each, with the end
+        // strata split into bands. Per-stratum variances would need several draws per stratum
+        // and still underestimate the tails, so the standard error comes from the spread of
+        // independent replications instead
+        const long strata = numTrials / STRATIFIED_REPLICATES - 2 * TAIL_BANDS;
+        if (strata < 2)
+        {
+            throw std::invalid_argument("Number of trials too small for the stratified estimator");
+        }
+        const double width = 1.0 / strata;
+        auto payoff_at = [&](double u)
+        { return model.payoff(model.terminal(inverse_normal_cdf(clamp_open_unit(u)))); };
+        UniformStream uniform(rng);
+        Moments replicates;
+        for (int rep = 0; rep < STRATIFIED_REPLICATES; ++rep)
+        {
+            double sum = 0.0;
+            for (long j = 1; j < strata - 1; ++j)
+            {
+                sum += payoff_at((j + uniform()) * width);
+            }
+            // Bands [b/2, b) for b = width, width/2, ..., then [0, b) once; mirrored at the top
+            double tails = 0.0;
+            double band = width;
+            for (int k = 0; k <= TAIL_BANDS; ++k)
+            {
+                const double lower = k < TAIL_BANDS ? 0.5 * band : 0.0;
+                const double lower_u = lower + (band - lower) * uniform();
+                const double upper_u = 1.0 - (lower + (band - lower) * uniform());
+                tails += (band - lower) * (payoff_at(lower_u) + payoff_at(upper_u));
+                band = lower;
+            }
+            replicates.add(sum * width + tails);
+        }
+        return from_moments(replicates, model.discount);
+    }
+
+    case Estimator::ImportanceSampling:
+    {
+        // Sample z ~ N(mu, 1) and weight by phi(z) / phi(z - mu) = exp(-mu * z + mu^2 / 2)
+        const double mu = importance_shift(model);
+        Moments m;
+        for_each_normal(rng, normals, numTrials, [&](double e)
+                        {
+                            const double z = e + mu;
+                            m.add(model.payoff(model.terminal(z)) * std::exp(-mu * z + 0.5 * mu * mu)); });
+        return from_moments(m, model.discount);
+    }
+    }
+
+    throw std::invalid_argument("Unknown estimator");
+}
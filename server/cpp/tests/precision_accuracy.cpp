@@ -0,0 +1,67 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "analytical.h"
+#include "engine.h"
+
+// Accuracy check of the float32 kernel (ctest: precision_accuracy). Every contract of a grid
+// over moneyness, volatility, maturity and call/put is priced with both precisions, and each
+// price must agree with the other precision and with the analytical value to within
+// MAX_SIGMAS combined standard errors. The runs are seeded from the clock, so the bound is
+// wide enough that the grid fails by chance about once in 10^4 runs.
+
+constexpr int TRIALS = 400000;
+constexpr double MAX_SIGMAS = 5.0;
+
+struct Estimate
+{
+    double price;
+    double standard_error;
+};
+
+static Estimate price(const BatchContract &c, Precision precision)
+{
+    SimulationOptions options;
+    options.precision = precision;
+    double price, lower, upper;
+    monte_carlo_black_scholes_mt(c.S0, c.K, c.r, c.sigma, c.T, c.isCall, TRIALS, 0, price, lower, upper, options);
+    return {price, (upper - lower) / (2.0 * 1.96)};
+}
+
+// Prints the comparison and returns whether a and b are within MAX_SIGMAS combined errors
+static bool agree(const char *what, const BatchContract &c, double a, double b, double standard_error)
+{
+    const double sigmas = std::fabs(a - b) / standard_error;
+    const bool ok = sigmas <= MAX_SIGMAS;
+    std::printf("%-4s S0=%-5g K=%g sigma=%-4g T=%-4g %s  %-12s %10.6f vs %10.6f  (%.2f se)\n", ok ? "ok" : "FAIL",
+                c.S0, c.K, c.sigma, c.T, c.isCall ? "call" : "put ", what, a, b, sigmas);
+    return ok;
+}
+
+int main()
+{
+    // Every contract ends in the money on at least ~10% of paths: deep out-of-the-money
+    // prices rest on a handful of paths, and their sample standard error is no bound
+    std::vector<BatchContract> contracts;
+    for (double S0 : {90.0, 100.0, 110.0})
+        for (double sigma : {0.15, 0.4})
+            for (double T : {0.25, 2.0})
+                for (bool isCall : {true, false})
+                    contracts.push_back({S0, 100.0, 0.05, sigma, T, isCall});
+
+    int failures = 0;
+    for (const BatchContract &c : contracts)
+    {
+        const Estimate f64 = price(c, Precision::Double);
+        const Estimate f32 = price(c, Precision::Single);
+        const double exact = black_scholes_analytical(c.S0, c.K, c.r, c.sigma, c.T, c.isCall);
+        const double combined = std::hypot(f64.standard_error, f32.standard_error);
+        failures += !agree("f32 vs f64", c, f32.price, f64.price, combined);
+        failures += !agree("f32 vs exact", c, f32.price, exact, f32.standard_error);
+        failures += !agree("f64 vs exact", c, f64.price, exact, f64.standard_error);
+    }
+
+    std::printf("%d of %zu comparisons failed\n", failures, 3 * contracts.size());
+    return failures == 0 ? 0 : 1;
+}
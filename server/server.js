@@ -5,7 +5,10 @@ const helmet = require('helmet');
 const xss = require('xss-clean');
 const mongoSanitize = require('express-mongo-sanitize');
 const routes = require('./src/routes');
+const batchRoutes = require('./src/batchRoutes');
 const monteCarloService = require('./utils/monte_carlo_service');
+const { httpMetricsMiddleware } = require('./utils/metrics');
+const { httpTracingMiddleware } = require('./utils/tracing');
 const connectDB = require('./config/db');
 
 // Connect to MongoDB
@@ -13,6 +16,12 @@ connectDB();
 
 const app = express();
 
+// Request metrics (first, so rejected and rate-limited requests are counted too)
+app.use(httpMetricsMiddleware);
+
+// Request tracing (W3C traceparent in, OTLP/JSON out when TRACE_EXPORT_FILE or OTEL_EXPORTER_OTLP_ENDPOINT is set)
+app.use(httpTracingMiddleware);
+
 // Security middleware
 // Set security headers
 app.use(helmet());
@@ -20,7 +29,7 @@ app.use(helmet());
 // Rate limiting
 const apiLimiter = rateLimit({
   windowMs: 15 * 60 * 1000, // 15 minutes
-  max: 100, // Limit each IP to 100 requests per windowMs
+  max: Number(process.env.RATE_LIMIT_MAX) || 100, // Limit each IP to 100 requests per windowMs (raise for load tests)
   standardHeaders: true, // Return rate limit info in the `RateLimit-*` headers
   legacyHeaders: false, // Disable the `X-RateLimit-*` headers
   message: 'Too many requests from this IP, please try again after 15 minutes'
@@ -29,9 +38,16 @@ const apiLimiter = rateLimit({
 // Apply rate limiting to all routes
 app.use('/api/', apiLimiter);
 
-// Body parser
-app.use(express.json({ limit: '10kb' })); // Body limit is 10kb
-
+// /metrics sits outside /api/ and polls the engines, so it gets its own budget sized for a
+// scraper (one scrape every 15 s uses 4 a minute)
+const metricsLimiter = rateLimit({
+  windowMs: 60 * 1000, // 1 minute
+  max: Number(process.env.METRICS_RATE_LIMIT_MAX) || 60, // Limit each IP to 60 scrapes per minute
+  standardHeaders: true,
+  legacyHeaders: false,
+  message: 'Too many metrics requests from this IP, please try again after a minute'
+});
+app.use('/metrics', metricsLimiter);
 
 // CORS configuration
 app.use(cors({
@@ -41,6 +57,13 @@ app.use(cors({
   allowedHeaders: ['Content-Type', 'Authorization']
 }));
 
+// Batch pricing streams its own (larger) body, so it is mounted before the global parser
+app.use(batchRoutes);
+
+// Body parser
+app.use(express.json({ limit: '10kb' })); // Body limit is 10kb
+
+
 // Routes
 app.use(routes);
 
@@ -75,6 +98,9 @@ app.listen(PORT, () => {
   const status = monteCarloService.getImplementationStatus();
   if (status.cpp_available) {
     console.log('C++ implementation for Monte Carlo simulation is available');
+    monteCarloService.startEnginePool()
+      .then(() => console.log(`Engine pool ready (${monteCarloService.getEnginePool().size} processes)`))
+      .catch((error) => console.error('Engine pool failed to start:', error.message));
   } else {
     console.log('C++ implementation not found, will use JavaScript implementation');
     console.log('To enable C++ implementation, run: cd server/cpp && ./build.sh');
@@ -0,0 +1,321 @@
+const express = require('express');
+const { check, validationResult } = require('express-validator');
+const monteCarloService = require('../utils/monte_carlo_service');
+const { traced } = require('../utils/tracing');
+
+// Batch requests bypass the global 10kb body parser: they have their own body limit
+// (BATCH_BODY_LIMIT bytes, default 10 MB) and contract cap (BATCH_MAX_CONTRACTS, default 100,000)
+const BATCH_BODY_LIMIT = Number(process.env.BATCH_BODY_LIMIT) || 10 * 1024 * 1024;
+const BATCH_MAX_CONTRACTS = Number(process.env.BATCH_MAX_CONTRACTS) || 100000;
+// Contracts per engine request by default, and engine requests in flight per HTTP request
+const DEFAULT_CHUNK_SIZE = 256;
+const MAX_CHUNKS_IN_FLIGHT = 4;
+const NDJSON_TYPE = 'application/x-ndjson';
+
+const router = express.Router();
+
+/**
+ * Check one contract of a batch
+ * @param {Object} contract - { S0, K, r, sigma, T, isCall }
+ * @returns {string|null} Error message, or null when the contract is valid
+ */
+function validateContract(contract) {
+  if (!contract || typeof contract !== 'object') {
+    return 'Contract must be an object';
+  }
+  const { S0, K, r, sigma, T, isCall } = contract;
+  if (![S0, K, r, sigma, T].every((value) => typeof value === 'number' && Number.isFinite(value))) {
+    return 'S0, K, r, sigma and T must be numbers';
+  }
+  if (S0 <= 0) return 'Stock price must be positive';
+  if (K <= 0) return 'Strike price must be positive';
+  if (sigma <= 0) return 'Volatility must be positive';
+  if (T <= 0) return 'Time to maturity must be positive';
+  if (typeof isCall !== 'boolean') return 'isCall must be a boolean value';
+  return null;
+}
+
+/**
+ * Prices the contracts of one HTTP request in chunks and streams the results as NDJSON.
+ * Chunks are priced concurrently (up to MAX_CHUNKS_IN_FLIGHT), so results are written as
+ * each chunk completes rather than in input order; every line carries its contract's index.
+ */
+class BatchStream {
+  /**
+   * @param {Object} res - Express response
+   * @param {Object} options - { numTrials, precision, chunkSize }
+   */
+  constructor(res, { numTrials, precision, chunkSize }) {
+    this.res = res;
+    this.options = { numTrials, precision };
+    this.chunkSize = chunkSize;
+    this.waiters = [];
+    this.chunk = [];
+    this.indices = [];
+    this.inFlight = new Set();
+    this.received = 0;
+    this.priced = 0;
+    this.failed = 0;
+    this.closed = false;
+    res.on('close', () => {
+      this.closed = true;
+    });
+  }
+
+  // Whether the caller should stop adding contracts until capacity()
+  get saturated() {
+    return this.inFlight.size >= MAX_CHUNKS_IN_FLIGHT;
+  }
+
+  /**
+   * Wait until another chunk may be dispatched
+   * @returns {Promise<void>} Resolves once fewer than MAX_CHUNKS_IN_FLIGHT chunks are being priced
+   */
+  capacity() {
+    if (!this.saturated) {
+      return Promise.resolve();
+    }
+    return new Promise((resolve) => this.waiters.push(resolve));
+  }
+
+  /**
+   * Queue a contract for pricing
+   * @param {number} index - Position in the request
+   * @param {Object} contract - Validated contract
+   */
+  add(index, contract) {
+    this.received++;
+    this.chunk.push(contract);
+    this.indices.push(index);
+    if (this.chunk.length >= this.chunkSize) {
+      this.dispatch();
+    }
+  }
+
+  /**
+   * Report a contract that could not be priced
+   * @param {number} index - Position in the request
+   * @param {string} error - Reason
+   */
+  reject(index, error) {
+    this.received++;
+    this.failed++;
+    this.write(`${JSON.stringify({ index, error })}\n`);
+  }
+
+  dispatch() {
+    if (this.chunk.length === 0 || this.closed) {
+      return;
+    }
+    const contracts = this.chunk;
+    const indices = this.indices;
+    this.chunk = [];
+    this.indices = [];
+
+    const request = monteCarloService.calculateOptionPriceBatch(contracts, this.options)
+      .then((result) => {
+        let text = '';
+        for (let i = 0; i < result.count; i++) {
+          text += `{"index":${indices[i]},"optionPrice":${result.prices[i]},` +
+            `"confidence":{"lower":${result.lower[i]},"upper":${result.upper[i]}}}\n`;
+        }
+        this.priced += result.count;
+        this.write(text);
+      }, (error) => {
+        console.error('Error pricing batch chunk:', error.message);
+        this.failed += indices.length;
+        this.write(indices.map((index) => `{"index":${index},"error":"Failed to calculate option price"}\n`).join(''));
+      })
+      .finally(() => {
+        this.inFlight.delete(request);
+        this.waiters.splice(0).forEach((resolve) => resolve());
+      });
+    this.inFlight.add(request);
+  }
+
+  write(text) {
+    if (this.closed) {
+      return;
+    }
+    if (!this.res.headersSent) {
+      this.res.status(200).type(NDJSON_TYPE);
+    }
+    this.res.write(text);
+  }
+
+  /**
+   * Price what is left, wait for every chunk and end the response with a summary line
+   * @param {string} [error] - Why the request was cut short, if it was
+   * @returns {Promise<void>} Resolves once the response has ended
+   */
+  async finish(error) {
+    this.dispatch();
+    while (this.inFlight.size > 0) {
+      await Promise.all(this.inFlight);
+    }
+    const summary = { done: true, received: this.received, priced: this.priced, failed: this.failed };
+    if (error) {
+      summary.error = error;
+    }
+    this.write(`${JSON.stringify(summary)}\n`);
+    if (!this.closed) {
+      this.res.end();
+    }
+  }
+}
+
+/**
+ * Feed an NDJSON request body (one contract per line) into `batch` as it arrives.
+ * Reading pauses while the batch has MAX_CHUNKS_IN_FLIGHT chunks being priced.
+ * @param {Object} req - Express request (body not yet read)
+ * @param {BatchStream} batch - Destination
+ * @returns {Promise<Object>} Resolves at the end of the body; { error, status } if reading was cut short
+ */
+function streamNdjson(req, batch) {
+  return new Promise((resolve) => {
+    let pending = '';
+    let bytes = 0;
+    let index = 0;
+    let stopped = false;
+
+    const stop = (error, status = 400) => {
+      if (stopped) return;
+      stopped = true;
+      req.removeAllListeners('data');
+      req.resume(); // Drain the rest of the body so the connection can be reused
+      resolve(error ? { error, status } : {});
+    };
+    const takeLine = (line) => {
+      if (line.trim() === '') return;
+      if (index >= BATCH_MAX_CONTRACTS) {
+        stop(`Batch exceeds ${BATCH_MAX_CONTRACTS} contracts`, 413);
+        return;
+      }
+      let contract;
+      try {
+        contract = JSON.parse(line);
+      } catch (error) {
+        batch.reject(index++, 'Invalid JSON');
+        return;
+      }
+      const invalid = validateContract(contract);
+      if (invalid) {
+        batch.reject(index++, invalid);
+      } else {
+        batch.add(index++, contract);
+      }
+    };
+
+    req.setEncoding('utf8');
+    req.on('data', (text) => {
+      bytes += Buffer.byteLength(text);
+      if (bytes > BATCH_BODY_LIMIT) {
+        stop(`Request body exceeds ${BATCH_BODY_LIMIT} bytes`, 413);
+        return;
+      }
+      const lines = (pending + text).split('\n');
+      pending = lines.pop();
+      for (const line of lines) {
+        takeLine(line);
+        if (stopped) return;
+      }
+      if (batch.saturated) {
+        req.pause();
+        batch.capacity().then(() => {
+          if (!stopped) req.resume();
+        });
+      }
+    });
+    req.on('end', () => {
+      takeLine(pending);
+      stop();
+    });
+    req.on('aborted', () => stop('Request aborted'));
+    req.on('error', (error) => stop(error.message));
+  });
+}
+
+// Batch options (query string, or the JSON body)
+const batchValidation = [
+  check('numTrials').isInt({ min: 100, max: 10000000 }).withMessage('Number of trials must be between 100 and 10,000,000'),
+  check('precision').optional().isIn(['single', 'double']).withMessage("Precision must be 'single' or 'double'"),
+  check('chunkSize').optional().isInt({ min: 1, max: 10000 }).withMessage('chunkSize must be between 1 and 10,000')
+];
+
+// Validation error handler
+const handleValidationErrors = (req, res, next) => {
+  const errors = validationResult(req);
+  if (!errors.isEmpty()) {
+    return res.status(400).json({
+      error: 'Validation error',
+      details: errors.array().map(err => ({
+        field: err.param,
+        message: err.msg
+      }))
+    });
+  }
+  next();
+};
+
+// API endpoint for batch Black-Scholes pricing, streaming NDJSON results.
+// Body: NDJSON (one { S0, K, r, sigma, T, isCall } per line, options in the query string), read
+// and priced as it arrives; or JSON { numTrials, precision, chunkSize, contracts: [...] }.
+router.post(
+  '/api/black-scholes/batch',
+  express.json({ limit: BATCH_BODY_LIMIT }),
+  batchValidation,
+  handleValidationErrors,
+  traced('route.black_scholes_batch', async (req, res) => {
+    const source = req.is('application/json') ? { ...req.query, ...req.body } : req.query;
+    const options = {
+      numTrials: parseInt(source.numTrials),
+      precision: source.precision,
+      chunkSize: source.chunkSize !== undefined ? parseInt(source.chunkSize) : DEFAULT_CHUNK_SIZE
+    };
+
+    if (req.is('application/json')) {
+      const { contracts } = req.body;
+      if (!Array.isArray(contracts) || contracts.length === 0) {
+        return res.status(400).json({ error: 'contracts must be a non-empty array' });
+      }
+      if (contracts.length > BATCH_MAX_CONTRACTS) {
+        return res.status(413).json({ error: `Batch exceeds ${BATCH_MAX_CONTRACTS} contracts` });
+      }
+      const batch = new BatchStream(res, options);
+      for (let index = 0; index < contracts.length && !batch.closed; index++) {
+        const invalid = validateContract(contracts[index]);
+        if (invalid) {
+          batch.reject(index, invalid);
+        } else {
+          batch.add(index, contracts[index]);
+          await batch.capacity();
+        }
+      }
+      return batch.finish();
+    }
+
+    if (!req.is(NDJSON_TYPE)) {
+      return res.status(415).json({ error: `Send ${NDJSON_TYPE} or application/json` });
+    }
+    const batch = new BatchStream(res, options);
+    const { error, status } = await streamNdjson(req, batch);
+    if (error && batch.received === 0) {
+      return res.status(status).json({ error });
+    }
+    // Once results are streaming the status is sent; the summary line reports the error
+    return batch.finish(error);
+  })
+);
+
+// Body parser errors on the batch route: report them like validation errors, not as a 500
+router.use('/api/black-scholes/batch', (err, req, res, next) => {
+  if (err.type === 'entity.too.large') {
+    return res.status(413).json({ error: `Request body exceeds ${BATCH_BODY_LIMIT} bytes` });
+  }
+  if (err.type === 'entity.parse.failed') {
+    return res.status(400).json({ error: 'Invalid JSON' });
+  }
+  next(err);
+});
+
+module.exports = router;
@@ -1,10 +1,26 @@
+const os = require('os');
 const express = require('express');
-const { body, validationResult } = require('express-validator');
+const { body, query, validationResult } = require('express-validator');
 const monteCarloService = require('../utils/monte_carlo_service');
+const { benchmarkPaths } = require('../utils/monte_carlo_cpp');
 const historyRoutes = require('../routes/historyRoutes');
+const { registry } = require('../utils/metrics');
+const { traced } = require('../utils/tracing');
 
 const router = express.Router();
 
+// Sample path defaults: a year of trading days, drawn at 100 points per path
+const DEFAULT_PATH_COUNT = 100;
+const DEFAULT_PATH_STEPS = 252;
+const DEFAULT_PATH_POINTS = 100;
+
+// Scaling sweeps keep every core busy for seconds, so /api/benchmark is off unless
+// BENCHMARK_API=1, sweeps at most the machine's threads and simulates at most
+// BENCHMARK_MAX_PATHS paths in total
+const BENCHMARK_ENABLED = process.env.BENCHMARK_API === '1';
+const HARDWARE_THREADS = os.availableParallelism ? os.availableParallelism() : os.cpus().length;
+const BENCHMARK_MAX_PATHS = Number(process.env.BENCHMARK_MAX_PATHS) || 500000000;
+
 // Health check endpoint
 router.get('/api/health', (req, res) => {
   res.json({ status: 'ok', message: 'Server is running' });
@@ -79,20 +95,48 @@ function validateOptionParams(params) {
   return { isValid: true };
 }
 
-// Common validation rules
-const commonValidationRules = [
-  body('S0').isFloat({ min: 0.01 }).withMessage('Stock price must be a positive number'),
-  body('K').isFloat({ min: 0.01 }).withMessage('Strike price must be a positive number'),
-  body('r').isFloat().withMessage('Interest rate must be a number'),
-  body('sigma').isFloat({ min: 0.01 }).withMessage('Volatility must be a positive number'),
-  body('T').isFloat({ min: 0.01 }).withMessage('Time to maturity must be a positive number'),
-  body('isCall').isBoolean().withMessage('isCall must be a boolean value')
+// Option parameter rules for a request location (body, or query for GET endpoints)
+const optionRules = (location) => [
+  location('S0').isFloat({ min: 0.01 }).withMessage('Stock price must be a positive number'),
+  location('K').isFloat({ min: 0.01 }).withMessage('Strike price must be a positive number'),
+  location('r').isFloat().withMessage('Interest rate must be a number'),
+  location('sigma').isFloat({ min: 0.01 }).withMessage('Volatility must be a positive number'),
+  location('T').isFloat({ min: 0.01 }).withMessage('Time to maturity must be a positive number'),
+  location('isCall').isBoolean().withMessage('isCall must be a boolean value')
+];
+
+// Option parameters plus the simulation settings
+const simulationRules = (location) => [
+  ...optionRules(location),
+  location('numTrials').isInt({ min: 100, max: 10000000 }).withMessage('Number of trials must be between 100 and 10,000,000'),
+  location('precision').optional().isIn(['single', 'double']).withMessage("Precision must be 'single' or 'double'")
 ];
 
+// Reports the engine only produces with the double-precision kernel: `field` may not be set
+// together with precision 'single'
+const doublePrecisionOnly = (location, field) => location(field)
+  .custom((value, { req, location: source }) => !([true, 'true', '1'].includes(value) && req[source].precision === 'single'))
+  .withMessage(`${field} is only available with precision 'double'`);
+
+// Common validation rules
+const commonValidationRules = optionRules(body);
+
 // Monte Carlo specific validation
 const monteCarloValidation = [
-  ...commonValidationRules,
-  body('numTrials').isInt({ min: 100, max: 10000000 }).withMessage('Number of trials must be between 100 and 10,000,000')
+  ...simulationRules(body),
+  body('timing').optional().isBoolean().withMessage('timing must be a boolean value'),
+  body('convergence').optional().isBoolean().withMessage('convergence must be a boolean value'),
+  body('distribution').optional().isBoolean().withMessage('distribution must be a boolean value'),
+  doublePrecisionOnly(body, 'timing'),
+  doublePrecisionOnly(body, 'distribution')
+];
+
+// Benchmark sweep validation
+const benchmarkValidation = [
+  ...monteCarloValidation,
+  body('maxThreads').optional().isInt({ min: 1, max: HARDWARE_THREADS })
+    .withMessage(`maxThreads must be between 1 and ${HARDWARE_THREADS} (the hardware threads)`),
+  body('iterations').optional().isInt({ min: 1, max: 20 }).withMessage('iterations must be between 1 and 20')
 ];
 
 // Validation error handler
@@ -129,9 +173,9 @@ router.post(
   monteCarloValidation, 
   handleValidationErrors,
   sanitizeNumericInputs,
-  async (req, res) => {
+  traced('route.black_scholes', async (req, res) => {
     try {
-      const { S0, K, r, sigma, T, isCall, numTrials, validateWithAnalytical } = req.body;
+      const { S0, K, r, sigma, T, isCall, numTrials, validateWithAnalytical, precision, timing, convergence, distribution } = req.body;
       
       // Double-check validation with our custom validator
       const validation = validateOptionParams({ S0, K, r, sigma, T, numTrials });
@@ -148,7 +192,11 @@ router.post(
         T,
         isCall,
         numTrials,
-        validateWithAnalytical
+        validateWithAnalytical,
+        precision,
+        timing: timing === true || timing === 'true',
+        convergence: convergence === true || convergence === 'true',
+        distribution: distribution === true || distribution === 'true'
       };
 
       const result = await monteCarloService.calculateOptionPrice(params);
@@ -157,7 +205,112 @@ router.post(
       console.error('Error calculating option price:', error);
       res.status(500).json({ error: 'Failed to calculate option price' });
     }
-  }
+  })
+);
+
+// Streams a Black-Scholes Monte Carlo run as Server-Sent Events (GET, parameters in the query
+// string, so browsers can use EventSource): 'progress' events with the running estimate, then
+// one 'result' (the /api/black-scholes response) or 'failure' event. The run goes to the engine
+// pool; closing the stream stops the events straight away.
+router.get(
+  '/api/black-scholes/stream',
+  simulationRules(query),
+  query('validateWithAnalytical').optional().isBoolean().withMessage('validateWithAnalytical must be a boolean value'),
+  query('convergence').optional().isBoolean().withMessage('convergence must be a boolean value'),
+  query('distribution').optional().isBoolean().withMessage('distribution must be a boolean value'),
+  doublePrecisionOnly(query, 'distribution'),
+  handleValidationErrors,
+  traced('route.black_scholes_stream', async (req, res) => {
+    const { S0, K, r, sigma, T, isCall, numTrials, precision, validateWithAnalytical, convergence, distribution } = req.query;
+    const isTrue = (value) => value === 'true' || value === '1';
+    const params = {
+      S0: parseFloat(S0),
+      K: parseFloat(K),
+      r: parseFloat(r),
+      sigma: parseFloat(sigma),
+      T: parseFloat(T),
+      isCall: isTrue(isCall),
+      numTrials: parseInt(numTrials),
+      precision,
+      validateWithAnalytical: isTrue(validateWithAnalytical),
+      convergence: isTrue(convergence),
+      distribution: isTrue(distribution)
+    };
+
+    res.writeHead(200, {
+      'Content-Type': 'text/event-stream',
+      'Cache-Control': 'no-cache',
+      Connection: 'keep-alive',
+      'X-Accel-Buffering': 'no' // Stop reverse proxies from holding events back
+    });
+    const send = (event, data) => res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+
+    const controller = new AbortController();
+    res.on('close', () => controller.abort());
+    try {
+      const result = await monteCarloService.streamOptionPrice(params, {
+        onProgress: (progress) => send('progress', progress),
+        signal: controller.signal
+      });
+      send('result', result);
+    } catch (error) {
+      if (controller.signal.aborted) {
+        return; // Client went away
+      }
+      console.error('Error streaming option price:', error);
+      send('failure', { error: 'Failed to calculate option price' });
+    }
+    res.end();
+  })
+);
+
+// Sample paths for plotting, as a binary body (application/octet-stream, little-endian):
+// uint32 count, uint32 points, then float32 times[count * points] and float32
+// prices[count * points], path-major. The engine simulates each path at full resolution and
+// keeps `points` of them (LTTB), so the cost depends on count and steps only.
+router.get(
+  '/api/black-scholes/paths',
+  query('S0').isFloat({ min: 0.01 }).withMessage('Stock price must be a positive number'),
+  query('r').isFloat().withMessage('Interest rate must be a number'),
+  query('sigma').isFloat({ min: 0.01 }).withMessage('Volatility must be a positive number'),
+  query('T').isFloat({ min: 0.01 }).withMessage('Time to maturity must be a positive number'),
+  query('count').optional().isInt({ min: 1, max: 1000 }).withMessage('count must be between 1 and 1,000'),
+  query('steps').optional().isInt({ min: 1, max: 10000 }).withMessage('steps must be between 1 and 10,000'),
+  query('points').optional().isInt({ min: 2, max: 2000 }).withMessage('points must be between 2 and 2,000'),
+  query('seed').optional().isInt({ min: 0, max: Number.MAX_SAFE_INTEGER }).withMessage('seed must be a non-negative integer'),
+  handleValidationErrors,
+  traced('route.black_scholes_paths', async (req, res) => {
+    const { S0, r, sigma, T, count, steps, points, seed } = req.query;
+    const params = {
+      S0: parseFloat(S0),
+      r: parseFloat(r),
+      sigma: parseFloat(sigma),
+      T: parseFloat(T),
+      count: count !== undefined ? parseInt(count) : DEFAULT_PATH_COUNT,
+      steps: steps !== undefined ? parseInt(steps) : DEFAULT_PATH_STEPS,
+      seed: seed !== undefined ? parseInt(seed) : 0
+    };
+    params.points = points !== undefined ? parseInt(points) : Math.min(DEFAULT_PATH_POINTS, params.steps + 1);
+    if (params.points > params.steps + 1) {
+      return res.status(400).json({ error: 'points must be at most steps + 1' });
+    }
+
+    try {
+      const result = await monteCarloService.samplePaths(params);
+      const header = Buffer.alloc(8);
+      header.writeUInt32LE(result.count, 0);
+      header.writeUInt32LE(result.points, 4);
+      const { times, prices } = result;
+      res.status(200).type('application/octet-stream');
+      res.setHeader('Content-Length', header.length + times.byteLength + prices.byteLength);
+      res.write(header);
+      res.write(Buffer.from(times.buffer, times.byteOffset, times.byteLength));
+      res.end(Buffer.from(prices.buffer, prices.byteOffset, prices.byteLength));
+    } catch (error) {
+      console.error('Error simulating sample paths:', error);
+      res.status(500).json({ error: 'Failed to simulate sample paths' });
+    }
+  })
 );
 
 // API endpoint for analytical Black-Scholes calculation
@@ -201,7 +354,7 @@ router.post(
   monteCarloValidation,
   handleValidationErrors,
   sanitizeNumericInputs,
-  async (req, res) => {
+  traced('route.validate_model', async (req, res) => {
     try {
       const { S0, K, r, sigma, T, isCall, numTrials } = req.body;
       
@@ -229,15 +382,83 @@ router.post(
       console.error('Error validating model:', error);
       res.status(500).json({ error: 'Failed to validate model' });
     }
-  }
+  })
 );
 
+// Rejects benchmark requests unless the sweep API is enabled
+const benchmarkEnabled = (req, res, next) => {
+  if (!BENCHMARK_ENABLED) {
+    return res.status(403).json({ error: 'Benchmark API is disabled' });
+  }
+  next();
+};
+
+// API endpoint for thread-count and trial-count scaling sweeps of the C++ engine
+router.post(
+  '/api/benchmark',
+  benchmarkEnabled,
+  benchmarkValidation,
+  handleValidationErrors,
+  sanitizeNumericInputs,
+  traced('route.benchmark', async (req, res) => {
+    try {
+      const { S0, K, r, sigma, T, isCall, numTrials, maxThreads, iterations, precision } = req.body;
+
+      const params = {
+        S0,
+        K,
+        r,
+        sigma,
+        T,
+        isCall,
+        numTrials,
+        maxThreads: maxThreads !== undefined ? parseInt(maxThreads) : undefined,
+        iterations: iterations !== undefined ? parseInt(iterations) : undefined,
+        precision
+      };
+      const paths = benchmarkPaths({ ...params, maxThreads: params.maxThreads || HARDWARE_THREADS });
+      if (paths > BENCHMARK_MAX_PATHS) {
+        return res.status(400).json({
+          error: `The sweep would simulate ${paths.toLocaleString()} paths; the limit is ${BENCHMARK_MAX_PATHS.toLocaleString()}`
+        });
+      }
+
+      // A client that goes away stops the sweep
+      const controller = new AbortController();
+      res.on('close', () => {
+        if (!res.writableFinished) {
+          controller.abort();
+        }
+      });
+      const result = await monteCarloService.runBenchmark(params, { signal: controller.signal });
+      res.json(result);
+    } catch (error) {
+      if (res.destroyed) {
+        return; // Client went away
+      }
+      console.error('Error running benchmark:', error);
+      res.status(500).json({ error: 'Failed to run benchmark' });
+    }
+  })
+);
 
 // Endpoint to check which implementation is being used
 router.get('/api/implementation-status', (req, res) => {
   res.json(monteCarloService.getImplementationStatus());
 });
 
+// Prometheus scrape endpoint
+router.get('/metrics', async (req, res) => {
+  try {
+    const text = await registry.render();
+    res.set('Content-Type', registry.contentType);
+    res.send(text);
+  } catch (error) {
+    console.error('Error rendering metrics:', error);
+    res.status(500).send('Failed to render metrics');
+  }
+});
+
 // History routes
 router.use('/api/history', historyRoutes);
 
@@ -0,0 +1,247 @@
+#!/usr/bin/env node
+/**
+ * Compare two benchmark JSON files (baseline vs candidate) and flag regressions.
+ *
+ * Accepts the output of `monte_carlo_bench` (per-repetition `samples` for each named
+ * benchmark) and of `monte_carlo ... 1 [threads] [iterations]` (per-iteration `runs`).
+ * For every benchmark present in both files it reports the speedup (ratio of medians),
+ * a bootstrap confidence interval for that ratio and a two-sided Mann-Whitney U test.
+ * A benchmark regresses when the whole CI lies below 1 - threshold and the U test is
+ * significant; the process then exits with code 1.
+ *
+ * Usage: node tools/bench_compare.js <baseline.json> <candidate.json>
+ *          [--threshold=0.05] [--confidence=0.95] [--resamples=10000] [--seed=1] [--json]
+ */
+const fs = require('fs');
+const { normalCDF } = require('../utils/black_scholes_analytical');
+
+/**
+ * Extract named timing samples (lower is better) from a benchmark result
+ * @param {Object} result - Parsed benchmark JSON
+ * @returns {Map<string, number[]>} Samples per benchmark name
+ */
+function extractSamples(result) {
+  const samples = new Map();
+  if (Array.isArray(result.benchmarks)) {
+    for (const benchmark of result.benchmarks) {
+      if (Array.isArray(benchmark.samples) && benchmark.samples.length > 0) {
+        samples.set(benchmark.name, benchmark.samples);
+      }
+    }
+  } else if (Array.isArray(result.runs)) {
+    samples.set('run_benchmark', result.runs.map((run) => run.executionTime));
+  }
+  if (samples.size === 0) {
+    throw new Error('No per-run samples found (expected "benchmarks[].samples" or "runs[]")');
+  }
+  return samples;
+}
+
+/**
+ * Median of a numeric array
+ * @param {number[]} values - Values (not modified)
+ * @returns {number} Median
+ */
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  const mid = sorted.length >> 1;
+  return sorted.length % 2 === 0 ? (sorted[mid - 1] + sorted[mid]) / 2 : sorted[mid];
+}
+
+/**
+ * Small seeded PRNG (mulberry32) so bootstrap results are reproducible
+ * @param {number} seed - 32-bit seed
+ * @returns {Function} Generator of uniforms in [0, 1)
+ */
+function mulberry32(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+/**
+ * Percentile bootstrap CI for median(baseline) / median(candidate)
+ * @param {number[]} baseline - Baseline samples
+ * @param {number[]} candidate - Candidate samples
+ * @param {Object} options - { confidence, resamples, random }
+ * @returns {{lower: number, upper: number}} Confidence interval of the speedup
+ */
+function bootstrapSpeedupCI(baseline, candidate, { confidence, resamples, random }) {
+  const resample = (values) => {
+    const out = new Array(values.length);
+    for (let i = 0; i < values.length; i++) {
+      out[i] = values[Math.floor(random() * values.length)];
+    }
+    return out;
+  };
+
+  const ratios = new Float64Array(resamples);
+  for (let i = 0; i < resamples; i++) {
+    ratios[i] = median(resample(baseline)) / median(resample(candidate));
+  }
+  ratios.sort();
+
+  const alpha = (1 - confidence) / 2;
+  const at = (q) => ratios[Math.min(resamples - 1, Math.max(0, Math.floor(q * resamples)))];
+  return { lower: at(alpha), upper: at(1 - alpha) };
+}
+
+/**
+ * Two-sided Mann-Whitney U test (normal approximation with tie correction)
+ * @param {number[]} a - First sample
+ * @param {number[]} b - Second sample
+ * @returns {{u: number, pValue: number}} U statistic for a and two-sided p-value
+ */
+function mannWhitney(a, b) {
+  const combined = a.map((value) => ({ value, group: 0 }))
+    .concat(b.map((value) => ({ value, group: 1 })))
+    .sort((x, y) => x.value - y.value);
+
+  // Average ranks over ties
+  const n = combined.length;
+  let rankSumA = 0;
+  let tieTerm = 0;
+  for (let i = 0; i < n;) {
+    let j = i;
+    while (j + 1 < n && combined[j + 1].value === combined[i].value) j++;
+    const rank = (i + j) / 2 + 1;
+    const ties = j - i + 1;
+    tieTerm += ties * ties * ties - ties;
+    for (let k = i; k <= j; k++) {
+      if (combined[k].group === 0) rankSumA += rank;
+    }
+    i = j + 1;
+  }
+
+  const n1 = a.length;
+  const n2 = b.length;
+  const u = rankSumA - (n1 * (n1 + 1)) / 2;
+  const mean = (n1 * n2) / 2;
+  const variance = ((n1 * n2) / 12) * ((n + 1) - tieTerm / (n * (n - 1)));
+  if (variance <= 0) {
+    return { u, pValue: 1 };
+  }
+  // Continuity correction
+  const z = (Math.abs(u - mean) - 0.5) / Math.sqrt(variance);
+  return { u, pValue: Math.min(1, 2 * (1 - normalCDF(Math.max(z, 0)))) };
+}
+
+/**
+ * Compare every benchmark present in both results
+ * @param {Object} baselineResult - Parsed baseline JSON
+ * @param {Object} candidateResult - Parsed candidate JSON
+ * @param {Object} [options] - { threshold, confidence, resamples, seed }
+ * @returns {Object[]} One comparison per shared benchmark
+ */
+function compareResults(baselineResult, candidateResult, options = {}) {
+  const { threshold = 0.05, confidence = 0.95, resamples = 10000, seed = 1 } = options;
+  const random = mulberry32(seed);
+  const baseline = extractSamples(baselineResult);
+  const candidate = extractSamples(candidateResult);
+  const alpha = 1 - confidence;
+
+  const comparisons = [];
+  for (const [name, baseSamples] of baseline) {
+    const candSamples = candidate.get(name);
+    if (!candSamples) continue;
+
+    const speedup = median(baseSamples) / median(candSamples);
+    const ci = bootstrapSpeedupCI(baseSamples, candSamples, { confidence, resamples, random });
+    const { pValue } = mannWhitney(baseSamples, candSamples);
+
+    let verdict = 'unchanged';
+    if (ci.upper < 1 - threshold && pValue < alpha) {
+      verdict = 'regression';
+    } else if (ci.lower > 1 + threshold && pValue < alpha) {
+      verdict = 'improvement';
+    }
+
+    comparisons.push({
+      name,
+      baselineMedian: median(baseSamples),
+      candidateMedian: median(candSamples),
+      speedup,
+      ci,
+      pValue,
+      verdict
+    });
+  }
+  return comparisons;
+}
+
+/**
+ * Parse --key=value flags and positional arguments
+ * @param {string[]} argv - Arguments after the script name
+ * @returns {Object} { files, options, json }
+ */
+function parseArgs(argv) {
+  const files = [];
+  const options = {};
+  let json = false;
+  for (const arg of argv) {
+    if (arg === '--json') {
+      json = true;
+    } else if (arg.startsWith('--')) {
+      const [key, value] = arg.slice(2).split('=');
+      if (!['threshold', 'confidence', 'resamples', 'seed'].includes(key) || value === undefined || isNaN(Number(value))) {
+        throw new Error(`Unknown or invalid option: ${arg}`);
+      }
+      options[key] = Number(value);
+    } else {
+      files.push(arg);
+    }
+  }
+  if (files.length !== 2) {
+    throw new Error('Expected <baseline.json> <candidate.json>');
+  }
+  return { files, options, json };
+}
+
+function main() {
+  let args;
+  try {
+    args = parseArgs(process.argv.slice(2));
+  } catch (error) {
+    console.error(error.message);
+    console.error('Usage: node tools/bench_compare.js <baseline.json> <candidate.json> [--threshold=0.05] [--confidence=0.95] [--resamples=10000] [--seed=1] [--json]');
+    process.exit(2);
+  }
+
+  const [baselineFile, candidateFile] = args.files;
+  const comparisons = compareResults(
+    JSON.parse(fs.readFileSync(baselineFile, 'utf8')),
+    JSON.parse(fs.readFileSync(candidateFile, 'utf8')),
+    args.options
+  );
+  const regressions = comparisons.filter((c) => c.verdict === 'regression');
+
+  if (args.json) {
+    console.log(JSON.stringify({ comparisons, regressions: regressions.length }, null, 2));
+  } else {
+    const pad = Math.max(9, ...comparisons.map((c) => c.name.length));
+    console.log(`${'benchmark'.padEnd(pad)}  speedup  ${'CI'.padEnd(17)}  p-value  verdict`);
+    for (const c of comparisons) {
+      const ci = `[${c.ci.lower.toFixed(3)}, ${c.ci.upper.toFixed(3)}]`;
+      console.log(`${c.name.padEnd(pad)}  ${c.speedup.toFixed(3).padStart(7)}  ${ci.padEnd(17)}  ${c.pValue.toFixed(4).padStart(7)}  ${c.verdict}`);
+    }
+    console.log(`\n${comparisons.length} compared, ${regressions.length} regression(s)`);
+  }
+
+  process.exit(regressions.length > 0 ? 1 : 0);
+}
+
+if (require.main === module) {
+  main();
+}
+
+module.exports = {
+  extractSamples,
+  bootstrapSpeedupCI,
+  mannWhitney,
+  compareResults
+};
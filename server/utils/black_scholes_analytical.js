@@ -128,6 +128,7 @@ function calculateAnalyticalPrice(params) {
 }
 
 module.exports = {
+  normalCDF,
   blackScholesAnalytical,
   calculateAnalyticalPrice
 }; 
\ No newline at end of file
@@ -0,0 +1,177 @@
+const crypto = require('crypto');
+const { EventEmitter } = require('events');
+const fs = require('fs');
+const path = require('path');
+const { threadId } = require('worker_threads');
+
+// How often the binary is checked for changes, and how long a changed file must stay
+// unchanged before it is read (so a copy in progress is not installed half-written)
+const WATCH_INTERVAL_MS = 2000;
+const WATCH_SETTLE_MS = 500;
+
+/**
+ * Copy the engine binary to `versionsDir` under its content hash. The copy is written to a
+ * per-thread temporary file and renamed into place, so concurrent installs never share a
+ * file that is open for writing (which would make spawning it fail with ETXTBSY).
+ * @param {string} sourcePath - Deployed binary
+ * @param {string} versionsDir - Directory of installed builds
+ * @returns {Object} { hash, path } of the installed copy
+ */
+function installBinary(sourcePath, versionsDir) {
+  const contents = fs.readFileSync(sourcePath);
+  const hash = crypto.createHash('sha256').update(contents).digest('hex').slice(0, 16);
+  const installed = path.join(versionsDir, `${path.basename(sourcePath)}-${hash}`);
+  if (!fs.existsSync(installed)) {
+    fs.mkdirSync(versionsDir, { recursive: true });
+    const temporary = `${installed}.${process.pid}-${threadId}.tmp`;
+    fs.writeFileSync(temporary, contents, { mode: 0o755 });
+    fs.renameSync(temporary, installed);
+  }
+  return { hash, path: installed };
+}
+
+/**
+ * Delete installed builds other than `keep`
+ * @param {string} sourcePath - Deployed binary (names the copies)
+ * @param {string} versionsDir - Directory of installed builds
+ * @param {Array<string>} keep - Paths still in use
+ */
+function pruneBinaries(sourcePath, versionsDir, keep) {
+  const inUse = new Set(keep.filter(Boolean));
+  fs.readdir(versionsDir, (error, names) => {
+    if (error) return;
+    const prefix = `${path.basename(sourcePath)}-`;
+    for (const name of names) {
+      const file = path.join(versionsDir, name);
+      if (name.startsWith(prefix) && !name.endsWith('.tmp') && !inUse.has(file)) {
+        fs.rm(file, { force: true }, () => {});
+      }
+    }
+  });
+}
+
+/**
+ * Installs the deployed engine binary and watches it for new builds. Each new build is
+ * installed and handed to `apply`, one at a time; a build `apply` rejects is remembered and
+ * not retried until the file changes again.
+ *
+ * Events: 'upgrade' (hash), 'rollback' (hash, error), 'error' (error) for install failures
+ */
+class EngineBinaryWatcher extends EventEmitter {
+  /**
+   * @param {Object} options - Watcher options
+   * @param {string} options.sourcePath - Deployed binary
+   * @param {string} [options.versionsDir] - Where builds are installed (default: .engine-versions next to the binary)
+   * @param {Function} options.apply - async (candidate: { hash, path }) => void; throws if the build is unfit
+   */
+  constructor({ sourcePath, versionsDir = path.join(path.dirname(sourcePath), '.engine-versions'), apply }) {
+    super();
+    this.sourcePath = sourcePath;
+    this.versionsDir = versionsDir;
+    this.apply = apply;
+    this.version = null; // { hash, path } of the running build
+    this.rejected = new Set();
+    this.upgrading = null;
+    this.recheck = false;
+    this.settleTimer = null;
+    this.watching = false;
+    this.upgrades = 0;
+    this.rollbacks = 0;
+  }
+
+  /**
+   * Install the current binary (if not yet done)
+   * @returns {Object|null} { hash, path } of the running build, or null if it could not be installed
+   */
+  install() {
+    if (!this.version) {
+      try {
+        this.version = installBinary(this.sourcePath, this.versionsDir);
+      } catch (error) {
+        this.emit('error', error);
+      }
+    }
+    return this.version;
+  }
+
+  /**
+   * Start polling the binary for changes
+   */
+  watch() {
+    if (this.watching) {
+      return;
+    }
+    this.watching = true;
+    fs.watchFile(this.sourcePath, { interval: WATCH_INTERVAL_MS, persistent: false }, (current, previous) => {
+      if (current.mtimeMs === previous.mtimeMs && current.ino === previous.ino && current.size === previous.size) {
+        return;
+      }
+      clearTimeout(this.settleTimer);
+      this.settleTimer = setTimeout(() => this.check(), WATCH_SETTLE_MS);
+      this.settleTimer.unref();
+    });
+  }
+
+  /**
+   * Stop polling
+   */
+  close() {
+    clearTimeout(this.settleTimer);
+    if (this.watching) {
+      fs.unwatchFile(this.sourcePath);
+      this.watching = false;
+    }
+  }
+
+  /**
+   * Delete installed builds except the running one and `keep`
+   * @param {Array<string>} keep - Further paths still in use
+   */
+  prune(keep) {
+    pruneBinaries(this.sourcePath, this.versionsDir, [this.version && this.version.path, ...keep]);
+  }
+
+  check() {
+    if (!this.watching) {
+      return;
+    }
+    if (this.upgrading) {
+      this.recheck = true;
+      return;
+    }
+    let candidate;
+    try {
+      candidate = installBinary(this.sourcePath, this.versionsDir);
+    } catch (error) {
+      return; // Binary missing or unreadable mid-deploy - the next change retries
+    }
+    if ((this.version && candidate.hash === this.version.hash) || this.rejected.has(candidate.hash)) {
+      return;
+    }
+    this.upgrading = Promise.resolve()
+      .then(() => this.apply(candidate))
+      .then(() => {
+        this.version = candidate;
+        this.upgrades++;
+        this.emit('upgrade', candidate.hash);
+      }, (error) => {
+        this.rollbacks++;
+        this.rejected.add(candidate.hash);
+        fs.rm(candidate.path, { force: true }, () => {});
+        this.emit('rollback', candidate.hash, error);
+      })
+      .finally(() => {
+        this.upgrading = null;
+        if (this.recheck) {
+          this.recheck = false;
+          this.check();
+        }
+      });
+  }
+}
+
+module.exports = {
+  EngineBinaryWatcher,
+  installBinary,
+  pruneBinaries
+};
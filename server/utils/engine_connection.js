@@ -0,0 +1,726 @@
+const { spawn } = require('child_process');
+const { EventEmitter } = require('events');
+
+// Binary protocol layout - mirrors server/cpp/include/binary_protocol.h
+const FRAME_MAGIC = 0x3142434d; // "MCB1"
+const PROTOCOL_VERSION = 1;
+const FRAME = {
+  PRICE_REQUEST: 0x01,
+  BATCH_REQUEST: 0x02,
+  PING: 0x03,
+  STATS_REQUEST: 0x04,
+  PATHS_REQUEST: 0x05,
+  PRICE_RESULT: 0x81,
+  BATCH_RESULT: 0x82,
+  PONG: 0x83,
+  STATS_RESULT: 0x84,
+  PATHS_RESULT: 0x85,
+  ERROR: 0xff,
+  PROGRESS: 0x90,
+  PRICE_DETAIL_RESULT: 0x91
+};
+const HEADER_BYTES = 16;
+const PRICE_REQUEST_BYTES = 56;
+const BATCH_HEADER_BYTES = 16;
+const BATCH_CONTRACT_BYTES = 48;
+const BATCH_RESULT_HEADER_BYTES = 8;
+const PRICE_RESULT_BYTES = 32;
+const PRICE_DETAIL_HEADER_BYTES = 8;
+const PATHS_REQUEST_BYTES = 56;
+const PATHS_RESULT_HEADER_BYTES = 8;
+const STATS_BYTES = 56;
+const LATENCY_SUMMARY_BYTES = 40;
+const REQUEST_CLASSES = ['price', 'batch', 'paths'];
+const LATENCY_STAGES = ['queueWait', 'service', 'endToEnd'];
+const REQUEST_FLAG_SINGLE_PRECISION = 1;
+const REQUEST_FLAG_TRACE = 2;
+const REQUEST_FLAG_TIMING = 4;
+const REQUEST_FLAG_CONVERGENCE = 8;
+const REQUEST_FLAG_DISTRIBUTION = 16;
+const REQUEST_FLAG_PROGRESS = 32;
+const TRACE_CONTEXT_BYTES = 24;
+const TRACE_RESULT_HEADER_BYTES = 8;
+const TRACE_SPAN_BYTES = 40;
+const TRACE_SPAN_NAMES = ['engine.process', 'engine.job', 'engine.parse', 'engine.validate',
+  'engine.queue', 'engine.simulate', 'engine.output'];
+
+/**
+ * Encode a W3C traceparent as the binary protocol's TraceContextPayload
+ * @param {string} traceparent - "00-<trace id>-<span id>-<flags>"
+ * @returns {Buffer} 16-byte trace id followed by the 8-byte parent span id
+ */
+function encodeTraceContext(traceparent) {
+  const [, traceId, spanId] = traceparent.split('-');
+  return Buffer.from(traceId + spanId, 'hex');
+}
+
+/**
+ * Decode the trace extension appended to a traced response
+ * @param {Buffer} frame - Frame buffer
+ * @param {number} offset - Start of the TraceResultHeader
+ * @param {string} traceId - Trace id the request carried
+ * @returns {Object} { traceId, spans } in the shape of the engine's JSON "trace" field
+ */
+function decodeTrace(frame, offset, traceId) {
+  const count = frame.readUInt32LE(offset);
+  const spans = [];
+  for (let i = 0; i < count; i++) {
+    const base = offset + TRACE_RESULT_HEADER_BYTES + i * TRACE_SPAN_BYTES;
+    spans.push({
+      spanId: frame.toString('hex', base, base + 8),
+      parentSpanId: frame.toString('hex', base + 8, base + 16),
+      name: TRACE_SPAN_NAMES[frame.readUInt32LE(base + 32)] || 'engine.unknown',
+      startTimeUnixNano: frame.readBigUInt64LE(base + 16).toString(),
+      endTimeUnixNano: frame.readBigUInt64LE(base + 24).toString()
+    });
+  }
+  return { traceId, spans };
+}
+
+/**
+ * View `count` float64 values at `offset` of `buffer` as a Float64Array.
+ * Zero-copy when the bytes are 8-byte aligned in the underlying ArrayBuffer
+ * (frames normally are); otherwise the values are copied once.
+ * @param {Buffer} buffer - Frame buffer
+ * @param {number} offset - Byte offset within the buffer
+ * @param {number} count - Number of doubles
+ * @returns {Float64Array} Typed array over the values
+ */
+function float64View(buffer, offset, count) {
+  const byteOffset = buffer.byteOffset + offset;
+  if (byteOffset % 8 === 0) {
+    return new Float64Array(buffer.buffer, byteOffset, count);
+  }
+  const copy = new Float64Array(count);
+  new Uint8Array(copy.buffer).set(buffer.subarray(offset, offset + count * 8));
+  return copy;
+}
+
+/**
+ * View `count` float32 values at `offset` of `buffer` as a Float32Array (see float64View)
+ * @param {Buffer} buffer - Frame buffer
+ * @param {number} offset - Byte offset within the buffer
+ * @param {number} count - Number of floats
+ * @returns {Float32Array} Typed array over the values
+ */
+function float32View(buffer, offset, count) {
+  const byteOffset = buffer.byteOffset + offset;
+  if (byteOffset % 4 === 0) {
+    return new Float32Array(buffer.buffer, byteOffset, count);
+  }
+  const copy = new Float32Array(count);
+  new Uint8Array(copy.buffer).set(buffer.subarray(offset, offset + count * 4));
+  return copy;
+}
+
+// Packed contracts: S0, K, r, sigma, T, isCall (1/0) per contract
+const CONTRACT_FIELDS = 6;
+
+/**
+ * Pack contracts into one Float64Array (in a SharedArrayBuffer when `shared`), the form
+ * worker threads exchange without copying
+ * @param {Array<Object>} contracts - Contracts with S0, K, r, sigma, T, isCall
+ * @param {boolean} [shared=false] - Back the array with a SharedArrayBuffer
+ * @returns {Float64Array} CONTRACT_FIELDS values per contract
+ */
+function packContracts(contracts, shared = false) {
+  const bytes = contracts.length * CONTRACT_FIELDS * 8;
+  const packed = new Float64Array(shared ? new SharedArrayBuffer(bytes) : new ArrayBuffer(bytes));
+  for (let i = 0, field = 0; i < contracts.length; i++, field += CONTRACT_FIELDS) {
+    const c = contracts[i];
+    packed[field] = c.S0;
+    packed[field + 1] = c.K;
+    packed[field + 2] = c.r;
+    packed[field + 3] = c.sigma;
+    packed[field + 4] = c.T;
+    packed[field + 5] = c.isCall ? 1 : 0;
+  }
+  return packed;
+}
+
+// Request flags for the binary protocol
+function requestFlags(precision, traceparent) {
+  return (precision === 'single' ? REQUEST_FLAG_SINGLE_PRECISION : 0) | (traceparent ? REQUEST_FLAG_TRACE : 0);
+}
+
+// Trailing --key=value flags for the JSON protocol
+function textFlags(precision, traceparent) {
+  return `${precision ? ` --precision=${precision}` : ''}${traceparent ? ` --trace=${traceparent}` : ''}`;
+}
+
+// Price report flags: [binary request flag, JSON protocol flag]
+const REPORT_FLAGS = {
+  timing: [REQUEST_FLAG_TIMING, ' --timing'],
+  convergence: [REQUEST_FLAG_CONVERGENCE, ' --convergence'],
+  distribution: [REQUEST_FLAG_DISTRIBUTION, ' --distribution'],
+  onProgress: [REQUEST_FLAG_PROGRESS, ' --progress']
+};
+
+/**
+ * Flags for the reports a price request asks for
+ * @param {Object} params - Price parameters
+ * @returns {Object} { flags, text } for the binary and JSON protocols
+ */
+function reportFlags(params) {
+  let flags = 0;
+  let text = '';
+  for (const [name, [flag, option]] of Object.entries(REPORT_FLAGS)) {
+    if (params[name]) {
+      flags |= flag;
+      text += option;
+    }
+  }
+  return { flags, text };
+}
+
+/**
+ * Persistent connection to a `monte_carlo --serve` process.
+ * The protocol ('binary' or 'json') is negotiated once when the connection starts;
+ * requests are multiplexed by id, so many can be in flight at once.
+ */
+class EngineConnection extends EventEmitter {
+  /**
+   * @param {Object} options - Connection options
+   * @param {string} options.executablePath - Path to the monte_carlo executable
+   * @param {string} [options.protocol='binary'] - 'binary' or 'json'
+   */
+  constructor({ executablePath, protocol = 'binary' }) {
+    super();
+    this.executablePath = executablePath;
+    this.protocol = protocol;
+    this.process = null;
+    this.pending = new Map();
+    this.nextId = 1;
+    this.ready = null;
+    this.closed = false;
+
+    // Receive state
+    this.chunks = [];
+    this.buffered = 0;
+    this.handshakeDone = false;
+    this.lineChunks = []; // Pieces of the current, unfinished line (text mode)
+  }
+
+  /**
+   * Spawn the engine and negotiate the protocol
+   * @returns {Promise<void>} Resolves once the engine acknowledged the protocol
+   */
+  start() {
+    if (this.ready) {
+      return this.ready;
+    }
+
+    this.ready = new Promise((resolve, reject) => {
+      this.onHandshake = resolve;
+      this.onHandshakeError = reject;
+      this.process = spawn(this.executablePath, ['--serve']);
+
+      this.process.stdout.on('data', (chunk) => this.onData(chunk));
+      this.process.stderr.on('data', (data) => this.emit('stderr', data.toString()));
+
+      this.process.on('error', (error) => {
+        reject(new Error(`Failed to start C++ process: ${error.message}`));
+        this.failAll(error);
+      });
+
+      this.process.on('close', (code) => {
+        this.closed = true;
+        const error = new Error(`C++ engine exited with code ${code}`);
+        reject(error);
+        this.failAll(error);
+        this.emit('exit', code);
+      });
+
+      this.process.stdin.on('error', () => {
+        // EPIPE after the engine died - reported through 'close'
+      });
+
+      this.process.stdin.write(`HELLO ${this.protocol}\n`);
+    });
+
+    return this.ready;
+  }
+
+  /**
+   * Price one option
+   * @param {Object} params - Black-Scholes parameters (S0, K, r, sigma, T, isCall, numTrials, threads, precision)
+   * @param {string} [params.traceparent] - W3C trace context; the result then carries the engine's spans as `trace`
+   * @param {boolean} [params.timing] - Add the engine's per-phase `timing` breakdown
+   * @param {boolean} [params.convergence] - Add the `convergence` checkpoints (1k, 2k, 4k, ... paths)
+   * @param {boolean} [params.distribution] - Add the terminal-price and payoff `distribution`
+   * @param {Function} [params.onProgress] - Receives { paths, totalPaths, optionPrice, confidence }
+   *   about every 100 ms while the engine simulates
+   * @returns {Promise<Object>} { optionPrice, confidence: { lower, upper }, threadsUsed, cpuSeconds }
+   *   (cpuSeconds: the job's engine CPU time over all its threads)
+   */
+  async price(params) {
+    await this.start();
+    const { S0, K, r, sigma, T, isCall, numTrials, threads = 0, precision, traceparent, onProgress } = params;
+    const reports = reportFlags(params);
+
+    if (this.protocol === 'json') {
+      const flags = textFlags(precision, traceparent) + reports.text;
+      return this.sendLine(`price ${S0} ${K} ${r} ${sigma} ${T} ${isCall ? 1 : 0} ${numTrials} ${threads}${flags}`, onProgress);
+    }
+
+    const payload = Buffer.alloc(PRICE_REQUEST_BYTES + (traceparent ? TRACE_CONTEXT_BYTES : 0));
+    payload.writeDoubleLE(S0, 0);
+    payload.writeDoubleLE(K, 8);
+    payload.writeDoubleLE(r, 16);
+    payload.writeDoubleLE(sigma, 24);
+    payload.writeDoubleLE(T, 32);
+    payload.writeInt32LE(isCall ? 1 : 0, 40);
+    payload.writeInt32LE(numTrials, 44);
+    payload.writeInt32LE(threads, 48);
+    payload.writeUInt32LE(requestFlags(precision, traceparent) | reports.flags, 52);
+    if (traceparent) {
+      encodeTraceContext(traceparent).copy(payload, PRICE_REQUEST_BYTES);
+    }
+    return this.sendFrame(FRAME.PRICE_REQUEST, payload, traceparent, onProgress);
+  }
+
+  /**
+   * Price many contracts with one request
+   * @param {Array<Object>|Float64Array} contracts - Contracts with S0, K, r, sigma, T, isCall, or packContracts() output
+   * @param {Object} options - Batch settings
+   * @param {number} options.numTrials - Trials per contract
+   * @param {number} [options.threads=0] - Threads (0 = automatic)
+   * @param {string} [options.precision] - 'single' or 'double'
+   * @param {string} [options.traceparent] - W3C trace context; the result then carries the engine's spans as `trace`
+   * @returns {Promise<Object>} { count, threadsUsed, prices, lower, upper } with Float64Array columns
+   */
+  async priceBatch(contracts, { numTrials, threads = 0, precision, traceparent } = {}) {
+    await this.start();
+    const packed = contracts instanceof Float64Array ? contracts : packContracts(contracts);
+    const count = packed.length / CONTRACT_FIELDS;
+
+    if (this.protocol === 'json') {
+      const fields = packed.join(' ');
+      const flags = textFlags(precision, traceparent);
+      const result = await this.sendLine(`batch ${numTrials} ${threads} ${count} ${fields}${flags}`);
+      return {
+        count: result.count,
+        threadsUsed: result.threadsUsed,
+        prices: Float64Array.from(result.prices),
+        lower: Float64Array.from(result.lower),
+        upper: Float64Array.from(result.upper),
+        ...(result.trace ? { trace: result.trace } : {})
+      };
+    }
+
+    const contractBytes = BATCH_HEADER_BYTES + count * BATCH_CONTRACT_BYTES;
+    const payload = Buffer.alloc(contractBytes + (traceparent ? TRACE_CONTEXT_BYTES : 0));
+    payload.writeUInt32LE(count, 0);
+    payload.writeInt32LE(numTrials, 4);
+    payload.writeInt32LE(threads, 8);
+    payload.writeUInt32LE(requestFlags(precision, traceparent), 12);
+    for (let i = 0; i < count; i++) {
+      const base = BATCH_HEADER_BYTES + i * BATCH_CONTRACT_BYTES;
+      const field = i * CONTRACT_FIELDS;
+      payload.writeDoubleLE(packed[field], base);
+      payload.writeDoubleLE(packed[field + 1], base + 8);
+      payload.writeDoubleLE(packed[field + 2], base + 16);
+      payload.writeDoubleLE(packed[field + 3], base + 24);
+      payload.writeDoubleLE(packed[field + 4], base + 32);
+      payload.writeInt32LE(packed[field + 5], base + 40);
+    }
+    if (traceparent) {
+      encodeTraceContext(traceparent).copy(payload, contractBytes);
+    }
+    return this.sendFrame(FRAME.BATCH_REQUEST, payload, traceparent);
+  }
+
+  /**
+   * Simulate sample paths for plotting, each downsampled to `points` points (LTTB)
+   * @param {Object} params - Path settings
+   * @param {number} params.S0 - Initial stock price
+   * @param {number} params.r - Risk-free rate (the drift)
+   * @param {number} params.sigma - Volatility
+   * @param {number} params.T - Horizon in years
+   * @param {number} params.count - Paths
+   * @param {number} params.steps - Simulated time steps per path
+   * @param {number} params.points - Points kept per path (at most steps + 1)
+   * @param {number} [params.seed=0] - Generator seed (0 = from the clock)
+   * @param {string} [params.traceparent] - W3C trace context; the result then carries the engine's spans as `trace`
+   * @returns {Promise<Object>} { count, points, times, prices } with path-major Float32Array columns
+   */
+  async samplePaths({ S0, r, sigma, T, count, steps, points, seed = 0, traceparent }) {
+    await this.start();
+
+    if (this.protocol === 'json') {
+      const flags = textFlags(undefined, traceparent);
+      const result = await this.sendLine(`paths ${S0} ${r} ${sigma} ${T} ${count} ${steps} ${points} ${seed}${flags}`);
+      return {
+        count: result.count,
+        points: result.points,
+        times: Float32Array.from(result.times),
+        prices: Float32Array.from(result.prices),
+        ...(result.trace ? { trace: result.trace } : {})
+      };
+    }
+
+    const payload = Buffer.alloc(PATHS_REQUEST_BYTES + (traceparent ? TRACE_CONTEXT_BYTES : 0));
+    payload.writeDoubleLE(S0, 0);
+    payload.writeDoubleLE(r, 8);
+    payload.writeDoubleLE(sigma, 16);
+    payload.writeDoubleLE(T, 24);
+    payload.writeBigUInt64LE(BigInt(seed), 32);
+    payload.writeInt32LE(count, 40);
+    payload.writeInt32LE(steps, 44);
+    payload.writeInt32LE(points, 48);
+    payload.writeUInt32LE(requestFlags(undefined, traceparent), 52);
+    if (traceparent) {
+      encodeTraceContext(traceparent).copy(payload, PATHS_REQUEST_BYTES);
+    }
+    return this.sendFrame(FRAME.PATHS_REQUEST, payload, traceparent);
+  }
+
+  /**
+   * Round-trip a ping through the engine's reader thread
+   * @returns {Promise<void>} Resolves when the engine answers
+   */
+  async ping() {
+    await this.start();
+    if (this.protocol === 'json') {
+      await this.sendLine('ping');
+      return;
+    }
+    await this.sendFrame(FRAME.PING, Buffer.alloc(0));
+  }
+
+  /**
+   * Engine process counters (answered by the reader thread, so it works while jobs run)
+   * @returns {Promise<Object>} { uptimeSeconds, cpuSeconds, requestsTotal, jobsCompleted,
+   *   jobsFailed, pathsTotal, queueDepth, inFlight, latency } where latency[class][stage] is
+   *   { count, p50, p99, p999, max } in microseconds for classes price/batch/paths and stages
+   *   queueWait/service/endToEnd
+   */
+  async stats() {
+    await this.start();
+    if (this.protocol === 'json') {
+      const result = await this.sendLine('stats');
+      return result.stats;
+    }
+    return this.sendFrame(FRAME.STATS_REQUEST, Buffer.alloc(0));
+  }
+
+  /**
+   * Close stdin; the engine finishes accepted requests and exits
+   */
+  close() {
+    if (this.process && !this.closed) {
+      this.process.stdin.end();
+    }
+  }
+
+  /**
+   * Kill the engine now; outstanding requests fail
+   */
+  terminate() {
+    if (this.process && !this.closed) {
+      this.process.kill('SIGKILL');
+    }
+  }
+
+  // --- internals ---
+
+  allocateId() {
+    const id = this.nextId;
+    this.nextId = this.nextId >= 0xffffffff ? 1 : this.nextId + 1;
+    return id;
+  }
+
+  track(id, traceId, onProgress) {
+    return new Promise((resolve, reject) => {
+      this.pending.set(id, { resolve, reject, traceId, onProgress });
+    });
+  }
+
+  // Pass a running estimate to the request's onProgress
+  progress(id, report) {
+    const entry = this.pending.get(id);
+    if (entry && entry.onProgress) {
+      entry.onProgress(report);
+    }
+  }
+
+  sendLine(command, onProgress) {
+    if (this.closed) {
+      return Promise.reject(new Error('C++ engine is not running'));
+    }
+    const id = this.allocateId();
+    const promise = this.track(id, undefined, onProgress);
+    this.process.stdin.write(`${id} ${command}\n`);
+    return promise;
+  }
+
+  sendFrame(type, payload, traceparent, onProgress) {
+    if (this.closed) {
+      return Promise.reject(new Error('C++ engine is not running'));
+    }
+    const id = this.allocateId();
+    const header = Buffer.alloc(HEADER_BYTES);
+    header.writeUInt32LE(FRAME_MAGIC, 0);
+    header.writeUInt16LE(type, 4);
+    header.writeUInt16LE(PROTOCOL_VERSION, 6);
+    header.writeUInt32LE(id, 8);
+    header.writeUInt32LE(payload.length, 12);
+    const promise = this.track(id, traceparent ? traceparent.split('-')[1] : undefined, onProgress);
+    this.process.stdin.write(header);
+    if (payload.length > 0) {
+      this.process.stdin.write(payload);
+    }
+    return promise;
+  }
+
+  settle(id, error, value) {
+    const entry = this.pending.get(id);
+    if (!entry) {
+      return;
+    }
+    this.pending.delete(id);
+    if (error) {
+      entry.reject(error);
+    } else {
+      entry.resolve(value);
+    }
+  }
+
+  failAll(error) {
+    for (const [, entry] of this.pending) {
+      entry.reject(error);
+    }
+    this.pending.clear();
+  }
+
+  onData(chunk) {
+    if (!this.handshakeDone || this.protocol === 'json') {
+      this.onTextData(chunk);
+    } else {
+      this.onBinaryData(chunk);
+    }
+  }
+
+  onTextData(chunk) {
+    // Only the new chunk is scanned for newlines; an unfinished line is kept as pieces and
+    // joined once its end arrives, so a large response costs linear time
+    let start = 0;
+    let newline;
+    while ((newline = chunk.indexOf(0x0a, start)) !== -1) {
+      let line = chunk.subarray(start, newline);
+      if (this.lineChunks.length > 0) {
+        this.lineChunks.push(line);
+        line = Buffer.concat(this.lineChunks);
+        this.lineChunks = [];
+      }
+      start = newline + 1;
+
+      if (!this.handshakeDone) {
+        let hello;
+        try {
+          hello = JSON.parse(line.toString('utf8'));
+        } catch (error) {
+          // Not an engine (or a broken build) - fail the start and kill it
+          this.onHandshakeError(new Error(`Invalid handshake from C++ engine: ${line.toString('utf8', 0, 80)}`));
+          this.terminate();
+          return;
+        }
+        this.handshakeDone = true;
+        this.onHandshake(hello);
+        if (this.protocol === 'binary') {
+          // Anything after the handshake line is already binary framing
+          if (start < chunk.length) {
+            this.onBinaryData(chunk.subarray(start));
+          }
+          return;
+        }
+        continue;
+      }
+
+      let message;
+      try {
+        message = JSON.parse(line.toString('utf8'));
+      } catch (error) {
+        this.emit('protocolError', new Error(`Failed to parse C++ output: ${error.message}`));
+        continue;
+      }
+      const { id, error, progress, ...result } = message;
+      if (progress) {
+        this.progress(id, progress);
+        continue;
+      }
+      this.settle(id, error ? new Error(error) : null, result);
+    }
+    if (start < chunk.length) {
+      this.lineChunks.push(chunk.subarray(start));
+    }
+  }
+
+  onBinaryData(chunk) {
+    this.chunks.push(chunk);
+    this.buffered += chunk.length;
+
+    while (this.buffered >= HEADER_BYTES) {
+      const header = this.peek(HEADER_BYTES);
+      const payloadBytes = header.readUInt32LE(12);
+      if (this.buffered < HEADER_BYTES + payloadBytes) {
+        return;
+      }
+      const frame = this.take(HEADER_BYTES + payloadBytes);
+      this.dispatchFrame(frame);
+    }
+  }
+
+  // First n buffered bytes without consuming them
+  peek(n) {
+    if (this.chunks[0].length >= n) {
+      return this.chunks[0];
+    }
+    const merged = Buffer.concat(this.chunks);
+    this.chunks = [merged];
+    return merged;
+  }
+
+  // Consume n bytes - a subarray of the received chunk (no copy) when the frame
+  // arrived in one piece, otherwise a single concatenation
+  take(n) {
+    let frame;
+    if (this.chunks[0].length >= n) {
+      frame = this.chunks[0].subarray(0, n);
+      this.chunks[0] = this.chunks[0].subarray(n);
+      if (this.chunks[0].length === 0) {
+        this.chunks.shift();
+      }
+    } else {
+      const merged = Buffer.concat(this.chunks);
+      frame = merged.subarray(0, n);
+      this.chunks = merged.length > n ? [merged.subarray(n)] : [];
+    }
+    this.buffered -= n;
+    return frame;
+  }
+
+  dispatchFrame(frame) {
+    const magic = frame.readUInt32LE(0);
+    const type = frame.readUInt16LE(4);
+    const id = frame.readUInt32LE(8);
+    if (magic !== FRAME_MAGIC) {
+      this.emit('protocolError', new Error('Corrupt frame from C++ engine'));
+      return;
+    }
+    const payload = HEADER_BYTES;
+    // Responses to traced requests end with the engine's spans
+    const entry = this.pending.get(id);
+    const traceAt = (offset) => (entry && entry.traceId && frame.length > offset
+      ? { trace: decodeTrace(frame, offset, entry.traceId) }
+      : {});
+
+    switch (type) {
+      case FRAME.PRICE_RESULT: {
+        const lower = frame.readDoubleLE(payload + 8);
+        const upper = frame.readDoubleLE(payload + 16);
+        this.settle(id, null, {
+          optionPrice: frame.readDoubleLE(payload),
+          confidence: { lower, upper },
+          threadsUsed: frame.readInt32LE(payload + 24),
+          cpuSeconds: frame.readUInt32LE(payload + 28) / 1e6,
+          ...traceAt(payload + PRICE_RESULT_BYTES)
+        });
+        break;
+      }
+      case FRAME.PRICE_DETAIL_RESULT: {
+        // The price result, then the requested reports as JSON (padded to 8 bytes)
+        const detail = payload + PRICE_RESULT_BYTES;
+        const jsonBytes = frame.readUInt32LE(detail);
+        const text = detail + PRICE_DETAIL_HEADER_BYTES;
+        this.settle(id, null, {
+          optionPrice: frame.readDoubleLE(payload),
+          confidence: { lower: frame.readDoubleLE(payload + 8), upper: frame.readDoubleLE(payload + 16) },
+          threadsUsed: frame.readInt32LE(payload + 24),
+          cpuSeconds: frame.readUInt32LE(payload + 28) / 1e6,
+          ...JSON.parse(frame.toString('utf8', text, text + jsonBytes)),
+          ...traceAt(text + Math.ceil(jsonBytes / 8) * 8)
+        });
+        break;
+      }
+      case FRAME.PROGRESS:
+        this.progress(id, {
+          paths: Number(frame.readBigInt64LE(payload)),
+          totalPaths: Number(frame.readBigInt64LE(payload + 8)),
+          optionPrice: frame.readDoubleLE(payload + 16),
+          confidence: { lower: frame.readDoubleLE(payload + 24), upper: frame.readDoubleLE(payload + 32) }
+        });
+        break;
+      case FRAME.BATCH_RESULT: {
+        const count = frame.readUInt32LE(payload);
+        const columns = payload + BATCH_RESULT_HEADER_BYTES;
+        this.settle(id, null, {
+          count,
+          threadsUsed: frame.readInt32LE(payload + 4),
+          prices: float64View(frame, columns, count),
+          lower: float64View(frame, columns + count * 8, count),
+          upper: float64View(frame, columns + count * 16, count),
+          ...traceAt(columns + count * 24)
+        });
+        break;
+      }
+      case FRAME.PATHS_RESULT: {
+        const count = frame.readUInt32LE(payload);
+        const points = frame.readUInt32LE(payload + 4);
+        const values = count * points;
+        const columns = payload + PATHS_RESULT_HEADER_BYTES;
+        this.settle(id, null, {
+          count,
+          points,
+          times: float32View(frame, columns, values),
+          prices: float32View(frame, columns + values * 4, values),
+          ...traceAt(columns + values * 8)
+        });
+        break;
+      }
+      case FRAME.PONG:
+        this.settle(id, null, {});
+        break;
+      case FRAME.STATS_RESULT: {
+        const latency = { unit: 'us' };
+        REQUEST_CLASSES.forEach((requestClass, c) => {
+          latency[requestClass] = {};
+          LATENCY_STAGES.forEach((stage, i) => {
+            const base = payload + STATS_BYTES + (c * LATENCY_STAGES.length + i) * LATENCY_SUMMARY_BYTES;
+            latency[requestClass][stage] = {
+              count: Number(frame.readBigUInt64LE(base)),
+              p50: frame.readDoubleLE(base + 8),
+              p99: frame.readDoubleLE(base + 16),
+              p999: frame.readDoubleLE(base + 24),
+              max: frame.readDoubleLE(base + 32)
+            };
+          });
+        });
+        this.settle(id, null, {
+          uptimeSeconds: frame.readDoubleLE(payload),
+          cpuSeconds: frame.readDoubleLE(payload + 8),
+          requestsTotal: Number(frame.readBigUInt64LE(payload + 16)),
+          jobsCompleted: Number(frame.readBigUInt64LE(payload + 24)),
+          jobsFailed: Number(frame.readBigUInt64LE(payload + 32)),
+          pathsTotal: Number(frame.readBigUInt64LE(payload + 40)),
+          queueDepth: frame.readUInt32LE(payload + 48),
+          inFlight: frame.readUInt32LE(payload + 52),
+          latency
+        });
+        break;
+      }
+      case FRAME.ERROR:
+        this.settle(id, new Error(frame.toString('utf8', payload)), null);
+        break;
+      default:
+        this.emit('protocolError', new Error(`Unknown frame type ${type} from C++ engine`));
+    }
+  }
+}
+
+module.exports = {
+  EngineConnection,
+  CONTRACT_FIELDS,
+  packContracts,
+  float64View
+};
@@ -0,0 +1,502 @@
+const { EventEmitter } = require('events');
+const { EngineConnection } = require('./engine_connection');
+const { EngineBinaryWatcher } = require('./engine_binary');
+const analyticalBS = require('./black_scholes_analytical');
+
+// Pool defaults (overridable with ENGINE_POOL_* environment variables)
+const DEFAULT_SIZE = Number(process.env.ENGINE_POOL_SIZE) || 2;
+const DEFAULT_MAX_JOBS = process.env.ENGINE_POOL_MAX_JOBS !== undefined ? Number(process.env.ENGINE_POOL_MAX_JOBS) : 10000;
+const HEALTH_CHECK_INTERVAL_MS = 5000;
+const HEALTH_CHECK_TIMEOUT_MS = 2000;
+const MIN_RESTART_DELAY_MS = 100;
+const MAX_RESTART_DELAY_MS = 10000;
+// An engine that lives at least this long resets the restart back-off
+const STABLE_UPTIME_MS = 30000;
+// Hot swap: how long a new build gets to pass its self-check and start its engines
+const UPGRADE_TIMEOUT_MS = 15000;
+// Self-check contract: an at-the-money call whose price must land within
+// SELF_CHECK_MAX_ERRORS standard errors of the closed form
+const SELF_CHECK_CONTRACT = { S0: 100, K: 100, r: 0.05, sigma: 0.2, T: 1, isCall: true, numTrials: 200000 };
+const SELF_CHECK_MAX_ERRORS = 6;
+
+// Counters in the engine's stats that keep growing for the life of a process
+const TOTAL_FIELDS = ['cpuSeconds', 'requestsTotal', 'jobsCompleted', 'jobsFailed', 'pathsTotal'];
+// Lifetime counters of the pool itself
+const POOL_COUNTERS = ['restarts', 'recycles', 'upgrades', 'rollbacks'];
+
+/**
+ * Reject with `message` if `promise` does not settle within `ms`
+ * @param {Promise} promise - Promise to bound
+ * @param {number} ms - Timeout in milliseconds
+ * @param {string} message - Error message on timeout
+ * @returns {Promise<*>} The promise's result
+ */
+function withTimeout(promise, ms, message) {
+  let timer;
+  const timeout = new Promise((_, reject) => {
+    timer = setTimeout(() => reject(new Error(message)), ms);
+  });
+  return Promise.race([promise, timeout]).finally(() => clearTimeout(timer));
+}
+
+/**
+ * Add one engine's stats (or another pool's summary) into a pool summary: counters and
+ * gauges are summed, latency quantiles take the worst
+ * @param {Object} summary - Accumulator from emptySummary()
+ * @param {Object} stats - Engine stats or pool summary
+ */
+function addStats(summary, stats) {
+  summary.queueDepth += stats.queueDepth;
+  summary.inFlight += stats.inFlight;
+  for (const field of TOTAL_FIELDS) {
+    summary[field] += stats[field];
+  }
+  for (const [requestClass, stages] of Object.entries(stats.latency)) {
+    if (requestClass === 'unit') continue;
+    summary.latency[requestClass] = summary.latency[requestClass] || {};
+    for (const [stage, quantiles] of Object.entries(stages)) {
+      const worst = summary.latency[requestClass][stage] || { count: 0, p50: 0, p99: 0, p999: 0, max: 0 };
+      summary.latency[requestClass][stage] = {
+        count: worst.count + quantiles.count,
+        p50: Math.max(worst.p50, quantiles.p50),
+        p99: Math.max(worst.p99, quantiles.p99),
+        p999: Math.max(worst.p999, quantiles.p999),
+        max: Math.max(worst.max, quantiles.max)
+      };
+    }
+  }
+}
+
+/**
+ * Empty pool summary
+ * @returns {Object} { live, pending, queueDepth, inFlight, <totals>, <pool counters>, latency }
+ */
+function emptySummary() {
+  const summary = { live: 0, pending: 0, queueDepth: 0, inFlight: 0, latency: {} };
+  for (const field of [...TOTAL_FIELDS, ...POOL_COUNTERS]) {
+    summary[field] = 0;
+  }
+  return summary;
+}
+
+/**
+ * Pool of pre-started `monte_carlo --serve` processes.
+ * Engines are spawned when the pool starts (and to replace ones that exit), never on the
+ * request path: each request goes to the running engine with the fewest outstanding
+ * requests. Engines are pinged periodically through their reader thread, so a busy engine
+ * still answers; one that does not is killed and replaced. After `maxJobs` requests an
+ * engine is recycled: its replacement is started at once and it exits after draining.
+ *
+ * With `watch`, engines run from content-addressed copies of the binary (see
+ * engine_binary.js) and the binary is polled for changes. A new build must pass a self-check
+ * (handshake, ping and a price against the closed form); then a full set of new engines is
+ * started and swapped in, and the old ones drain and exit. A build that fails is rejected -
+ * the pool keeps the current version - until the file changes again.
+ *
+ * Events: 'spawn' (slot), 'ready' (slot), 'unhealthy' (slot, error), 'exit' (slot, code, reason),
+ * 'upgrade' (hash), 'rollback' (hash, error), 'stderr' (text)
+ */
+class EnginePool extends EventEmitter {
+  /**
+   * @param {Object} options - Pool options
+   * @param {string} options.executablePath - Path to the monte_carlo executable
+   * @param {number} [options.size] - Engine processes (ENGINE_POOL_SIZE, default 2)
+   * @param {number} [options.maxJobs] - Requests before an engine is recycled; 0 = never (ENGINE_POOL_MAX_JOBS, default 10000)
+   * @param {string} [options.protocol='binary'] - 'binary' or 'json'
+   * @param {number} [options.healthCheckIntervalMs=5000] - Ping interval
+   * @param {number} [options.healthCheckTimeoutMs=2000] - Ping deadline before an engine is killed
+   * @param {boolean} [options.watch=false] - Hot swap the engines when the binary changes
+   * @param {string} [options.versionsDir] - Where installed builds are kept (default: .engine-versions next to the binary)
+   * @param {Object} [options.installed] - { hash, path } of an installed build to run (when another thread watches)
+   */
+  constructor({
+    executablePath,
+    size = DEFAULT_SIZE,
+    maxJobs = DEFAULT_MAX_JOBS,
+    protocol = 'binary',
+    healthCheckIntervalMs = HEALTH_CHECK_INTERVAL_MS,
+    healthCheckTimeoutMs = HEALTH_CHECK_TIMEOUT_MS,
+    watch = false,
+    versionsDir,
+    installed
+  }) {
+    super();
+    this.executablePath = installed ? installed.path : executablePath; // What new engines run
+    this.size = Math.max(1, Math.floor(size));
+    this.maxJobs = Math.max(0, Math.floor(maxJobs));
+    this.protocol = protocol;
+    this.healthCheckIntervalMs = healthCheckIntervalMs;
+    this.healthCheckTimeoutMs = healthCheckTimeoutMs;
+
+    this.slots = new Array(this.size).fill(null); // Serving member per slot
+    this.draining = new Set(); // Recycled members finishing their requests
+    this.waiters = []; // Requests waiting for any engine to become ready
+    this.restartDelay = new Array(this.size).fill(MIN_RESTART_DELAY_MS);
+    this.retiredTotals = Object.fromEntries(TOTAL_FIELDS.map((field) => [field, 0]));
+    this.restarts = 0;
+    this.recycles = 0;
+    this.started = null;
+    this.stopped = false;
+    this.healthTimer = null;
+
+    this.watcher = null;
+    if (watch) {
+      this.watcher = new EngineBinaryWatcher({ sourcePath: executablePath, versionsDir, apply: (candidate) => this.upgrade(candidate) });
+      this.watcher.on('upgrade', (hash) => this.emit('upgrade', hash));
+      this.watcher.on('rollback', (hash, error) => this.emit('rollback', hash, error));
+      this.watcher.on('error', (error) => this.emit('stderr', `Engine binary not installed for hot swap: ${error.message}`));
+    }
+  }
+
+  // Hot swaps so far (see EngineBinaryWatcher)
+  get upgrades() {
+    return this.watcher ? this.watcher.upgrades : 0;
+  }
+
+  get rollbacks() {
+    return this.watcher ? this.watcher.rollbacks : 0;
+  }
+
+  /**
+   * Start every engine and the health checks
+   * @returns {Promise<void>} Resolves once all engines completed the handshake
+   */
+  start() {
+    if (!this.started) {
+      if (this.watcher) {
+        const version = this.watcher.install();
+        if (version) {
+          this.executablePath = version.path;
+        }
+        this.watcher.watch();
+      }
+      this.started = Promise.all(this.slots.map((_, slot) => this.spawn(slot).ready)).then(() => undefined);
+      this.healthTimer = setInterval(() => this.checkHealth(), this.healthCheckIntervalMs);
+      this.healthTimer.unref();
+    }
+    return this.started;
+  }
+
+  /**
+   * Price one option on the least-loaded engine (see EngineConnection.price)
+   * @param {Object} params - Black-Scholes parameters, report flags and onProgress
+   * @returns {Promise<Object>} { optionPrice, confidence: { lower, upper }, threadsUsed }
+   */
+  price(params) {
+    return this.run((connection) => connection.price(params));
+  }
+
+  /**
+   * Price many contracts on the least-loaded engine (see EngineConnection.priceBatch)
+   * @param {Array<Object>} contracts - Contracts with S0, K, r, sigma, T, isCall
+   * @param {Object} options - numTrials, threads, precision, traceparent
+   * @returns {Promise<Object>} { count, threadsUsed, prices, lower, upper } with Float64Array columns
+   */
+  priceBatch(contracts, options) {
+    return this.run((connection) => connection.priceBatch(contracts, options));
+  }
+
+  /**
+   * Simulate sample paths on the least-loaded engine (see EngineConnection.samplePaths)
+   * @param {Object} params - S0, r, sigma, T, count, steps, points, seed, traceparent
+   * @returns {Promise<Object>} { count, points, times, prices } with Float32Array columns
+   */
+  samplePaths(params) {
+    return this.run((connection) => connection.samplePaths(params));
+  }
+
+  /**
+   * Engines currently serving or draining
+   * @returns {Array<Object>} Members ({ slot, connection, jobs, outstanding, ... })
+   */
+  members() {
+    return [...this.slots.filter(Boolean), ...this.draining];
+  }
+
+  /**
+   * Summed process counters of every running engine plus those of exited ones, so the
+   * totals stay monotonic across restarts. Latency quantiles are the worst across engines.
+   * The summary is built in one synchronous pass after every reply is in: an engine that
+   * exited while we waited is counted once, through retiredTotals.
+   * @param {number} timeoutMs - Deadline per engine
+   * @returns {Promise<Object>} { live, pending, queueDepth, inFlight, <totals>, restarts,
+   *   recycles, upgrades, rollbacks, latency }
+   */
+  async stats(timeoutMs) {
+    const live = this.members().filter((member) => member.connection.handshakeDone && !member.connection.closed);
+    await Promise.all(live.map(async (member) => {
+      try {
+        member.lastStats = await withTimeout(member.connection.stats(), timeoutMs, 'Engine stats timed out');
+      } catch (error) {
+        // Fall back to the last successful reading
+      }
+    }));
+
+    const running = live.filter((member) => !member.exited);
+    const summary = emptySummary();
+    summary.live = running.length;
+    summary.pending = running.reduce((sum, member) => sum + member.connection.pending.size, 0);
+    for (const field of TOTAL_FIELDS) {
+      summary[field] = this.retiredTotals[field];
+    }
+    for (const field of POOL_COUNTERS) {
+      summary[field] = this[field];
+    }
+    for (const member of running.filter((member) => member.lastStats)) {
+      addStats(summary, member.lastStats);
+    }
+    return summary;
+  }
+
+  /**
+   * Stop health checks and restarts; engines finish accepted requests and exit
+   */
+  stop() {
+    this.stopped = true;
+    clearInterval(this.healthTimer);
+    if (this.watcher) {
+      this.watcher.close();
+    }
+    for (const member of this.members()) {
+      member.connection.close();
+    }
+    for (const waiter of this.waiters.splice(0)) {
+      waiter.reject(new Error('Engine pool stopped'));
+    }
+  }
+
+  // --- internals ---
+
+  // Start an engine for `slot`; it serves from the slot unless `standby` (hot swap candidates)
+  spawn(slot, { executablePath = this.executablePath, standby = false } = {}) {
+    const connection = new EngineConnection({ executablePath, protocol: this.protocol });
+    const member = {
+      slot,
+      connection,
+      executablePath,
+      jobs: 0,
+      outstanding: 0,
+      spawnedAt: Date.now(),
+      exitReason: null,
+      exited: false, // Its last stats are in retiredTotals
+      lastStats: null,
+      ready: null
+    };
+    if (!standby) {
+      this.slots[slot] = member;
+    }
+
+    connection.on('stderr', (text) => this.emit('stderr', text));
+    connection.on('exit', (code) => this.onExit(member, code));
+    member.ready = connection.start().then(() => {
+      if (this.slots[slot] === member) {
+        this.emit('ready', slot);
+        this.wakeWaiters();
+      }
+    });
+    // A spawn failure is also reported through 'exit' and retried there
+    member.ready.catch(() => {});
+    this.emit('spawn', slot);
+    return member;
+  }
+
+  // Ready member with the fewest outstanding requests (ties: fewest jobs, so load spreads)
+  pick() {
+    let best = null;
+    for (const member of this.slots) {
+      if (!member || !member.connection.handshakeDone || member.connection.closed || member.exitReason) continue;
+      if (!best || member.outstanding < best.outstanding ||
+          (member.outstanding === best.outstanding && member.jobs < best.jobs)) {
+        best = member;
+      }
+    }
+    return best;
+  }
+
+  // Least-loaded member, with the request already counted against it
+  acquire() {
+    if (this.stopped) {
+      return Promise.reject(new Error('Engine pool stopped'));
+    }
+    this.start();
+    const member = this.pick();
+    if (member) {
+      member.outstanding++;
+      return Promise.resolve(member);
+    }
+    // Only while the pool is starting or every engine is being replaced
+    return new Promise((resolve, reject) => this.waiters.push({ resolve, reject }));
+  }
+
+  wakeWaiters() {
+    while (this.waiters.length > 0) {
+      const member = this.pick();
+      if (!member) return;
+      member.outstanding++;
+      this.waiters.shift().resolve(member);
+    }
+  }
+
+  // Pricing is idempotent, so a request lost with a dying engine is retried once elsewhere
+  async run(send, retried = false) {
+    const member = await this.acquire();
+    member.jobs++;
+    if (this.maxJobs > 0 && member.jobs >= this.maxJobs && this.slots[member.slot] === member) {
+      this.recycle(member);
+    }
+    try {
+      return await send(member.connection);
+    } catch (error) {
+      if (!member.connection.closed || retried || this.stopped) {
+        throw error;
+      }
+    } finally {
+      member.outstanding--;
+      if (member.outstanding === 0 && this.draining.has(member)) {
+        this.retire(member);
+      }
+    }
+    return this.run(send, true);
+  }
+
+  // Replace the member now and let it exit once its requests are answered
+  recycle(member) {
+    this.recycles++;
+    member.exitReason = 'recycled';
+    this.draining.add(member);
+    this.spawn(member.slot);
+    if (member.outstanding === 0) {
+      this.retire(member);
+    }
+  }
+
+  // Take a final stats reading (so the pool totals keep its work), then let it exit
+  retire(member) {
+    withTimeout(member.connection.stats(), this.healthCheckTimeoutMs, 'Engine stats timed out')
+      .then((stats) => { member.lastStats = stats; }, () => {})
+      .finally(() => member.connection.close());
+  }
+
+  async checkHealth() {
+    await Promise.all(this.slots.map(async (member) => {
+      if (!member || !member.connection.handshakeDone || member.connection.closed) return;
+      try {
+        await withTimeout(member.connection.ping(), this.healthCheckTimeoutMs, 'Engine ping timed out');
+      } catch (error) {
+        if (this.slots[member.slot] !== member || member.connection.closed) return;
+        member.exitReason = 'unhealthy';
+        this.emit('unhealthy', member.slot, error);
+        member.connection.terminate();
+      }
+    }));
+  }
+
+  onExit(member, code) {
+    member.exited = true;
+    if (member.lastStats) {
+      for (const field of TOTAL_FIELDS) {
+        this.retiredTotals[field] += member.lastStats[field];
+      }
+    }
+    this.draining.delete(member);
+    const reason = member.exitReason || (this.stopped ? 'stopped' : 'crashed');
+    this.emit('exit', member.slot, code, reason);
+    if (this.slots[member.slot] !== member) {
+      return; // Recycled - the replacement is already running
+    }
+    this.slots[member.slot] = null;
+    if (this.stopped) {
+      return;
+    }
+
+    // Back off if engines keep dying young, so a broken binary does not spin the CPU
+    const slot = member.slot;
+    if (Date.now() - member.spawnedAt >= STABLE_UPTIME_MS) {
+      this.restartDelay[slot] = MIN_RESTART_DELAY_MS;
+    }
+    const delay = this.restartDelay[slot];
+    this.restartDelay[slot] = Math.min(delay * 2, MAX_RESTART_DELAY_MS);
+    const timer = setTimeout(() => {
+      if (!this.stopped && !this.slots[slot]) {
+        this.restarts++;
+        this.spawn(slot);
+      }
+    }, delay);
+    timer.unref();
+  }
+
+  // --- hot swap ---
+
+  /**
+   * Hot swap to an installed build: self-check it, start a full set of its engines, then
+   * swap them in and let the old engines drain
+   * @param {Object} candidate - { hash, path } of the installed build
+   * @returns {Promise<void>} Rejects (leaving the pool as it was) if the build is unfit
+   */
+  async upgrade(candidate) {
+    await withTimeout(this.selfCheck(candidate.path), UPGRADE_TIMEOUT_MS, 'Self-check timed out');
+
+    const fresh = this.slots.map((_, slot) => this.spawn(slot, { executablePath: candidate.path, standby: true }));
+    try {
+      await withTimeout(Promise.all(fresh.map((member) => member.ready)), UPGRADE_TIMEOUT_MS, 'Engines did not start');
+    } catch (error) {
+      fresh.forEach((member) => member.connection.terminate());
+      throw error;
+    }
+    if (this.stopped) {
+      fresh.forEach((member) => member.connection.close());
+      return;
+    }
+
+    const previous = this.executablePath;
+    this.executablePath = candidate.path;
+    for (const member of fresh) {
+      const old = this.slots[member.slot];
+      this.slots[member.slot] = member;
+      this.restartDelay[member.slot] = MIN_RESTART_DELAY_MS;
+      this.emit('ready', member.slot);
+      if (old) {
+        old.exitReason = 'upgraded';
+        this.draining.add(old);
+        if (old.outstanding === 0) {
+          this.retire(old);
+        }
+      }
+    }
+    this.wakeWaiters();
+    if (this.watcher) {
+      this.watcher.prune([candidate.path, previous]);
+    }
+  }
+
+  /**
+   * Start the build on its own, round-trip a ping and price a contract with a known answer
+   * @param {string} executablePath - Installed binary
+   * @returns {Promise<void>} Rejects with the reason the build is unfit
+   */
+  async selfCheck(executablePath) {
+    const connection = new EngineConnection({ executablePath, protocol: this.protocol });
+    connection.on('stderr', (text) => this.emit('stderr', text));
+    try {
+      await connection.start();
+      await connection.ping();
+      const result = await connection.price(SELF_CHECK_CONTRACT);
+      const { analyticalPrice } = analyticalBS.calculateAnalyticalPrice(SELF_CHECK_CONTRACT);
+      const standardError = (result.confidence.upper - result.confidence.lower) / (2 * 1.96);
+      if (!Number.isFinite(result.optionPrice) || !(standardError > 0) ||
+          Math.abs(result.optionPrice - analyticalPrice) > SELF_CHECK_MAX_ERRORS * standardError) {
+        throw new Error(`Self-check price ${result.optionPrice} does not match the analytical ${analyticalPrice}`);
+      }
+      await connection.stats();
+    } finally {
+      connection.terminate();
+    }
+  }
+}
+
+module.exports = {
+  EnginePool,
+  addStats,
+  emptySummary,
+  withTimeout
+};
@@ -0,0 +1,81 @@
+const { parentPort, workerData } = require('worker_threads');
+const { EnginePool } = require('./engine_pool');
+
+/**
+ * Worker thread hosting an EnginePool (see engine_worker_pool.js).
+ * Engine pipe I/O, frame encoding/decoding, health checks and engine swaps all run here,
+ * off the Express event loop. Batch contracts arrive, and result columns and sample paths
+ * leave, in SharedArrayBuffers: the worker copies decoded results into them once, and the
+ * main thread reads them in place without a copy.
+ *
+ * Messages in:  { id, type: 'start' | 'price' | 'batch' | 'paths' | 'stats' | 'upgrade' | 'stop', ... }
+ * Messages out: { id, result } or { id, error }, { id, progress } while a price request with
+ *   `progress` set runs, and { type: 'event', name, args }
+ */
+
+const pool = new EnginePool(workerData.pool);
+
+for (const name of ['exit', 'unhealthy']) {
+  pool.on(name, (...args) => {
+    parentPort.postMessage({ type: 'event', name, args: args.map((arg) => (arg instanceof Error ? arg.message : arg)) });
+  });
+}
+pool.on('stderr', (text) => parentPort.postMessage({ type: 'event', name: 'stderr', args: [text] }));
+
+/**
+ * Copy the batch result columns into one SharedArrayBuffer (prices, lower, upper)
+ * @param {Object} result - EngineConnection.priceBatch result
+ * @returns {Object} Result with `columns` in place of the three Float64Arrays
+ */
+function shareColumns(result) {
+  const { count, prices, lower, upper, ...rest } = result;
+  const columns = new Float64Array(new SharedArrayBuffer(count * 3 * 8));
+  columns.set(prices, 0);
+  columns.set(lower, count);
+  columns.set(upper, 2 * count);
+  return { ...rest, count, columns: columns.buffer };
+}
+
+/**
+ * Copy the sample path columns into one SharedArrayBuffer (times, then prices)
+ * @param {Object} result - EngineConnection.samplePaths result
+ * @returns {Object} Result with `columns` in place of the two Float32Arrays
+ */
+function sharePaths(result) {
+  const { times, prices, ...rest } = result;
+  const columns = new Float32Array(new SharedArrayBuffer(times.length * 2 * 4));
+  columns.set(times, 0);
+  columns.set(prices, times.length);
+  return { ...rest, columns: columns.buffer };
+}
+
+async function handle(message) {
+  switch (message.type) {
+    case 'start':
+      return pool.start();
+    case 'price': {
+      const { progress, ...params } = message.params;
+      const onProgress = progress ? (report) => parentPort.postMessage({ id: message.id, progress: report }) : undefined;
+      return pool.price({ ...params, onProgress });
+    }
+    case 'batch':
+      return shareColumns(await pool.priceBatch(new Float64Array(message.contracts), message.options));
+    case 'paths':
+      return sharePaths(await pool.samplePaths(message.params));
+    case 'stats':
+      return pool.stats(message.timeoutMs);
+    case 'upgrade':
+      return pool.upgrade(message.candidate);
+    case 'stop':
+      return pool.stop();
+    default:
+      throw new Error(`Unknown engine worker request ${message.type}`);
+  }
+}
+
+parentPort.on('message', (message) => {
+  handle(message).then(
+    (result) => parentPort.postMessage({ id: message.id, result }),
+    (error) => parentPort.postMessage({ id: message.id, error: error.message })
+  );
+});
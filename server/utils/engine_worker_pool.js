@@ -0,0 +1,342 @@
+const { EventEmitter } = require('events');
+const path = require('path');
+const { Worker } = require('worker_threads');
+const { EngineBinaryWatcher } = require('./engine_binary');
+const { packContracts } = require('./engine_connection');
+const { addStats, emptySummary, withTimeout } = require('./engine_pool');
+
+const DEFAULT_WORKERS = process.env.ENGINE_WORKERS !== undefined ? Number(process.env.ENGINE_WORKERS) : 2;
+const DEFAULT_ENGINES = Number(process.env.ENGINE_POOL_SIZE) || 2;
+const MIN_RESTART_DELAY_MS = 100;
+const MAX_RESTART_DELAY_MS = 10000;
+
+/**
+ * Pool of worker threads, each hosting an EnginePool, with the EnginePool interface.
+ * The main event loop only routes: requests go to the worker with the fewest outstanding
+ * requests, batch contracts are packed into a SharedArrayBuffer and results come back as
+ * Float64Array views over the worker's SharedArrayBuffer. A worker that dies is restarted
+ * (its engines exit with it, since their stdin closes) and its lost requests are retried once.
+ * Requests that find no worker running (at start-up, or while the only worker restarts) wait
+ * for one to come online, as in EnginePool.
+ *
+ * With `poolOptions.watch` the main thread installs and watches the binary (so the workers
+ * never write the same file) and rolls a new build out to one worker first; the others
+ * follow only if its self-check and swap succeed.
+ *
+ * Events: 'upgrade' (hash), 'rollback' (hash, error), and 'exit', 'unhealthy', 'stderr' forwarded from the workers
+ */
+class EngineWorkerPool extends EventEmitter {
+  /**
+   * @param {Object} options - Pool options
+   * @param {string} options.executablePath - Path to the monte_carlo executable
+   * @param {number} [options.workers] - Worker threads (ENGINE_WORKERS, default 2)
+   * @param {number} [options.size] - Engine processes in total, split across workers (ENGINE_POOL_SIZE, default 2)
+   * @param {Object} [options.poolOptions] - Further EnginePool options (maxJobs, watch, ...)
+   */
+  constructor({ executablePath, workers = DEFAULT_WORKERS, size = DEFAULT_ENGINES, poolOptions = {} }) {
+    super();
+    this.workerCount = Math.max(1, Math.floor(workers));
+    this.size = Math.max(this.workerCount, Math.floor(size));
+    const { watch = false, versionsDir, ...engineOptions } = poolOptions;
+    this.poolOptions = { ...engineOptions, executablePath };
+    this.workers = new Array(this.workerCount).fill(null);
+    this.waiters = []; // Requests waiting for any worker to come online
+    this.restartDelay = new Array(this.workerCount).fill(MIN_RESTART_DELAY_MS);
+    this.nextId = 1;
+    this.started = null;
+    this.stopped = false;
+    this.workerRestarts = 0;
+    this.retired = emptySummary(); // Totals of workers that exited
+
+    this.watcher = null;
+    if (watch) {
+      this.watcher = new EngineBinaryWatcher({ sourcePath: executablePath, versionsDir, apply: (candidate) => this.rollOut(candidate) });
+      this.watcher.on('upgrade', (hash) => this.emit('upgrade', hash));
+      this.watcher.on('rollback', (hash, error) => this.emit('rollback', hash, error));
+      this.watcher.on('error', (error) => this.emit('stderr', `Engine binary not installed for hot swap: ${error.message}`));
+    }
+  }
+
+  /**
+   * Start the workers and their engines
+   * @returns {Promise<void>} Resolves once every worker's engines are ready
+   */
+  start() {
+    if (!this.started) {
+      if (this.watcher) {
+        this.watcher.install();
+        this.watcher.watch();
+      }
+      this.started = Promise.all(this.workers.map((_, index) => this.spawn(index).ready)).then(() => undefined);
+    }
+    return this.started;
+  }
+
+  /**
+   * Price one option (see EnginePool.price)
+   * @param {Object} params - Black-Scholes parameters, report flags and onProgress
+   * @returns {Promise<Object>} { optionPrice, confidence: { lower, upper }, threadsUsed }
+   */
+  price(params) {
+    // The callback stays on this thread; the worker posts the reports back
+    const { onProgress, ...rest } = params;
+    return this.run({ type: 'price', params: { ...rest, progress: Boolean(onProgress) } }, onProgress);
+  }
+
+  /**
+   * Price many contracts (see EnginePool.priceBatch)
+   * @param {Array<Object>|Float64Array} contracts - Contracts, or packContracts(contracts, true) output
+   * @param {Object} options - numTrials, threads, precision, traceparent
+   * @returns {Promise<Object>} { count, threadsUsed, prices, lower, upper } with Float64Array
+   *   columns over shared memory
+   */
+  async priceBatch(contracts, options) {
+    let packed = contracts;
+    if (!(contracts instanceof Float64Array)) {
+      packed = packContracts(contracts, true);
+    } else if (!(contracts.buffer instanceof SharedArrayBuffer)) {
+      packed = new Float64Array(new SharedArrayBuffer(contracts.length * 8));
+      packed.set(contracts);
+    }
+    const { columns, count, ...rest } = await this.run({ type: 'batch', contracts: packed.buffer, options });
+    return {
+      ...rest,
+      count,
+      prices: new Float64Array(columns, 0, count),
+      lower: new Float64Array(columns, count * 8, count),
+      upper: new Float64Array(columns, count * 16, count)
+    };
+  }
+
+  /**
+   * Simulate sample paths (see EnginePool.samplePaths)
+   * @param {Object} params - S0, r, sigma, T, count, steps, points, seed, traceparent
+   * @returns {Promise<Object>} { count, points, times, prices } with Float32Array columns over shared memory
+   */
+  async samplePaths(params) {
+    const { columns, count, points, ...rest } = await this.run({ type: 'paths', params });
+    const values = count * points;
+    return {
+      ...rest,
+      count,
+      points,
+      times: new Float32Array(columns, 0, values),
+      prices: new Float32Array(columns, values * 4, values)
+    };
+  }
+
+  /**
+   * Pool summary merged over the workers (see EnginePool.stats)
+   * @param {number} timeoutMs - Deadline per engine
+   * @returns {Promise<Object>} Summary; `restarts` includes worker thread restarts
+   */
+  async stats(timeoutMs) {
+    const summary = emptySummary();
+    addStats(summary, this.retired);
+    const live = this.workers.filter((worker) => worker && worker.online);
+    const results = await Promise.all(live.map((worker) => {
+      const request = this.send(worker, { type: 'stats', timeoutMs }).then((stats) => {
+        worker.lastStats = stats;
+        return stats;
+      });
+      return withTimeout(request, timeoutMs * 2, 'Engine worker stats timed out').catch(() => worker.lastStats);
+    }));
+    for (const stats of [this.retired, ...results.filter(Boolean)]) {
+      summary.restarts += stats.restarts;
+      summary.recycles += stats.recycles;
+      summary.upgrades += stats.upgrades;
+      summary.rollbacks += stats.rollbacks;
+    }
+    for (const stats of results.filter(Boolean)) {
+      addStats(summary, stats);
+      summary.live += stats.live;
+      summary.pending += stats.pending;
+    }
+    summary.restarts += this.workerRestarts;
+    if (this.watcher) {
+      summary.upgrades += this.watcher.upgrades;
+      summary.rollbacks += this.watcher.rollbacks;
+    }
+    return summary;
+  }
+
+  /**
+   * Stop the engines and the workers
+   */
+  stop() {
+    this.stopped = true;
+    if (this.watcher) {
+      this.watcher.close();
+    }
+    for (const waiter of this.waiters.splice(0)) {
+      waiter.reject(new Error('Engine pool stopped'));
+    }
+    for (const worker of this.workers.filter(Boolean)) {
+      this.send(worker, { type: 'stop' })
+        .catch(() => {})
+        .finally(() => worker.thread.terminate());
+    }
+  }
+
+  // --- internals ---
+
+  spawn(index) {
+    const engines = Math.floor(this.size / this.workerCount) + (index < this.size % this.workerCount ? 1 : 0);
+    const installed = this.watcher ? this.watcher.version : null;
+    const thread = new Worker(path.join(__dirname, 'engine_worker.js'), {
+      workerData: { pool: { ...this.poolOptions, size: engines, ...(installed ? { installed } : {}) } }
+    });
+    const worker = { index, thread, pending: new Map(), reserved: 0, online: false, spawnedAt: Date.now(), lastStats: null };
+    this.workers[index] = worker;
+
+    thread.on('message', (message) => this.onMessage(worker, message));
+    thread.on('error', (error) => this.emit('stderr', `Engine worker ${index} failed: ${error.message}`));
+    thread.on('exit', (code) => this.onExit(worker, code));
+    // Online once its pool has started, even if an engine failed (the pool restarts it)
+    worker.ready = this.send(worker, { type: 'start' }).finally(() => {
+      worker.online = !worker.exited;
+      this.wakeWaiters();
+    });
+    return worker;
+  }
+
+  // Hot swap the workers to a new build, one canary first
+  async rollOut(candidate) {
+    const [canary, ...rest] = this.workers.filter((worker) => worker && worker.online);
+    if (!canary) {
+      throw new Error('No engine worker is running');
+    }
+    const previous = this.watcher.version;
+    await this.send(canary, { type: 'upgrade', candidate });
+    await Promise.all(rest.map((worker) => this.send(worker, { type: 'upgrade', candidate }).catch((error) => {
+      this.emit('stderr', `Engine worker ${worker.index} kept the previous build: ${error.message}`);
+    })));
+    this.watcher.prune([candidate.path, previous && previous.path]);
+  }
+
+  send(worker, message, onProgress) {
+    const id = this.nextId++;
+    return new Promise((resolve, reject) => {
+      worker.pending.set(id, { resolve, reject, onProgress });
+      worker.thread.postMessage({ ...message, id });
+    });
+  }
+
+  // Least-loaded started worker, counting requests it was handed but has not been sent yet
+  pick() {
+    let best = null;
+    const load = (worker) => worker.pending.size + worker.reserved;
+    for (const worker of this.workers) {
+      if (worker && worker.online && (!best || load(worker) < load(best))) {
+        best = worker;
+      }
+    }
+    return best;
+  }
+
+  // A started worker, reserved for one request (the caller sends it and releases the reservation)
+  acquire() {
+    if (this.stopped) {
+      return Promise.reject(new Error('Engine pool stopped'));
+    }
+    const worker = this.pick();
+    if (worker) {
+      worker.reserved++;
+      return Promise.resolve(worker);
+    }
+    // Only while the workers are starting or being restarted
+    return new Promise((resolve, reject) => this.waiters.push({ resolve, reject }));
+  }
+
+  wakeWaiters() {
+    while (this.waiters.length > 0) {
+      const worker = this.pick();
+      if (!worker) return;
+      worker.reserved++;
+      this.waiters.shift().resolve(worker);
+    }
+  }
+
+  async run(message, onProgress, retried = false) {
+    if (this.stopped) {
+      throw new Error('Engine pool stopped');
+    }
+    // Failures to start are reported by start(); requests wait for the workers that do start
+    this.start().catch(() => {});
+    const worker = await this.acquire();
+    worker.reserved--;
+    if (worker.exited) {
+      return this.run(message, onProgress, retried);
+    }
+    try {
+      return await this.send(worker, message, onProgress);
+    } catch (error) {
+      // Requests lost with a dead worker are retried once; pricing errors are not
+      if (!error.workerExited || retried) {
+        throw error;
+      }
+    }
+    return this.run(message, onProgress, true);
+  }
+
+  onMessage(worker, message) {
+    if (message.type === 'event') {
+      this.emit(message.name, ...message.args);
+      return;
+    }
+    const entry = worker.pending.get(message.id);
+    if (!entry) {
+      return;
+    }
+    if (message.progress) {
+      if (entry.onProgress) {
+        entry.onProgress(message.progress);
+      }
+      return;
+    }
+    worker.pending.delete(message.id);
+    if (message.error !== undefined) {
+      entry.reject(new Error(message.error));
+    } else {
+      entry.resolve(message.result);
+    }
+  }
+
+  onExit(worker, code) {
+    worker.online = false;
+    worker.exited = true;
+    if (worker.lastStats) {
+      // Keep its counters (not its gauges or latency) so the totals stay monotonic
+      addStats(this.retired, { ...worker.lastStats, queueDepth: 0, inFlight: 0, latency: {} });
+      for (const field of ['restarts', 'recycles', 'upgrades', 'rollbacks']) {
+        this.retired[field] += worker.lastStats[field];
+      }
+    }
+    const error = new Error(`Engine worker exited with code ${code}`);
+    error.workerExited = true;
+    for (const [, entry] of worker.pending) {
+      entry.reject(error);
+    }
+    worker.pending.clear();
+    if (this.stopped || this.workers[worker.index] !== worker) {
+      return;
+    }
+
+    this.emit('stderr', `Engine worker ${worker.index} exited with code ${code}; restarting`);
+    const index = worker.index;
+    const delay = Date.now() - worker.spawnedAt > 30000 ? MIN_RESTART_DELAY_MS : this.restartDelay[index];
+    this.restartDelay[index] = Math.min(delay * 2, MAX_RESTART_DELAY_MS);
+    const timer = setTimeout(() => {
+      if (!this.stopped) {
+        this.workerRestarts++;
+        this.spawn(index).ready.catch(() => {});
+      }
+    }, delay);
+    timer.unref();
+  }
+}
+
+module.exports = {
+  EngineWorkerPool,
+  DEFAULT_WORKERS
+};
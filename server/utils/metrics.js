@@ -0,0 +1,276 @@
+/**
+ * Minimal Prometheus metrics registry (text exposition format 0.0.4).
+ * Counters, gauges and histograms with labels; histograms use HDR-style log-linear
+ * buckets so latency quantiles stay accurate from sub-millisecond to minutes.
+ */
+
+/**
+ * Log-linear bucket boundaries: every power of two between min and max is split into
+ * subBuckets equal steps, bounding the relative error of any quantile to ~1/subBuckets
+ * @param {number} min - Smallest boundary
+ * @param {number} max - Largest boundary
+ * @param {number} [subBuckets=4] - Steps per doubling
+ * @returns {number[]} Ascending boundaries
+ */
+function logLinearBuckets(min, max, subBuckets = 4) {
+  const buckets = [];
+  for (let base = min; base < max; base *= 2) {
+    for (let i = 0; i < subBuckets; i++) {
+      buckets.push(Number((base * (1 + i / subBuckets)).toPrecision(6)));
+    }
+  }
+  buckets.push(max);
+  return buckets;
+}
+
+function escapeLabel(value) {
+  return String(value).replace(/\\/g, '\\\\').replace(/\n/g, '\\n').replace(/"/g, '\\"');
+}
+
+function formatLabels(labelNames, values, extra = '') {
+  const parts = labelNames.map((name, i) => `${name}="${escapeLabel(values[i])}"`);
+  if (extra) parts.push(extra);
+  return parts.length > 0 ? `{${parts.join(',')}}` : '';
+}
+
+function formatValue(value) {
+  if (value === Infinity) return '+Inf';
+  if (value === -Infinity) return '-Inf';
+  return Number.isNaN(value) ? 'NaN' : String(value);
+}
+
+class Metric {
+  constructor(type, name, help, labelNames = []) {
+    this.type = type;
+    this.name = name;
+    this.help = help;
+    this.labelNames = labelNames;
+    this.series = new Map();
+  }
+
+  key(labels = {}) {
+    return JSON.stringify(this.labelNames.map((name) => (labels[name] === undefined ? '' : String(labels[name]))));
+  }
+
+  header() {
+    return `# HELP ${this.name} ${this.help}\n# TYPE ${this.name} ${this.type}\n`;
+  }
+}
+
+class Counter extends Metric {
+  constructor(name, help, labelNames) {
+    super('counter', name, help, labelNames);
+  }
+
+  /**
+   * @param {Object} [labels] - Label values
+   * @param {number} [amount=1] - Non-negative increment
+   */
+  inc(labels = {}, amount = 1) {
+    const key = this.key(labels);
+    this.series.set(key, (this.series.get(key) || 0) + amount);
+  }
+
+  /**
+   * Mirror a total maintained elsewhere (e.g. the engine's own counters)
+   * @param {Object} labels - Label values
+   * @param {number} total - Current total
+   */
+  setTotal(labels, total) {
+    this.series.set(this.key(labels), total);
+  }
+
+  render() {
+    let text = this.header();
+    for (const [key, value] of this.series) {
+      text += `${this.name}${formatLabels(this.labelNames, JSON.parse(key))} ${formatValue(value)}\n`;
+    }
+    return text;
+  }
+}
+
+class Gauge extends Metric {
+  constructor(name, help, labelNames) {
+    super('gauge', name, help, labelNames);
+  }
+
+  set(labels, value) {
+    this.series.set(this.key(labels), value);
+  }
+
+  inc(labels = {}, amount = 1) {
+    const key = this.key(labels);
+    this.series.set(key, (this.series.get(key) || 0) + amount);
+  }
+
+  dec(labels = {}, amount = 1) {
+    this.inc(labels, -amount);
+  }
+
+  render() {
+    let text = this.header();
+    for (const [key, value] of this.series) {
+      text += `${this.name}${formatLabels(this.labelNames, JSON.parse(key))} ${formatValue(value)}\n`;
+    }
+    return text;
+  }
+}
+
+class Histogram extends Metric {
+  constructor(name, help, labelNames, buckets) {
+    super('histogram', name, help, labelNames);
+    this.buckets = buckets;
+  }
+
+  /**
+   * @param {Object} labels - Label values
+   * @param {number} value - Observation
+   */
+  observe(labels, value) {
+    const key = this.key(labels);
+    let series = this.series.get(key);
+    if (!series) {
+      series = { counts: new Float64Array(this.buckets.length), sum: 0, count: 0 };
+      this.series.set(key, series);
+    }
+    // Binary search for the first boundary >= value (non-cumulative counts)
+    let lo = 0;
+    let hi = this.buckets.length;
+    while (lo < hi) {
+      const mid = (lo + hi) >> 1;
+      if (this.buckets[mid] < value) lo = mid + 1;
+      else hi = mid;
+    }
+    if (lo < this.buckets.length) series.counts[lo]++;
+    series.sum += value;
+    series.count++;
+  }
+
+  render() {
+    let text = this.header();
+    for (const [key, series] of this.series) {
+      const values = JSON.parse(key);
+      let cumulative = 0;
+      this.buckets.forEach((bound, i) => {
+        cumulative += series.counts[i];
+        text += `${this.name}_bucket${formatLabels(this.labelNames, values, `le="${bound}"`)} ${cumulative}\n`;
+      });
+      text += `${this.name}_bucket${formatLabels(this.labelNames, values, 'le="+Inf"')} ${series.count}\n`;
+      text += `${this.name}_sum${formatLabels(this.labelNames, values)} ${series.sum}\n`;
+      text += `${this.name}_count${formatLabels(this.labelNames, values)} ${series.count}\n`;
+    }
+    return text;
+  }
+}
+
+class Registry {
+  constructor() {
+    this.metrics = new Map();
+    this.collectors = [];
+    this.contentType = 'text/plain; version=0.0.4; charset=utf-8';
+  }
+
+  register(metric) {
+    if (this.metrics.has(metric.name)) {
+      throw new Error(`Metric ${metric.name} is already registered`);
+    }
+    this.metrics.set(metric.name, metric);
+    return metric;
+  }
+
+  counter(name, help, labelNames) {
+    return this.register(new Counter(name, help, labelNames));
+  }
+
+  gauge(name, help, labelNames) {
+    return this.register(new Gauge(name, help, labelNames));
+  }
+
+  histogram(name, help, labelNames, buckets) {
+    return this.register(new Histogram(name, help, labelNames, buckets));
+  }
+
+  /**
+   * Run fn before every scrape (refreshes gauges that mirror external state)
+   * @param {Function} fn - Possibly async collector
+   */
+  onCollect(fn) {
+    this.collectors.push(fn);
+  }
+
+  /**
+   * Render every metric after running the collectors
+   * @returns {Promise<string>} Exposition text
+   */
+  async render() {
+    await Promise.all(this.collectors.map((fn) => Promise.resolve().then(fn).catch((error) => {
+      console.error('Metrics collector failed:', error.message);
+    })));
+    let text = '';
+    for (const metric of this.metrics.values()) {
+      text += metric.render();
+    }
+    return text;
+  }
+}
+
+// Shared registry and the service's metrics
+const registry = new Registry();
+
+// 100 microseconds .. ~2 minutes
+const LATENCY_BUCKETS = logLinearBuckets(0.0001, 131.072, 4);
+
+const metrics = {
+  httpRequests: registry.counter('http_requests_total', 'HTTP requests by route, method and status', ['route', 'method', 'status']),
+  httpDuration: registry.histogram('http_request_duration_seconds', 'HTTP request latency', ['route', 'method'], LATENCY_BUCKETS),
+  httpInFlight: registry.gauge('http_requests_in_flight', 'HTTP requests being served', []),
+  pricingPaths: registry.counter('pricing_paths_total', 'Monte Carlo paths simulated (rate() gives paths/sec)', ['mode']),
+  pricingCpuSeconds: registry.histogram('pricing_cpu_seconds', 'Engine CPU seconds per pricing request, over all its threads', [], logLinearBuckets(0.0001, 131.072, 2)),
+  engineRestarts: registry.counter('engine_process_restarts_total', 'Engine pool processes restarted after exiting or failing a health check', []),
+  engineRecycles: registry.counter('engine_process_recycles_total', 'Engine pool processes replaced after their job limit', []),
+  engineUpgrades: registry.counter('engine_upgrades_total', 'Engine binary hot swaps by outcome (rolled_back = new build failed its self-check)', ['outcome']),
+  engineUp: registry.gauge('engine_up', 'Engine pool processes running (including ones draining before recycling)', []),
+  engineQueueDepth: registry.gauge('engine_queue_depth', 'Jobs waiting in the persistent engine', []),
+  engineInFlight: registry.gauge('engine_jobs_in_flight', 'Jobs executing in the persistent engine', []),
+  enginePending: registry.gauge('engine_pending_requests', 'Requests sent to the persistent engine and not yet answered', []),
+  engineJobs: registry.counter('engine_jobs_total', 'Jobs finished by the persistent engine', ['outcome']),
+  enginePaths: registry.counter('engine_paths_total', 'Paths simulated by the persistent engine', []),
+  engineCpuSeconds: registry.counter('engine_cpu_seconds_total', 'CPU seconds used by the persistent engine process', []),
+  engineRequests: registry.counter('engine_requests_total', 'Requests received by the persistent engine', []),
+  engineLatency: registry.gauge('engine_request_latency_seconds',
+    'Persistent engine latency quantiles since start-up, worst across the pool (HDR histograms in the engine)', ['class', 'stage', 'quantile'])
+};
+
+/**
+ * Express middleware recording request count, latency and in-flight requests.
+ * The route label is the matched route pattern, so path parameters do not create series.
+ * A request ends on 'finish' (response sent) or on 'close' without it (client went away,
+ * e.g. a closed event stream), which is counted with status "aborted". Either way it is
+ * recorded exactly once.
+ */
+function httpMetricsMiddleware(req, res, next) {
+  const start = process.hrtime.bigint();
+  metrics.httpInFlight.inc();
+  let recorded = false;
+  const record = () => {
+    if (recorded) return;
+    recorded = true;
+    metrics.httpInFlight.dec();
+    const route = req.route ? `${req.baseUrl || ''}${req.route.path}` : 'unmatched';
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    const status = res.writableFinished ? res.statusCode : 'aborted';
+    metrics.httpRequests.inc({ route, method: req.method, status });
+    metrics.httpDuration.observe({ route, method: req.method }, seconds);
+  };
+  res.on('finish', record);
+  res.on('close', record);
+  next();
+}
+
+module.exports = {
+  Registry,
+  logLinearBuckets,
+  registry,
+  metrics,
+  httpMetricsMiddleware
+};
@@ -1,10 +1,14 @@
 const { spawn } = require('child_process');
 const path = require('path');
 const fs = require('fs');
+const tracing = require('./tracing');
 
 // Path to the C++ executable
 const executablePath = path.join(__dirname, '..', 'cpp', 'monte_carlo');
 
+// How often a run with onProgress reports its running estimate
+const PROGRESS_INTERVAL_MS = 100;
+
 /**
  * Check if the C++ executable exists
  * @returns {boolean} True if the executable exists, false otherwise
@@ -17,6 +21,91 @@ function isExecutableAvailable() {
   }
 }
 
+/**
+ * Hand the complete {"progress": ...} lines at the start of `text` to onProgress
+ * @param {string} text - Engine output not yet consumed
+ * @param {Function} onProgress - Receives each progress object
+ * @returns {string} The rest of the output
+ */
+function takeProgressLines(text, onProgress) {
+  let end;
+  while (text.startsWith('{"progress"') && (end = text.indexOf('\n')) !== -1) {
+    onProgress(JSON.parse(text.slice(0, end)).progress);
+    text = text.slice(end + 1);
+  }
+  return text;
+}
+
+/**
+ * Spawn the C++ executable and parse its JSON output.
+ * Traced as a client span; when the trace is recorded the engine gets it via --trace
+ * and its own spans are exported under this one.
+ * @param {string[]} args - Command-line arguments
+ * @param {Object} [options] - Run options
+ * @param {Function} [options.onProgress] - Receives the engine's progress lines (run with --progress)
+ * @param {AbortSignal} [options.signal] - Kills the engine when aborted
+ * @returns {Promise<Object>} Parsed JSON result
+ */
+function runExecutable(args, { onProgress, signal } = {}) {
+  const attributes = { 'process.executable.name': 'monte_carlo', 'engine.mode': Number(args[7]) };
+  return tracing.withSpan('engine.exec', { kind: tracing.SPAN_KIND.CLIENT, attributes }, (span) => new Promise((resolve, reject) => {
+    const traceparent = tracing.engineTraceparent();
+
+    // Spawn the C++ process
+    const process = spawn(executablePath, traceparent ? [...args, `--trace=${traceparent}`] : args, { signal });
+    process.on('spawn', () => span.addEvent('spawned'));
+    
+    let stdoutData = '';
+    let stderrData = '';
+
+    // Collect stdout data (progress lines are passed on as they arrive)
+    process.stdout.on('data', (data) => {
+      stdoutData += data.toString();
+      if (onProgress) {
+        stdoutData = takeProgressLines(stdoutData, onProgress);
+      }
+    });
+
+    // Collect stderr data
+    process.stderr.on('data', (data) => {
+      stderrData += data.toString();
+    });
+
+    // Handle process completion
+    process.on('close', (code) => {
+      if (code !== 0) {
+        reject(new Error(`C++ process exited with code ${code}: ${stderrData}`));
+        return;
+      }
+
+      try {
+        // Parse the JSON output from the C++ executable
+        const result = JSON.parse(stdoutData);
+        if (result.error) {
+          reject(new Error('Error in C++ calculation'));
+        } else {
+          if (result.trace) {
+            tracing.importEngineSpans(result.trace);
+            delete result.trace;
+          }
+          resolve(result);
+        }
+      } catch (error) {
+        reject(new Error(`Failed to parse C++ output: ${error.message}`));
+      }
+    });
+
+    // Handle process errors
+    process.on('error', (error) => {
+      if (error.name === 'AbortError') {
+        reject(new Error('C++ process cancelled'));
+        return;
+      }
+      reject(new Error(`Failed to start C++ process: ${error.message}`));
+    });
+  }));
+}
+
 /**
  * Calculate option price using Monte Carlo simulation with C++ implementation
  * @param {Object} params - Black-Scholes parameters
@@ -28,9 +117,17 @@ function isExecutableAvailable() {
  * @param {boolean} params.isCall - True for call option, false for put option
  * @param {number} params.numTrials - Number of Monte Carlo trials
  * @param {number} [params.threads] - Number of threads to use (optional)
+ * @param {string} [params.precision] - 'double' (default) or 'single' for the float32 kernels
+ * @param {boolean} [params.timing] - Add a per-phase timing breakdown (runs the split double kernel)
+ * @param {boolean} [params.convergence] - Add the estimate after 1k, 2k, 4k, ... paths of the same run
+ * @param {boolean} [params.distribution] - Add terminal-price and payoff histograms and quantiles
+ * @param {Object} [options] - Run options
+ * @param {Function} [options.onProgress] - Receives { paths, totalPaths, optionPrice, confidence }
+ *   about every PROGRESS_INTERVAL_MS while the engine runs
+ * @param {AbortSignal} [options.signal] - Stops the run (the engine process is killed)
  * @returns {Promise<Object>} Option price and confidence interval
  */
-function monteCarloBlackScholes(params) {
+function monteCarloBlackScholes(params, { onProgress, signal } = {}) {
   return new Promise((resolve, reject) => {
     // Validate that the executable exists
     if (!isExecutableAvailable()) {
@@ -39,7 +136,7 @@ function monteCarloBlackScholes(params) {
     }
 
     // Validate inputs
-    const { S0, K, r, sigma, T, isCall, numTrials, threads } = params;
+    const { S0, K, r, sigma, T, isCall, numTrials, threads, precision, timing, convergence, distribution } = params;
     if (!S0 || !K || r === undefined || !sigma || !T || numTrials === undefined) {
       reject(new Error('Missing required parameters'));
       return;
@@ -62,51 +159,29 @@ function monteCarloBlackScholes(params) {
       args.push(threads.toString());
     }
 
-    // Spawn the C++ process
-    const process = spawn(executablePath, args);
-    
-    let stdoutData = '';
-    let stderrData = '';
-
-    // Collect stdout data
-    process.stdout.on('data', (data) => {
-      stdoutData += data.toString();
-    });
-
-    // Collect stderr data
-    process.stderr.on('data', (data) => {
-      stderrData += data.toString();
-    });
-
-    // Handle process completion
-    process.on('close', (code) => {
-      if (code !== 0) {
-        reject(new Error(`C++ process exited with code ${code}: ${stderrData}`));
-        return;
-      }
-
-      try {
-        // Parse the JSON output from the C++ executable
-        const result = JSON.parse(stdoutData);
-        if (result.error) {
-          reject(new Error('Error in C++ calculation'));
-        } else {
-          resolve(result);
-        }
-      } catch (error) {
-        reject(new Error(`Failed to parse C++ output: ${error.message}`));
-      }
-    });
+    // Optional engine flags
+    if (precision) {
+      args.push(`--precision=${precision}`);
+    }
+    if (timing) {
+      args.push('--timing');
+    }
+    if (convergence) {
+      args.push('--convergence');
+    }
+    if (distribution) {
+      args.push('--distribution');
+    }
+    if (onProgress) {
+      args.push(`--progress=${PROGRESS_INTERVAL_MS}`);
+    }
 
-    // Handle process errors
-    process.on('error', (error) => {
-      reject(new Error(`Failed to start C++ process: ${error.message}`));
-    });
+    runExecutable(args, { onProgress, signal }).then(resolve, reject);
   });
 }
 
 /**
- * Run C++ benchmark with multiple iterations
+ * Run a C++ thread/trial scaling sweep (benchmark mode 2)
  * @param {Object} params - Black-Scholes parameters
  * @param {number} params.S0 - Initial stock price
  * @param {number} params.K - Strike price
@@ -115,14 +190,71 @@ function monteCarloBlackScholes(params) {
  * @param {number} params.T - Time to maturity in years
  * @param {boolean} params.isCall - True for call option, false for put option
  * @param {number} params.numTrials - Number of Monte Carlo trials
- * @param {number} params.benchmarkMode - 1 for benchmark mode
- * @param {number} params.threads - Number of threads to use
- * @param {number} params.iterations - Number of benchmark iterations
- * @returns {Promise<Object>} Benchmark results
+ * @param {number} [params.maxThreads] - Largest thread count in the sweep (omitted = all cores)
+ * @param {number} [params.iterations=3] - Timed runs per configuration (the median is reported)
+ * @param {string} [params.precision] - 'double' (default) or 'single'
+ * @param {Object} [options] - Run options
+ * @param {AbortSignal} [options.signal] - Stops the sweep (the engine process is killed)
+ * @returns {Promise<Object>} threadSweep and trialSweep arrays with medianTime, speedup,
+ *   efficiency and pathsPerSecond per configuration
  */
+function runBenchmark(params, { signal } = {}) {
+  if (!isExecutableAvailable()) {
+    return Promise.reject(new Error('C++ executable not found.'));
+  }
+
+  const { S0, K, r, sigma, T, isCall, numTrials, maxThreads = 0, iterations = 3, precision } = params;
+  if (!S0 || !K || r === undefined || !sigma || !T || numTrials === undefined) {
+    return Promise.reject(new Error('Missing required parameters'));
+  }
+
+  const args = [
+    S0.toString(),
+    K.toString(),
+    r.toString(),
+    sigma.toString(),
+    T.toString(),
+    isCall ? '1' : '0',
+    numTrials.toString(),
+    '2', // benchmark mode 2 = scaling sweep
+    maxThreads.toString(),
+    iterations.toString()
+  ];
+  if (precision) {
+    args.push(`--precision=${precision}`);
+  }
+
+  return runExecutable(args, { signal });
+}
+
+/**
+ * Paths a scaling sweep simulates, warm-up runs included (mirrors run_thread_sweep and
+ * run_trial_sweep in the engine)
+ * @param {Object} params - Sweep settings
+ * @param {number} params.numTrials - Number of Monte Carlo trials
+ * @param {number} params.maxThreads - Largest thread count in the sweep
+ * @param {number} [params.iterations=3] - Timed runs per configuration
+ * @returns {number} Total paths
+ */
+function benchmarkPaths({ numTrials, maxThreads, iterations = 3 }) {
+  let threadRuns = 1;
+  for (let threads = 1; threads < maxThreads; threads *= 2) {
+    threadRuns++;
+  }
+  let trialPaths = numTrials;
+  for (let trials = 1000; trials < numTrials; trials *= 10) {
+    trialPaths += trials;
+  }
+  // Each trial count runs at maxThreads and at one thread
+  const trialRuns = maxThreads > 1 ? 2 : 1;
+  return (iterations + 1) * (threadRuns * numTrials + trialRuns * trialPaths);
+}
 
 
 module.exports = {
   monteCarloBlackScholes,
-  isExecutableAvailable
+  runBenchmark,
+  benchmarkPaths,
+  isExecutableAvailable,
+  executablePath
 }; 
\ No newline at end of file
@@ -1,5 +1,34 @@
 const cppMonteCarlo = require('./monte_carlo_cpp');
 const analyticalBS = require('./black_scholes_analytical');
+const { EnginePool } = require('./engine_pool');
+const { EngineWorkerPool, DEFAULT_WORKERS } = require('./engine_worker_pool');
+const { registry, metrics } = require('./metrics');
+const tracing = require('./tracing');
+
+// Longest a /metrics scrape waits for the engine's stats reply
+const ENGINE_STATS_TIMEOUT_MS = 1000;
+// Scrapes within this long of the last engine poll reuse its stats
+const ENGINE_STATS_MAX_AGE_MS = 1000;
+
+/**
+ * Settle with `promise`, or reject as soon as `signal` aborts
+ * @param {Promise} promise - Work to wait for
+ * @param {AbortSignal} [signal] - Stops the wait
+ * @returns {Promise<*>} The promise's result
+ */
+function untilAborted(promise, signal) {
+  if (!signal) {
+    return promise;
+  }
+  if (signal.aborted) {
+    return Promise.reject(new Error('Cancelled'));
+  }
+  return new Promise((resolve, reject) => {
+    const onAbort = () => reject(new Error('Cancelled'));
+    signal.addEventListener('abort', onAbort, { once: true });
+    promise.then(resolve, reject).finally(() => signal.removeEventListener('abort', onAbort));
+  });
+}
 
 /**
  * Monte Carlo Black-Scholes Option Pricing Service
@@ -17,9 +46,19 @@ class MonteCarloService {
    * @param {boolean} params.isCall - True for call option, false for put option
    * @param {number} params.numTrials - Number of Monte Carlo trials
    * @param {boolean} [params.validateWithAnalytical=false] - Whether to validate against analytical solution
+   * @param {string} [params.precision='double'] - Kernel precision, 'single' uses float32 paths with double accumulation
+   * @param {boolean} [params.timing=false] - Include the engine's per-phase timing breakdown
+   * @param {boolean} [params.convergence=false] - Include the running estimate at 1k, 2k, 4k, ... paths
+   * @param {boolean} [params.distribution=false] - Include terminal-price and payoff histograms and quantiles
    * @returns {Promise<Object>} Option price, confidence interval, implementation used, and validation (if requested)
    */
   async calculateOptionPrice(params) {
+    const attributes = { 'pricing.num_trials': params.numTrials, 'pricing.precision': params.precision || 'double' };
+    return tracing.withSpan('pricing.calculate', { attributes }, () => this.runOptionPrice(params));
+  }
+
+  // calculateOptionPrice inside its span
+  async runOptionPrice(params) {
     const { validateWithAnalytical = false } = params;
 
     if (!cppMonteCarlo.isExecutableAvailable()) {
@@ -29,8 +68,9 @@ class MonteCarloService {
     let result;
     try {
       console.log('Using C++ implementation for Monte Carlo simulation');
-      result = await cppMonteCarlo.monteCarloBlackScholes(params);
+      result = await this.priceOnPool(params);
       result.implementation = 'cpp';
+      metrics.pricingPaths.inc({ mode: 'single' }, params.numTrials);
     } catch (error) {
       console.error('C++ implementation failed:', error.message);
       throw new Error('C++ Monte Carlo simulation failed. No fallback is available.');
@@ -38,32 +78,270 @@ class MonteCarloService {
 
     // Validate with analytical solution if requested
     if (validateWithAnalytical) {
-      try {
-        const analyticalResult = analyticalBS.calculateAnalyticalPrice(params);
-        
-        const monteCarloPrice = result.optionPrice;
-        const analyticalPrice = analyticalResult.analyticalPrice;
-        const absoluteError = Math.abs(monteCarloPrice - analyticalPrice);
-        const relativeError = absoluteError / analyticalPrice;
-
-        const isWithinConfidenceInterval = 
-          analyticalPrice >= result.confidence.lower && 
-          analyticalPrice <= result.confidence.upper;
-
-        result.validation = {
-          analyticalPrice,
-          absoluteError,
-          relativeError,
-          isWithinConfidenceInterval
-        };
-      } catch (error) {
-        console.error('Analytical validation failed:', error.message);
-        result.validation = {
-          error: error.message
-        };
+      this.addValidation(params, result);
+    }
+
+    return result;
+  }
+
+  /**
+   * Compare a Monte Carlo result with the analytical price (sets result.validation)
+   * @param {Object} params - Black-Scholes parameters
+   * @param {Object} result - Monte Carlo result with optionPrice and confidence
+   */
+  addValidation(params, result) {
+    const span = tracing.startSpan('pricing.validate_analytical');
+    try {
+      const analyticalResult = analyticalBS.calculateAnalyticalPrice(params);
+      
+      const monteCarloPrice = result.optionPrice;
+      const analyticalPrice = analyticalResult.analyticalPrice;
+      const absoluteError = Math.abs(monteCarloPrice - analyticalPrice);
+      const relativeError = absoluteError / analyticalPrice;
+
+      const isWithinConfidenceInterval = 
+        analyticalPrice >= result.confidence.lower && 
+        analyticalPrice <= result.confidence.upper;
+
+      result.validation = {
+        analyticalPrice,
+        absoluteError,
+        relativeError,
+        isWithinConfidenceInterval
+      };
+    } catch (error) {
+      console.error('Analytical validation failed:', error.message);
+      result.validation = {
+        error: error.message
+      };
+      span.recordException(error);
+    } finally {
+      span.end();
+    }
+  }
+
+  /**
+   * Price one option on a pooled engine process that reports its running estimate as it
+   * simulates. Aborting stops the reports and rejects at once; the engine still finishes the
+   * job (bounded by the request's numTrials), as other requests share the process.
+   * @param {Object} params - Black-Scholes parameters and validateWithAnalytical (see calculateOptionPrice)
+   * @param {Object} options - Stream options
+   * @param {Function} options.onProgress - Receives { paths, totalPaths, optionPrice, confidence }
+   * @param {AbortSignal} [options.signal] - Stops the stream
+   * @returns {Promise<Object>} Final option price and confidence interval
+   */
+  async streamOptionPrice(params, { onProgress, signal }) {
+    if (!cppMonteCarlo.isExecutableAvailable()) {
+      throw new Error('C++ Monte Carlo executable not found. Cannot proceed without it.');
+    }
+    const attributes = { 'pricing.num_trials': params.numTrials, 'pricing.precision': params.precision || 'double' };
+    return tracing.withSpan('pricing.stream', { attributes }, async () => {
+      const run = this.priceOnPool({ ...params, onProgress: (progress) => !(signal && signal.aborted) && onProgress(progress) });
+      const result = await untilAborted(run, signal);
+      result.implementation = 'cpp';
+      metrics.pricingPaths.inc({ mode: 'single' }, params.numTrials);
+      if (params.validateWithAnalytical) {
+        this.addValidation(params, result);
       }
+      return result;
+    });
+  }
+
+  /**
+   * Price one option on a pooled engine process, traced as a client span
+   * @param {Object} params - Black-Scholes parameters, the timing/convergence/distribution
+   *   report flags and an optional onProgress callback (see EngineConnection.price)
+   * @returns {Promise<Object>} { optionPrice, confidence: { lower, upper }, threadsUsed, cpuSeconds } and the requested reports
+   */
+  async priceOnPool(params) {
+    const { S0, K, r, sigma, T, isCall, numTrials, threads, precision, timing, convergence, distribution, onProgress } = params;
+    if (!S0 || !K || r === undefined || !sigma || !T || numTrials === undefined) {
+      throw new Error('Missing required parameters');
     }
+    const attributes = { 'engine.mode': 0 };
+    return tracing.withSpan('engine.request', { kind: tracing.SPAN_KIND.CLIENT, attributes }, async () => {
+      const traceparent = tracing.engineTraceparent();
+      const result = await this.getEnginePool().price({
+        S0, K, r, sigma, T, isCall, numTrials, threads, precision, traceparent, timing, convergence, distribution, onProgress
+      });
+      if (typeof result.cpuSeconds === 'number') {
+        metrics.pricingCpuSeconds.observe({}, result.cpuSeconds);
+      }
+      if (result.trace) {
+        tracing.importEngineSpans(result.trace);
+        delete result.trace;
+      }
+      return result;
+    });
+  }
 
+  /**
+   * Price many contracts through a pooled engine process (binary protocol)
+   * @param {Array<Object>} contracts - Contracts with S0, K, r, sigma, T, isCall
+   * @param {Object} options - Batch settings
+   * @param {number} options.numTrials - Number of Monte Carlo trials per contract
+   * @param {number} [options.threads] - Number of threads (0 or omitted = automatic)
+   * @param {string} [options.precision] - 'single' or 'double'
+   * @returns {Promise<Object>} { count, threadsUsed, prices, lower, upper } with Float64Array columns
+   */
+  async calculateOptionPriceBatch(contracts, options) {
+    if (!cppMonteCarlo.isExecutableAvailable()) {
+      throw new Error('C++ Monte Carlo executable not found. Cannot proceed without it.');
+    }
+    const attributes = { 'pricing.contracts': contracts.length, 'pricing.num_trials': options.numTrials };
+    return tracing.withSpan('pricing.batch', { kind: tracing.SPAN_KIND.CLIENT, attributes }, async () => {
+      const traceparent = tracing.engineTraceparent();
+      const result = await this.getEnginePool().priceBatch(contracts, { ...options, traceparent });
+      if (result.trace) {
+        tracing.importEngineSpans(result.trace);
+        delete result.trace;
+      }
+      metrics.pricingPaths.inc({ mode: 'batch' }, contracts.length * options.numTrials);
+      return result;
+    });
+  }
+
+  /**
+   * Simulate sample paths for plotting on a pooled engine process, each downsampled to
+   * `points` points by the engine (LTTB), so full path matrices never leave it
+   * @param {Object} params - Path settings
+   * @param {number} params.S0 - Initial stock price
+   * @param {number} params.r - Risk-free rate
+   * @param {number} params.sigma - Volatility
+   * @param {number} params.T - Horizon in years
+   * @param {number} params.count - Paths (at most 1,000)
+   * @param {number} params.steps - Simulated time steps per path (at most 10,000)
+   * @param {number} params.points - Points kept per path (at most steps + 1 and 2,000)
+   * @param {number} [params.seed=0] - Generator seed (0 = from the clock)
+   * @returns {Promise<Object>} { count, points, times, prices } with path-major Float32Array columns
+   */
+  async samplePaths(params) {
+    if (!cppMonteCarlo.isExecutableAvailable()) {
+      throw new Error('C++ Monte Carlo executable not found. Cannot proceed without it.');
+    }
+    const attributes = { 'paths.count': params.count, 'paths.steps': params.steps, 'paths.points': params.points };
+    return tracing.withSpan('pricing.paths', { kind: tracing.SPAN_KIND.CLIENT, attributes }, async () => {
+      const traceparent = tracing.engineTraceparent();
+      const result = await this.getEnginePool().samplePaths({ ...params, traceparent });
+      if (result.trace) {
+        tracing.importEngineSpans(result.trace);
+        delete result.trace;
+      }
+      return result;
+    });
+  }
+
+  /**
+   * Pool of pre-started engine processes serving single and batch pricing, hosted on
+   * worker threads (ENGINE_WORKERS, default 2; 0 = on the main thread).
+   * Created on first use; startEnginePool() warms it at server start-up instead.
+   * @returns {EngineWorkerPool|EnginePool} The pool
+   */
+  getEnginePool() {
+    if (!this.enginePool) {
+      // ENGINE_HOT_SWAP=0 keeps the engines on the binary they started with
+      const watch = process.env.ENGINE_HOT_SWAP !== '0';
+      const executablePath = cppMonteCarlo.executablePath;
+      this.enginePool = DEFAULT_WORKERS > 0
+        ? new EngineWorkerPool({ executablePath, poolOptions: { watch } })
+        : new EnginePool({ executablePath, watch });
+      this.enginePool.on('stderr', (text) => console.error('C++ engine:', text.trim()));
+      this.enginePool.on('upgrade', (hash) => console.log(`C++ engine upgraded to build ${hash}`));
+      this.enginePool.on('rollback', (hash, error) => {
+        console.error(`C++ engine build ${hash} rejected, keeping the running version: ${error.message}`);
+      });
+      this.enginePool.on('exit', (slot, code, reason) => {
+        if (reason !== 'recycled' && reason !== 'stopped') {
+          console.error(`C++ engine ${slot} exited (${reason}, code ${code}); restarting`);
+        }
+      });
+    }
+    return this.enginePool;
+  }
+
+  /**
+   * Spawn the engine pool now, so no request pays the process start-up
+   * @returns {Promise<void>} Resolves once every engine is ready
+   */
+  startEnginePool() {
+    if (!cppMonteCarlo.isExecutableAvailable()) {
+      return Promise.resolve();
+    }
+    return this.getEnginePool().start();
+  }
+
+  /**
+   * Pool stats for a scrape. Concurrent scrapes share one poll of the engines, and a poll is
+   * reused for ENGINE_STATS_MAX_AGE_MS, so frequent scrapes do not add work for the engines.
+   * @param {Object} pool - Engine pool
+   * @returns {Promise<Object>} Pool summary
+   */
+  pollEngineStats(pool) {
+    const now = Date.now();
+    if (!this.engineStatsPoll || this.engineStatsPool !== pool || now - this.engineStatsPolledAt > ENGINE_STATS_MAX_AGE_MS) {
+      this.engineStatsPool = pool;
+      this.engineStatsPolledAt = now;
+      this.engineStatsPoll = pool.stats(ENGINE_STATS_TIMEOUT_MS);
+    }
+    return this.engineStatsPoll;
+  }
+
+  /**
+   * Refresh the engine gauges from the pooled engines' stats commands.
+   * Only polls running engines - a scrape never spawns one.
+   * @returns {Promise<void>} Resolves once the gauges are updated
+   */
+  async collectEngineMetrics() {
+    const pool = this.enginePool;
+    if (!pool) {
+      metrics.engineUp.set({}, 0);
+      metrics.enginePending.set({}, 0);
+      metrics.engineQueueDepth.set({}, 0);
+      metrics.engineInFlight.set({}, 0);
+      return;
+    }
+
+    const stats = await this.pollEngineStats(pool);
+    metrics.engineUp.set({}, stats.live);
+    metrics.enginePending.set({}, stats.pending);
+    metrics.engineQueueDepth.set({}, stats.queueDepth);
+    metrics.engineInFlight.set({}, stats.inFlight);
+    metrics.engineRestarts.setTotal({}, stats.restarts);
+    metrics.engineRecycles.setTotal({}, stats.recycles);
+    metrics.engineUpgrades.setTotal({ outcome: 'succeeded' }, stats.upgrades);
+    metrics.engineUpgrades.setTotal({ outcome: 'rolled_back' }, stats.rollbacks);
+    metrics.engineRequests.setTotal({}, stats.requestsTotal);
+    metrics.engineJobs.setTotal({ outcome: 'completed' }, stats.jobsCompleted);
+    metrics.engineJobs.setTotal({ outcome: 'failed' }, stats.jobsFailed);
+    metrics.enginePaths.setTotal({}, stats.pathsTotal);
+    metrics.engineCpuSeconds.setTotal({}, stats.cpuSeconds);
+    for (const [requestClass, stages] of Object.entries(stats.latency)) {
+      for (const [stage, summary] of Object.entries(stages)) {
+        for (const quantile of ['p50', 'p99', 'p999']) {
+          const label = { p50: '0.5', p99: '0.99', p999: '0.999' }[quantile];
+          metrics.engineLatency.set({ class: requestClass, stage, quantile: label }, summary[quantile] / 1e6);
+        }
+        metrics.engineLatency.set({ class: requestClass, stage, quantile: '1' }, summary.max / 1e6);
+      }
+    }
+  }
+
+  /**
+   * Run a thread-count and trial-count scaling sweep on the C++ engine
+   * @param {Object} params - Black-Scholes parameters plus numTrials
+   * @param {number} [params.maxThreads] - Largest thread count to try (omitted = all cores)
+   * @param {number} [params.iterations] - Timed runs per configuration
+   * @param {string} [params.precision] - 'single' or 'double'
+   * @param {Object} [options] - Run options
+   * @param {AbortSignal} [options.signal] - Stops the sweep and kills the engine process
+   * @returns {Promise<Object>} Sweep results with speedup, efficiency and paths/sec per configuration
+   */
+  async runBenchmark(params, { signal } = {}) {
+    if (!cppMonteCarlo.isExecutableAvailable()) {
+      throw new Error('C++ Monte Carlo executable not found. Cannot proceed without it.');
+    }
+    const result = await cppMonteCarlo.runBenchmark(params, { signal });
+    result.implementation = 'cpp';
     return result;
   }
 
@@ -90,4 +368,7 @@ class MonteCarloService {
   }
 }
 
-module.exports = new MonteCarloService();
+const service = new MonteCarloService();
+registry.onCollect(() => service.collectEngineMetrics());
+
+module.exports = service;
@@ -0,0 +1,352 @@
+const { AsyncLocalStorage } = require('async_hooks');
+const crypto = require('crypto');
+const fs = require('fs');
+const http = require('http');
+const https = require('https');
+const { performance } = require('perf_hooks');
+
+/**
+ * Minimal OpenTelemetry-compatible tracer.
+ * Spans are exported as OTLP/JSON (ExportTraceServiceRequest), either appended one request
+ * per line to TRACE_EXPORT_FILE (readable by the collector's otlpjsonfile receiver) or POSTed
+ * to OTEL_EXPORTER_OTLP_ENDPOINT/v1/traces. Tracing is off unless one of them is set.
+ * W3C traceparent headers are honoured on input and propagated to the C++ engine.
+ */
+
+const SERVICE_NAME = process.env.OTEL_SERVICE_NAME || 'monte-carlo-server';
+const EXPORT_FILE = process.env.TRACE_EXPORT_FILE || '';
+const EXPORT_ENDPOINT = (process.env.OTEL_EXPORTER_OTLP_ENDPOINT || '').replace(/\/$/, '');
+const SAMPLE_RATIO = Math.min(Math.max(Number(process.env.TRACE_SAMPLE_RATIO || 1), 0), 1);
+const FLUSH_INTERVAL_MS = 5000;
+const MAX_BATCH_SPANS = 512;
+const MAX_QUEUED_SPANS = 8192;
+
+// OTLP enums
+const SPAN_KIND = { INTERNAL: 1, SERVER: 2, CLIENT: 3 };
+const STATUS_CODE = { UNSET: 0, OK: 1, ERROR: 2 };
+
+const enabled = Boolean(EXPORT_FILE || EXPORT_ENDPOINT);
+const storage = new AsyncLocalStorage();
+let queue = [];
+let flushTimer = null;
+
+/**
+ * Wall-clock time in Unix nanoseconds (microsecond resolution) as a decimal string
+ * @returns {string} Nanoseconds since the epoch
+ */
+function nowUnixNano() {
+  const micros = Math.round((performance.timeOrigin + performance.now()) * 1000);
+  return (BigInt(micros) * 1000n).toString();
+}
+
+function toAttributeValue(value) {
+  if (typeof value === 'boolean') return { boolValue: value };
+  if (Number.isInteger(value)) return { intValue: String(value) };
+  if (typeof value === 'number') return { doubleValue: value };
+  return { stringValue: String(value) };
+}
+
+class Span {
+  /**
+   * @param {string} name - Span name
+   * @param {Object} options - Span options
+   * @param {string} options.traceId - 32 hex digits
+   * @param {string} [options.parentSpanId] - 16 hex digits
+   * @param {number} [options.kind] - SPAN_KIND value
+   * @param {boolean} [options.sampled=true] - Whether the span is recorded
+   * @param {Object} [options.attributes] - Initial attributes
+   */
+  constructor(name, { traceId, parentSpanId = '', kind = SPAN_KIND.INTERNAL, sampled = true, attributes = {} }) {
+    this.name = name;
+    this.traceId = traceId;
+    this.spanId = crypto.randomBytes(8).toString('hex');
+    this.parentSpanId = parentSpanId;
+    this.kind = kind;
+    this.sampled = sampled;
+    this.attributes = { ...attributes };
+    this.events = [];
+    this.status = { code: STATUS_CODE.UNSET };
+    this.startTimeUnixNano = nowUnixNano();
+    this.ended = false;
+  }
+
+  setAttribute(key, value) {
+    if (value !== undefined && value !== null) {
+      this.attributes[key] = value;
+    }
+    return this;
+  }
+
+  addEvent(name, attributes = {}) {
+    this.events.push({ name, timeUnixNano: nowUnixNano(), attributes });
+    return this;
+  }
+
+  /**
+   * Mark the span failed
+   * @param {Error} error - Cause
+   */
+  recordException(error) {
+    this.addEvent('exception', { 'exception.type': error.name, 'exception.message': error.message });
+    this.status = { code: STATUS_CODE.ERROR, message: error.message };
+    return this;
+  }
+
+  /**
+   * W3C traceparent header value naming this span as the parent
+   * @returns {string} traceparent
+   */
+  traceparent() {
+    return `00-${this.traceId}-${this.spanId}-${this.sampled ? '01' : '00'}`;
+  }
+
+  end() {
+    if (this.ended) return;
+    this.ended = true;
+    this.endTimeUnixNano = nowUnixNano();
+    if (this.sampled && enabled) {
+      enqueue(toOtlpSpan(this));
+    }
+  }
+}
+
+function toOtlpSpan(span) {
+  return {
+    traceId: span.traceId,
+    spanId: span.spanId,
+    parentSpanId: span.parentSpanId,
+    name: span.name,
+    kind: span.kind,
+    startTimeUnixNano: span.startTimeUnixNano,
+    endTimeUnixNano: span.endTimeUnixNano,
+    attributes: Object.entries(span.attributes).map(([key, value]) => ({ key, value: toAttributeValue(value) })),
+    events: span.events.map((event) => ({
+      name: event.name,
+      timeUnixNano: event.timeUnixNano,
+      attributes: Object.entries(event.attributes).map(([key, value]) => ({ key, value: toAttributeValue(value) }))
+    })),
+    status: span.status
+  };
+}
+
+/**
+ * Parse a W3C traceparent header
+ * @param {string} header - Header value
+ * @returns {Object|null} { traceId, parentSpanId, sampled } or null when absent/invalid
+ */
+function parseTraceparent(header) {
+  const match = /^00-([0-9a-f]{32})-([0-9a-f]{16})-([0-9a-f]{2})$/.exec(String(header || '').trim());
+  if (!match || /^0+$/.test(match[1]) || /^0+$/.test(match[2])) {
+    return null;
+  }
+  return { traceId: match[1], parentSpanId: match[2], sampled: (parseInt(match[3], 16) & 1) === 1 };
+}
+
+/**
+ * Start a span under the current span (or a new trace when there is none)
+ * @param {string} name - Span name
+ * @param {Object} [options] - kind, attributes, and parent ({ traceId, parentSpanId, sampled }) to override the context
+ * @returns {Span} Started span; call end()
+ */
+function startSpan(name, { kind, attributes, parent } = {}) {
+  const current = parent || storage.getStore();
+  if (current) {
+    return new Span(name, {
+      traceId: current.traceId,
+      parentSpanId: current.spanId || current.parentSpanId,
+      sampled: current.sampled,
+      kind,
+      attributes
+    });
+  }
+  return new Span(name, {
+    traceId: crypto.randomBytes(16).toString('hex'),
+    sampled: enabled && Math.random() < SAMPLE_RATIO,
+    kind,
+    attributes
+  });
+}
+
+/**
+ * Run fn inside a new span, ending it when fn settles and recording a thrown error
+ * @param {string} name - Span name
+ * @param {Object} options - { kind, attributes }
+ * @param {Function} fn - Receives the span; may return a promise
+ * @returns {Promise<*>} fn's result
+ */
+async function withSpan(name, { kind, attributes } = {}, fn) {
+  const span = startSpan(name, { kind, attributes });
+  try {
+    return await storage.run(span, () => fn(span));
+  } catch (error) {
+    span.recordException(error);
+    throw error;
+  } finally {
+    span.end();
+  }
+}
+
+/**
+ * The span of the current async context
+ * @returns {Span|undefined} Active span
+ */
+function activeSpan() {
+  return storage.getStore();
+}
+
+/**
+ * traceparent to hand to the engine, or undefined when the current trace is not recorded
+ * (so unsampled requests do not pay for engine span collection)
+ * @returns {string|undefined} traceparent header value
+ */
+function engineTraceparent() {
+  const span = storage.getStore();
+  return span && span.sampled && enabled ? span.traceparent() : undefined;
+}
+
+/**
+ * Export spans reported by the engine ({ traceId, spans: [...] }), already parented under our span
+ * @param {Object} trace - Engine trace section
+ */
+function importEngineSpans(trace) {
+  if (!enabled || !trace || !Array.isArray(trace.spans)) {
+    return;
+  }
+  for (const span of trace.spans) {
+    enqueue({
+      traceId: trace.traceId,
+      spanId: span.spanId,
+      parentSpanId: span.parentSpanId,
+      name: span.name,
+      kind: SPAN_KIND.INTERNAL,
+      startTimeUnixNano: span.startTimeUnixNano,
+      endTimeUnixNano: span.endTimeUnixNano,
+      attributes: [{ key: 'service.component', value: { stringValue: 'cpp-engine' } }],
+      status: { code: STATUS_CODE.UNSET }
+    });
+  }
+}
+
+/**
+ * Wrap an async route handler in its own span, so time spent in the middleware before it
+ * shows up as the gap between the request span and the handler span
+ * @param {string} name - Span name
+ * @param {Function} handler - (req, res) => Promise
+ * @returns {Function} Express handler
+ */
+function traced(name, handler) {
+  return (req, res, next) => withSpan(name, {}, () => handler(req, res, next)).catch(next);
+}
+
+/**
+ * Express middleware: one SERVER span per request, continuing an incoming traceparent.
+ * The span is named after the matched route once the response is finished.
+ */
+function httpTracingMiddleware(req, res, next) {
+  const incoming = parseTraceparent(req.headers.traceparent);
+  const span = startSpan(`${req.method} ${req.path}`, {
+    kind: SPAN_KIND.SERVER,
+    parent: incoming || undefined,
+    attributes: { 'http.request.method': req.method, 'url.path': req.path }
+  });
+  res.on('finish', () => {
+    const route = req.route ? `${req.baseUrl || ''}${req.route.path}` : undefined;
+    if (route) {
+      span.name = `${req.method} ${route}`;
+      span.setAttribute('http.route', route);
+    }
+    span.setAttribute('http.response.status_code', res.statusCode);
+    if (res.statusCode >= 500) {
+      span.status = { code: STATUS_CODE.ERROR };
+    }
+    span.end();
+  });
+  storage.run(span, next);
+}
+
+// --- export ---
+
+function enqueue(otlpSpan) {
+  if (queue.length >= MAX_QUEUED_SPANS) {
+    return; // Exporter is not keeping up - drop rather than grow without bound
+  }
+  queue.push(otlpSpan);
+  if (queue.length >= MAX_BATCH_SPANS) {
+    flush();
+  } else if (!flushTimer) {
+    flushTimer = setTimeout(flush, FLUSH_INTERVAL_MS);
+    flushTimer.unref();
+  }
+}
+
+function exportRequest(spans) {
+  return {
+    resourceSpans: [{
+      resource: { attributes: [{ key: 'service.name', value: { stringValue: SERVICE_NAME } }] },
+      scopeSpans: [{ scope: { name: 'monte-carlo-suite' }, spans }]
+    }]
+  };
+}
+
+function postToCollector(body) {
+  const url = new URL(`${EXPORT_ENDPOINT}/v1/traces`);
+  const client = url.protocol === 'https:' ? https : http;
+  const request = client.request(url, {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(body) }
+  }, (response) => {
+    response.resume();
+    if (response.statusCode >= 300) {
+      console.error(`Trace export failed with HTTP ${response.statusCode}`);
+    }
+  });
+  request.on('error', (error) => console.error('Trace export failed:', error.message));
+  request.end(body);
+}
+
+/**
+ * Write out all queued spans
+ * @param {boolean} [sync=false] - Write the file synchronously (used at exit)
+ */
+function flush(sync = false) {
+  if (flushTimer) {
+    clearTimeout(flushTimer);
+    flushTimer = null;
+  }
+  if (queue.length === 0) {
+    return;
+  }
+  const body = JSON.stringify(exportRequest(queue));
+  queue = [];
+
+  if (EXPORT_FILE) {
+    if (sync) {
+      fs.appendFileSync(EXPORT_FILE, `${body}\n`);
+    } else {
+      fs.appendFile(EXPORT_FILE, `${body}\n`, (error) => {
+        if (error) console.error('Trace export failed:', error.message);
+      });
+    }
+  }
+  if (EXPORT_ENDPOINT) {
+    postToCollector(body);
+  }
+}
+
+if (enabled) {
+  process.on('exit', () => flush(true));
+}
+
+module.exports = {
+  enabled,
+  SPAN_KIND,
+  startSpan,
+  withSpan,
+  activeSpan,
+  engineTraceparent,
+  importEngineSpans,
+  parseTraceparent,
+  traced,
+  httpTracingMiddleware,
+  flush
+};